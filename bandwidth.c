@@ -0,0 +1,252 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <json_object.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+#include "tables.h"
+
+/* Display engines fetch each enabled plane from memory once per refresh,
+ * and underrun their FIFOs when the planes of a CRTC need more than the
+ * memory can deliver. The fetch of a plane is its source rectangle times
+ * the bytes per pixel of its format, at the refresh rate of the mode.
+ * Downscaled planes fetch more pixels than they display, so the scaling
+ * ratio is reported next to the bandwidth.
+ *
+ * Only the dump is used, so this works with -i too. */
+
+/* Average bytes fetched per pixel, over all planes of the format. Returns 0
+ * if the format is unknown. */
+static double fb_bytes_per_pixel(struct json_object *fb_obj)
+{
+	struct json_object *format_obj = json_object_object_get(fb_obj, "format");
+	if (!format_obj) {
+		/* Legacy drmModeGetFB() */
+		return get_object_object_uint64(fb_obj, "bpp") / 8.0;
+	}
+
+	const struct format_info *info =
+		format_info(json_object_get_uint64(format_obj));
+	if (!info) {
+		return 0;
+	}
+	double bytes = 0;
+	for (size_t i = 0; i < info->planes; i++) {
+		double plane_bytes = (double)info->bytes_per_block[i] /
+			(info->block_w[i] * info->block_h[i]);
+		if (i > 0) {
+			plane_bytes /= info->hsub * info->vsub;
+		}
+		bytes += plane_bytes;
+	}
+	return bytes;
+}
+
+/* Returns the property value, or def if the plane doesn't have it */
+static uint64_t plane_prop(struct json_object *props_obj, const char *name,
+		uint64_t def)
+{
+	struct json_object *prop_obj = json_object_object_get(props_obj, name);
+	if (!prop_obj) {
+		return def;
+	}
+	return get_object_object_uint64(prop_obj, "value");
+}
+
+static struct json_object *plane_bandwidth(struct json_object *plane_obj,
+		struct json_object *mode_obj, double refresh)
+{
+	struct json_object *fb_obj = json_object_object_get(plane_obj, "fb");
+	struct json_object *props_obj =
+		json_object_object_get(plane_obj, "properties");
+	uint32_t fb_width = get_object_object_uint64(fb_obj, "width");
+	uint32_t fb_height = get_object_object_uint64(fb_obj, "height");
+
+	/* SRC_* are 16.16 fixed point. Without atomic properties, the whole
+	 * framebuffer covers the whole mode. */
+	double src_w = plane_prop(props_obj, "SRC_W", (uint64_t)fb_width << 16) /
+		65536.0;
+	double src_h = plane_prop(props_obj, "SRC_H", (uint64_t)fb_height << 16) /
+		65536.0;
+	uint64_t crtc_w = plane_prop(props_obj, "CRTC_W",
+		get_object_object_uint64(mode_obj, "hdisplay"));
+	uint64_t crtc_h = plane_prop(props_obj, "CRTC_H",
+		get_object_object_uint64(mode_obj, "vdisplay"));
+	double bytes_per_pixel = fb_bytes_per_pixel(fb_obj);
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "id",
+		json_object_new_uint64(get_object_object_uint64(plane_obj, "id")));
+	json_object_object_add(obj, "type", json_object_new_uint64(
+		plane_prop(props_obj, "type", DRM_PLANE_TYPE_OVERLAY)));
+	if (json_object_object_get(fb_obj, "format")) {
+		json_object_object_add(obj, "format", json_object_new_uint64(
+			get_object_object_uint64(fb_obj, "format")));
+	}
+	json_object_object_add(obj, "src_w", json_object_new_double(src_w));
+	json_object_object_add(obj, "src_h", json_object_new_double(src_h));
+	json_object_object_add(obj, "crtc_w", json_object_new_uint64(crtc_w));
+	json_object_object_add(obj, "crtc_h", json_object_new_uint64(crtc_h));
+	json_object_object_add(obj, "hscale",
+		json_object_new_double(crtc_w ? src_w / crtc_w : 0));
+	json_object_object_add(obj, "vscale",
+		json_object_new_double(crtc_h ? src_h / crtc_h : 0));
+	json_object_object_add(obj, "bytes_per_pixel",
+		json_object_new_double(bytes_per_pixel));
+	/* Bytes per second */
+	json_object_object_add(obj, "bandwidth",
+		json_object_new_double(src_w * src_h * bytes_per_pixel * refresh));
+	return obj;
+}
+
+static struct json_object *crtc_bandwidth(struct json_object *crtc_obj,
+		struct json_object *planes_arr)
+{
+	uint32_t crtc_id = get_object_object_uint64(crtc_obj, "id");
+	struct json_object *mode_obj = json_object_object_get(crtc_obj, "mode");
+	double refresh = mode_refresh_rate(mode_obj);
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "id", json_object_new_uint64(crtc_id));
+	json_object_object_add(obj, "mode", json_object_new_string(
+		get_object_object_string(mode_obj, "name")));
+	json_object_object_add(obj, "refresh", json_object_new_double(refresh));
+
+	struct json_object *arr = json_object_new_array();
+	double total = 0;
+	bool unknown = false;
+	for (size_t i = 0; i < json_object_array_length(planes_arr); i++) {
+		struct json_object *plane_obj = json_object_array_get_idx(planes_arr, i);
+		if (get_object_object_uint64(plane_obj, "crtc_id") != crtc_id ||
+				!json_object_object_get(plane_obj, "fb")) {
+			continue;
+		}
+		struct json_object *bw_obj = plane_bandwidth(plane_obj, mode_obj, refresh);
+		if (get_object_object_double(bw_obj, "bytes_per_pixel") == 0) {
+			unknown = true;
+		}
+		total += get_object_object_double(bw_obj, "bandwidth");
+		json_object_array_add(arr, bw_obj);
+	}
+	json_object_object_add(obj, "planes", arr);
+	json_object_object_add(obj, "bandwidth", json_object_new_double(total));
+	/* Planes with an unknown format aren't counted */
+	json_object_object_add(obj, "complete", json_object_new_boolean(!unknown));
+	return obj;
+}
+
+struct json_object *bandwidth_info(struct json_object *drm_obj)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+		struct json_object *planes_arr =
+			json_object_object_get(dev_obj, "planes");
+
+		struct json_object *arr = json_object_new_array();
+		double total = 0;
+		for (size_t i = 0; i < json_object_array_length(crtcs_arr); i++) {
+			struct json_object *crtc_obj =
+				json_object_array_get_idx(crtcs_arr, i);
+			if (!json_object_object_get(crtc_obj, "mode")) {
+				continue;
+			}
+			struct json_object *bw_obj = crtc_bandwidth(crtc_obj, planes_arr);
+			total += get_object_object_double(bw_obj, "bandwidth");
+			json_object_array_add(arr, bw_obj);
+		}
+
+		struct json_object *dev_bw_obj = json_object_new_object();
+		json_object_object_add(dev_bw_obj, "crtcs", arr);
+		json_object_object_add(dev_bw_obj, "bandwidth",
+			json_object_new_double(total));
+		json_object_object_add(obj, path, dev_bw_obj);
+	}
+	return obj;
+}
+
+static void print_rate(double bytes_per_sec)
+{
+	if (bytes_per_sec >= 1e9) {
+		printf("%.2f GB/s", bytes_per_sec / 1e9);
+	} else {
+		printf("%.1f MB/s", bytes_per_sec / 1e6);
+	}
+}
+
+static void print_plane_bandwidth(struct json_object *obj, const char *prefix)
+{
+	printf("Plane %"PRIu64" (%s): ",
+		get_object_object_uint64(obj, "id"),
+		plane_type_str(get_object_object_uint64(obj, "type")));
+	if (get_object_object_double(obj, "bytes_per_pixel") == 0) {
+		printf("unknown format\n");
+		return;
+	}
+	print_rate(get_object_object_double(obj, "bandwidth"));
+	printf("\n");
+
+	struct json_object *format_obj = json_object_object_get(obj, "format");
+	printf("%s" L_VAL "Source: %.1fx%.1f", prefix,
+		get_object_object_double(obj, "src_w"),
+		get_object_object_double(obj, "src_h"));
+	if (format_obj) {
+		printf(" %s", format_str(json_object_get_uint64(format_obj)));
+	}
+	printf(", %.2f bytes per pixel\n",
+		get_object_object_double(obj, "bytes_per_pixel"));
+	printf("%s" L_LAST "Scaling: %"PRIu64"x%"PRIu64" on screen, "
+		"ratio %.3f x %.3f\n", prefix,
+		get_object_object_uint64(obj, "crtc_w"),
+		get_object_object_uint64(obj, "crtc_h"),
+		get_object_object_double(obj, "hscale"),
+		get_object_object_double(obj, "vscale"));
+}
+
+static void print_crtc_bandwidth(struct json_object *obj, const char *prefix)
+{
+	printf("CRTC %"PRIu64": %s@%.2f: ", get_object_object_uint64(obj, "id"),
+		get_object_object_string(obj, "mode"),
+		get_object_object_double(obj, "refresh"));
+	print_rate(get_object_object_double(obj, "bandwidth"));
+	struct json_object *complete_obj = json_object_object_get(obj, "complete");
+	printf("%s\n", json_object_get_boolean(complete_obj) ? "" :
+		" (some planes not counted)");
+
+	struct json_object *planes_arr = json_object_object_get(obj, "planes");
+	size_t planes_len = json_object_array_length(planes_arr);
+	if (planes_len == 0) {
+		printf("%s" L_LAST "No enabled plane\n", prefix);
+	}
+	for (size_t i = 0; i < planes_len; i++) {
+		bool last = i == planes_len - 1;
+		char sub_prefix[strlen(prefix) + strlen(L_LINE) + 1];
+		snprintf(sub_prefix, sizeof(sub_prefix), "%s%s", prefix,
+			last ? L_GAP : L_LINE);
+		printf("%s%s", prefix, last ? L_LAST : L_VAL);
+		print_plane_bandwidth(json_object_array_get_idx(planes_arr, i),
+			sub_prefix);
+	}
+}
+
+void print_bandwidth(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, dev_obj) {
+		printf("Node: %s\n", path);
+
+		struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+		size_t crtcs_len = json_object_array_length(crtcs_arr);
+		printf("%sTotal: ", crtcs_len ? L_VAL : L_LAST);
+		print_rate(get_object_object_double(dev_obj, "bandwidth"));
+		printf("\n");
+		for (size_t i = 0; i < crtcs_len; i++) {
+			bool last = i == crtcs_len - 1;
+			printf("%s", last ? L_LAST : L_VAL);
+			print_crtc_bandwidth(json_object_array_get_idx(crtcs_arr, i),
+				last ? L_GAP : L_LINE);
+		}
+	}
+}
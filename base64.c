@@ -0,0 +1,140 @@
+#include "base64.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+static const char alphabet[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64_encoded_len(size_t len)
+{
+	return (len + 2) / 3 * 4;
+}
+
+static void encode_scalar(char *out, const uint8_t *in, size_t len)
+{
+	size_t i = 0;
+	for (; i + 3 <= len; i += 3) {
+		uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+		*out++ = alphabet[v >> 18];
+		*out++ = alphabet[(v >> 12) & 0x3F];
+		*out++ = alphabet[(v >> 6) & 0x3F];
+		*out++ = alphabet[v & 0x3F];
+	}
+
+	if (i + 1 == len) {
+		uint32_t v = (uint32_t)in[i] << 16;
+		*out++ = alphabet[v >> 18];
+		*out++ = alphabet[(v >> 12) & 0x3F];
+		*out++ = '=';
+		*out++ = '=';
+	} else if (i + 2 == len) {
+		uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8;
+		*out++ = alphabet[v >> 18];
+		*out++ = alphabet[(v >> 12) & 0x3F];
+		*out++ = alphabet[(v >> 6) & 0x3F];
+		*out++ = '=';
+	}
+	*out = '\0';
+}
+
+#ifdef HAVE_X86_SIMD
+/* Wojciech Muła's and Daniel Lemire's approach: each 3-byte group is spread
+ * over a 32-bit lane, the four 6-bit indices are moved into place with
+ * multiplications, and mapped to ASCII by adding a per-range offset picked
+ * with a byte shuffle. The AVX2 variant does the same on two 128-bit lanes. */
+
+#define RESHUFFLE \
+	10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+#define SHIFT_LUT \
+	0, 0, 'A', '/' - 63, '+' - 62, '0' - 52, '0' - 52, '0' - 52, \
+	'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, \
+	'0' - 52, 'a' - 26
+
+__attribute__((target("ssse3")))
+static __m128i encode_block_ssse3(__m128i in)
+{
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(RESHUFFLE));
+	__m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)),
+		_mm_set1_epi32(0x04000040));
+	__m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)),
+		_mm_set1_epi32(0x01000010));
+	__m128i indices = _mm_or_si128(hi, lo);
+
+	/* 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12 */
+	__m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	__m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+	range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+	__m128i shift = _mm_shuffle_epi8(_mm_set_epi8(SHIFT_LUT), range);
+	return _mm_add_epi8(indices, shift);
+}
+
+__attribute__((target("ssse3")))
+static void encode_ssse3(char *out, const uint8_t *in, size_t len)
+{
+	/* Each iteration reads 16 bytes but only consumes 12 */
+	while (len >= 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)in);
+		_mm_storeu_si128((__m128i *)out, encode_block_ssse3(block));
+		in += 12;
+		len -= 12;
+		out += 16;
+	}
+	encode_scalar(out, in, len);
+}
+
+__attribute__((target("avx2")))
+static void encode_avx2(char *out, const uint8_t *in, size_t len)
+{
+	/* Two 12-byte groups per iteration, one per 128-bit lane. The second
+	 * load reads up to in + 28. */
+	while (len >= 28) {
+		__m256i block = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+			_mm_loadu_si128((const __m128i *)(in + 12)), 1);
+
+		block = _mm256_shuffle_epi8(block, _mm256_set_epi8(RESHUFFLE, RESHUFFLE));
+		__m256i hi = _mm256_mulhi_epu16(
+			_mm256_and_si256(block, _mm256_set1_epi32(0x0FC0FC00)),
+			_mm256_set1_epi32(0x04000040));
+		__m256i lo = _mm256_mullo_epi16(
+			_mm256_and_si256(block, _mm256_set1_epi32(0x003F03F0)),
+			_mm256_set1_epi32(0x01000010));
+		__m256i indices = _mm256_or_si256(hi, lo);
+
+		__m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		__m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+		range = _mm256_or_si256(range,
+			_mm256_and_si256(upper, _mm256_set1_epi8(13)));
+		__m256i shift = _mm256_shuffle_epi8(
+			_mm256_set_epi8(SHIFT_LUT, SHIFT_LUT), range);
+		_mm256_storeu_si256((__m256i *)out, _mm256_add_epi8(indices, shift));
+
+		in += 24;
+		len -= 24;
+		out += 32;
+	}
+	encode_ssse3(out, in, len);
+}
+#endif
+
+void base64_encode(char *out, const uint8_t *in, size_t len)
+{
+#ifdef HAVE_X86_SIMD
+	static void (*encode)(char *out, const uint8_t *in, size_t len);
+	if (!encode) {
+		if (__builtin_cpu_supports("avx2")) {
+			encode = encode_avx2;
+		} else if (__builtin_cpu_supports("ssse3")) {
+			encode = encode_ssse3;
+		} else {
+			encode = encode_scalar;
+		}
+	}
+	encode(out, in, len);
+#else
+	encode_scalar(out, in, len);
+#endif
+}
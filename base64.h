@@ -0,0 +1,13 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Length of the encoded string for len bytes, without the NUL terminator */
+size_t base64_encoded_len(size_t len);
+/* Encodes len bytes from in, with padding. out must be able to hold
+ * base64_encoded_len(len) + 1 bytes, it is NUL-terminated. */
+void base64_encode(char *out, const uint8_t *in, size_t len);
+
+#endif
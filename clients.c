@@ -0,0 +1,659 @@
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json_object.h>
+#include <xf86drm.h>
+
+#include "drm_info.h"
+
+/* Per-client GPU usage from the DRM fdinfo keys documented in the kernel's
+ * drm-usage-stats.rst. /proc is sampled twice: the first pass classifies
+ * every fd of every process by its link target, the second one only looks
+ * at fds it hasn't seen before and re-reads the fdinfo of the DRM ones. */
+
+#define CLIENTS_INTERVAL_MS 1000
+#define CLIENTS_MAX_THREADS 8
+#define CLIENTS_MAX_KEYS 16
+
+struct fdinfo_counter {
+	char name[32];
+	/* Busy time in ns and capacity, cycles and total cycles, or bytes */
+	uint64_t value, total;
+};
+
+struct fdinfo_counters {
+	struct fdinfo_counter data[CLIENTS_MAX_KEYS];
+	size_t len;
+};
+
+struct fdinfo_client {
+	char pdev[32];
+	char driver[32];
+	uint64_t id;
+	struct fdinfo_counters engines, cycles, memory;
+};
+
+struct proc_fd {
+	int fd;
+	bool drm;
+};
+
+struct proc_info {
+	int pid;
+	char comm[32];
+	struct proc_fd *fds;
+	size_t fds_len;
+	struct fdinfo_client *clients;
+	size_t clients_len;
+};
+
+struct proc_table {
+	struct proc_info *data;
+	size_t len;
+};
+
+struct scan_job {
+	const char *root;
+	struct proc_table *table;
+	const struct proc_table *prev;
+	size_t start, step;
+};
+
+static struct fdinfo_counter *get_counter(struct fdinfo_counters *counters,
+		const char *name)
+{
+	for (size_t i = 0; i < counters->len; i++) {
+		if (strcmp(counters->data[i].name, name) == 0) {
+			return &counters->data[i];
+		}
+	}
+	if (counters->len == CLIENTS_MAX_KEYS) {
+		return NULL;
+	}
+	struct fdinfo_counter *counter = &counters->data[counters->len++];
+	snprintf(counter->name, sizeof(counter->name), "%s", name);
+	return counter;
+}
+
+static uint64_t parse_memory(const char *value)
+{
+	char *end;
+	uint64_t n = strtoull(value, &end, 10);
+	while (*end == ' ') {
+		end++;
+	}
+	if (strncmp(end, "KiB", 3) == 0) {
+		n *= 1024;
+	} else if (strncmp(end, "MiB", 3) == 0) {
+		n *= 1024 * 1024;
+	} else if (strncmp(end, "GiB", 3) == 0) {
+		n *= 1024 * 1024 * 1024ULL;
+	}
+	return n;
+}
+
+static bool starts_with(const char *str, const char *prefix, const char **rest)
+{
+	size_t len = strlen(prefix);
+	if (strncmp(str, prefix, len) != 0) {
+		return false;
+	}
+	*rest = str + len;
+	return true;
+}
+
+static void parse_fdinfo_key(struct fdinfo_client *client, const char *key,
+		const char *value)
+{
+	struct fdinfo_counter *counter;
+	const char *name;
+	if (strcmp(key, "drm-driver") == 0) {
+		snprintf(client->driver, sizeof(client->driver), "%s", value);
+	} else if (strcmp(key, "drm-pdev") == 0) {
+		snprintf(client->pdev, sizeof(client->pdev), "%s", value);
+	} else if (strcmp(key, "drm-client-id") == 0) {
+		client->id = strtoull(value, NULL, 10);
+	} else if (starts_with(key, "drm-engine-capacity-", &name)) {
+		if ((counter = get_counter(&client->engines, name))) {
+			counter->total = strtoull(value, NULL, 10);
+		}
+	} else if (starts_with(key, "drm-engine-", &name)) {
+		if ((counter = get_counter(&client->engines, name))) {
+			counter->value = strtoull(value, NULL, 10);
+		}
+	} else if (starts_with(key, "drm-total-cycles-", &name)) {
+		if ((counter = get_counter(&client->cycles, name))) {
+			counter->total = strtoull(value, NULL, 10);
+		}
+	} else if (starts_with(key, "drm-cycles-", &name)) {
+		if ((counter = get_counter(&client->cycles, name))) {
+			counter->value = strtoull(value, NULL, 10);
+		}
+	} else if (starts_with(key, "drm-memory-", &name) ||
+			starts_with(key, "drm-total-", &name) ||
+			starts_with(key, "drm-shared-", &name) ||
+			starts_with(key, "drm-resident-", &name) ||
+			starts_with(key, "drm-purgeable-", &name) ||
+			starts_with(key, "drm-active-", &name)) {
+		/* Keep the category, e.g. "resident-vram" */
+		if ((counter = get_counter(&client->memory, key + strlen("drm-")))) {
+			counter->value = parse_memory(value);
+		}
+	}
+}
+
+/* Returns false if the fd isn't a DRM client, e.g. on kernels without
+ * fdinfo support */
+static bool read_fdinfo(int fdinfo_dir, int fd, struct fdinfo_client *client)
+{
+	char name[16];
+	snprintf(name, sizeof(name), "%d", fd);
+	int info_fd = openat(fdinfo_dir, name, O_RDONLY | O_CLOEXEC);
+	if (info_fd < 0) {
+		return false;
+	}
+	char buf[4096];
+	ssize_t len = read(info_fd, buf, sizeof(buf) - 1);
+	close(info_fd);
+	if (len <= 0) {
+		return false;
+	}
+	buf[len] = '\0';
+
+	memset(client, 0, sizeof(*client));
+	bool has_id = false;
+	char *saveptr;
+	for (char *line = strtok_r(buf, "\n", &saveptr); line;
+			line = strtok_r(NULL, "\n", &saveptr)) {
+		char *sep = strchr(line, ':');
+		if (!sep) {
+			continue;
+		}
+		*sep = '\0';
+		char *value = sep + 1;
+		while (isspace((unsigned char)*value)) {
+			value++;
+		}
+		parse_fdinfo_key(client, line, value);
+		has_id = has_id || strcmp(line, "drm-client-id") == 0;
+	}
+	return has_id && client->pdev[0] != '\0';
+}
+
+static const struct proc_info *find_proc(const struct proc_table *table,
+		int pid)
+{
+	size_t lo = 0, hi = table ? table->len : 0;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (table->data[mid].pid == pid) {
+			return &table->data[mid];
+		} else if (table->data[mid].pid < pid) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return NULL;
+}
+
+static const struct proc_fd *find_fd(const struct proc_info *proc, int fd)
+{
+	size_t lo = 0, hi = proc ? proc->fds_len : 0;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (proc->fds[mid].fd == fd) {
+			return &proc->fds[mid];
+		} else if (proc->fds[mid].fd < fd) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return NULL;
+}
+
+static int int_cmp(const void *a_ptr, const void *b_ptr)
+{
+	int a = *(const int *)a_ptr, b = *(const int *)b_ptr;
+	return a < b ? -1 : a > b;
+}
+
+static void add_client(struct proc_info *proc,
+		const struct fdinfo_client *client)
+{
+	/* dup()ed fds share a client */
+	for (size_t i = 0; i < proc->clients_len; i++) {
+		if (proc->clients[i].id == client->id &&
+				strcmp(proc->clients[i].pdev, client->pdev) == 0) {
+			return;
+		}
+	}
+	struct fdinfo_client *clients = realloc(proc->clients,
+		(proc->clients_len + 1) * sizeof(*clients));
+	if (!clients) {
+		perror("realloc");
+		return;
+	}
+	proc->clients = clients;
+	proc->clients[proc->clients_len++] = *client;
+}
+
+static void scan_proc(const char *root, struct proc_info *proc,
+		const struct proc_info *prev)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/%d", root, proc->pid);
+	int pid_dir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (pid_dir < 0) {
+		return;
+	}
+	int fd_dir = openat(pid_dir, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	int fdinfo_dir = openat(pid_dir, "fdinfo", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd_dir < 0 || fdinfo_dir < 0) {
+		goto out;
+	}
+	/* fdopendir() takes ownership of its fd, fd_dir is still needed */
+	int dir_fd = dup(fd_dir);
+	DIR *dir = dir_fd >= 0 ? fdopendir(dir_fd) : NULL;
+	if (!dir) {
+		if (dir_fd >= 0) {
+			close(dir_fd);
+		}
+		goto out;
+	}
+
+	if (prev) {
+		memcpy(proc->comm, prev->comm, sizeof(proc->comm));
+	} else {
+		int comm_fd = openat(pid_dir, "comm", O_RDONLY | O_CLOEXEC);
+		ssize_t len = comm_fd >= 0 ?
+			read(comm_fd, proc->comm, sizeof(proc->comm) - 1) : -1;
+		if (comm_fd >= 0) {
+			close(comm_fd);
+		}
+		proc->comm[len > 0 ? len : 0] = '\0';
+		proc->comm[strcspn(proc->comm, "\n")] = '\0';
+	}
+
+	int *fds = NULL;
+	size_t fds_len = 0, fds_cap = 0;
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		if (!isdigit((unsigned char)ent->d_name[0])) {
+			continue;
+		}
+		if (fds_len == fds_cap) {
+			fds_cap = fds_cap ? 2 * fds_cap : 64;
+			int *new_fds = realloc(fds, fds_cap * sizeof(*fds));
+			if (!new_fds) {
+				perror("realloc");
+				break;
+			}
+			fds = new_fds;
+		}
+		fds[fds_len++] = atoi(ent->d_name);
+	}
+	closedir(dir);
+	qsort(fds, fds_len, sizeof(*fds), int_cmp);
+
+	proc->fds = calloc(fds_len, sizeof(*proc->fds));
+	if (!proc->fds) {
+		free(fds);
+		goto out;
+	}
+	for (size_t i = 0; i < fds_len; i++) {
+		struct proc_fd *pfd = &proc->fds[proc->fds_len++];
+		pfd->fd = fds[i];
+
+		const struct proc_fd *prev_fd = find_fd(prev, fds[i]);
+		if (prev_fd) {
+			pfd->drm = prev_fd->drm;
+		} else {
+			char name[16], target[64];
+			snprintf(name, sizeof(name), "%d", fds[i]);
+			ssize_t len = readlinkat(fd_dir, name, target, sizeof(target) - 1);
+			pfd->drm = len > 0 && strncmp(target, DRM_DIR_NAME "/",
+				strlen(DRM_DIR_NAME "/")) == 0;
+		}
+
+		struct fdinfo_client client;
+		if (pfd->drm && read_fdinfo(fdinfo_dir, fds[i], &client)) {
+			add_client(proc, &client);
+		}
+	}
+	free(fds);
+
+out:
+	if (fd_dir >= 0) {
+		close(fd_dir);
+	}
+	if (fdinfo_dir >= 0) {
+		close(fdinfo_dir);
+	}
+	close(pid_dir);
+}
+
+static void *scan_worker(void *data)
+{
+	struct scan_job *job = data;
+	for (size_t i = job->start; i < job->table->len; i += job->step) {
+		struct proc_info *proc = &job->table->data[i];
+		scan_proc(job->root, proc, find_proc(job->prev, proc->pid));
+	}
+	return NULL;
+}
+
+static bool scan(const char *root, struct proc_table *table,
+		const struct proc_table *prev)
+{
+	DIR *dir = opendir(root);
+	if (!dir) {
+		fprintf(stderr, "Failed to open %s: %s\n", root, strerror(errno));
+		return false;
+	}
+	size_t cap = 0;
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		if (!isdigit((unsigned char)ent->d_name[0])) {
+			continue;
+		}
+		if (table->len == cap) {
+			cap = cap ? 2 * cap : 256;
+			struct proc_info *data = realloc(table->data, cap * sizeof(*data));
+			if (!data) {
+				perror("realloc");
+				closedir(dir);
+				return false;
+			}
+			table->data = data;
+		}
+		table->data[table->len++] = (struct proc_info){
+			.pid = atoi(ent->d_name),
+		};
+	}
+	closedir(dir);
+	/* pid is the first member */
+	qsort(table->data, table->len, sizeof(*table->data), int_cmp);
+
+	long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads_len = nproc > 0 ? (size_t)nproc : 1;
+	if (threads_len > CLIENTS_MAX_THREADS) {
+		threads_len = CLIENTS_MAX_THREADS;
+	}
+	if (threads_len > table->len) {
+		threads_len = table->len;
+	}
+
+	pthread_t threads[CLIENTS_MAX_THREADS];
+	struct scan_job jobs[CLIENTS_MAX_THREADS];
+	bool started[CLIENTS_MAX_THREADS] = {0};
+	for (size_t i = 0; i < threads_len; i++) {
+		jobs[i] = (struct scan_job){
+			.root = root,
+			.table = table,
+			.prev = prev,
+			.start = i,
+			.step = threads_len,
+		};
+		/* The calling thread takes the first share */
+		started[i] = i > 0 &&
+			pthread_create(&threads[i], NULL, scan_worker, &jobs[i]) == 0;
+	}
+	for (size_t i = 0; i < threads_len; i++) {
+		if (!started[i]) {
+			scan_worker(&jobs[i]);
+		}
+	}
+	for (size_t i = 0; i < threads_len; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+	return true;
+}
+
+static void proc_table_finish(struct proc_table *table)
+{
+	for (size_t i = 0; i < table->len; i++) {
+		free(table->data[i].fds);
+		free(table->data[i].clients);
+	}
+	free(table->data);
+}
+
+static const struct fdinfo_client *find_client(const struct proc_info *proc,
+		const struct fdinfo_client *client)
+{
+	for (size_t i = 0; proc && i < proc->clients_len; i++) {
+		if (proc->clients[i].id == client->id &&
+				strcmp(proc->clients[i].pdev, client->pdev) == 0) {
+			return &proc->clients[i];
+		}
+	}
+	return NULL;
+}
+
+static const struct fdinfo_counter *find_counter(
+		const struct fdinfo_counters *counters, const char *name)
+{
+	for (size_t i = 0; counters && i < counters->len; i++) {
+		if (strcmp(counters->data[i].name, name) == 0) {
+			return &counters->data[i];
+		}
+	}
+	return NULL;
+}
+
+static uint64_t delta(uint64_t cur, uint64_t prev)
+{
+	return cur > prev ? cur - prev : 0;
+}
+
+static struct json_object *client_info(const struct proc_info *proc,
+		const struct fdinfo_client *client, const struct fdinfo_client *prev,
+		uint64_t interval_ns)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "pid", json_object_new_int(proc->pid));
+	json_object_object_add(obj, "comm", json_object_new_string(proc->comm));
+	json_object_object_add(obj, "id", json_object_new_uint64(client->id));
+	json_object_object_add(obj, "driver",
+		json_object_new_string(client->driver));
+
+	/* Clients which appeared during the interval have no utilization */
+	struct json_object *engines_obj = json_object_new_object();
+	for (size_t i = 0; i < client->engines.len; i++) {
+		const struct fdinfo_counter *cur = &client->engines.data[i];
+		const struct fdinfo_counter *old =
+			prev ? find_counter(&prev->engines, cur->name) : NULL;
+		uint64_t busy = old ? delta(cur->value, old->value) : 0;
+		uint64_t capacity = cur->total ? cur->total : 1;
+
+		struct json_object *engine_obj = json_object_new_object();
+		json_object_object_add(engine_obj, "busy_ns",
+			json_object_new_uint64(cur->value));
+		json_object_object_add(engine_obj, "capacity",
+			json_object_new_uint64(capacity));
+		json_object_object_add(engine_obj, "utilization", old ?
+			json_object_new_double((double)busy / (interval_ns * capacity)) : NULL);
+		json_object_object_add(engines_obj, cur->name, engine_obj);
+	}
+	json_object_object_add(obj, "engines", engines_obj);
+
+	struct json_object *cycles_obj = json_object_new_object();
+	for (size_t i = 0; i < client->cycles.len; i++) {
+		const struct fdinfo_counter *cur = &client->cycles.data[i];
+		const struct fdinfo_counter *old =
+			prev ? find_counter(&prev->cycles, cur->name) : NULL;
+		uint64_t total = old ? delta(cur->total, old->total) : 0;
+
+		struct json_object *counter_obj = json_object_new_object();
+		json_object_object_add(counter_obj, "cycles",
+			json_object_new_uint64(cur->value));
+		json_object_object_add(counter_obj, "total_cycles",
+			json_object_new_uint64(cur->total));
+		json_object_object_add(counter_obj, "utilization", total ?
+			json_object_new_double(
+				(double)delta(cur->value, old->value) / total) : NULL);
+		json_object_object_add(cycles_obj, cur->name, counter_obj);
+	}
+	json_object_object_add(obj, "cycles", cycles_obj);
+
+	struct json_object *memory_obj = json_object_new_object();
+	for (size_t i = 0; i < client->memory.len; i++) {
+		json_object_object_add(memory_obj, client->memory.data[i].name,
+			json_object_new_uint64(client->memory.data[i].value));
+	}
+	json_object_object_add(obj, "memory", memory_obj);
+
+	return obj;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct json_object *clients_info(struct json_object *drm_obj, const char *root)
+{
+	struct proc_table first = {0}, second = {0};
+	uint64_t start = now_ns();
+	if (!scan(root, &first, NULL)) {
+		proc_table_finish(&first);
+		return NULL;
+	}
+	struct timespec interval = {
+		.tv_sec = CLIENTS_INTERVAL_MS / 1000,
+		.tv_nsec = (CLIENTS_INTERVAL_MS % 1000) * 1000000,
+	};
+	nanosleep(&interval, NULL);
+	uint64_t interval_ns = now_ns() - start;
+	if (!scan(root, &second, &first)) {
+		proc_table_finish(&first);
+		proc_table_finish(&second);
+		return NULL;
+	}
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		/* Only PCI devices have a drm-pdev we can match */
+		struct json_object *device_obj = json_object_object_get(dev_obj, "device");
+		struct json_object *bus_obj = json_object_object_get(device_obj, "bus_data");
+		if (get_object_object_uint64(device_obj, "bus_type") != DRM_BUS_PCI ||
+				!bus_obj) {
+			continue;
+		}
+		char pdev[32];
+		snprintf(pdev, sizeof(pdev), "%04"PRIx64":%02"PRIx64":%02"PRIx64".%"PRIx64,
+			get_object_object_uint64(bus_obj, "domain"),
+			get_object_object_uint64(bus_obj, "bus"),
+			get_object_object_uint64(bus_obj, "slot"),
+			get_object_object_uint64(bus_obj, "function"));
+
+		struct json_object *clients_arr = json_object_new_array();
+		for (size_t i = 0; i < second.len; i++) {
+			const struct proc_info *proc = &second.data[i];
+			for (size_t j = 0; j < proc->clients_len; j++) {
+				const struct fdinfo_client *client = &proc->clients[j];
+				if (strcmp(client->pdev, pdev) != 0) {
+					continue;
+				}
+				const struct fdinfo_client *prev =
+					find_client(find_proc(&first, proc->pid), client);
+				json_object_array_add(clients_arr,
+					client_info(proc, client, prev, interval_ns));
+			}
+		}
+
+		struct json_object *node_obj = json_object_new_object();
+		json_object_object_add(node_obj, "pdev", json_object_new_string(pdev));
+		json_object_object_add(node_obj, "interval_ns",
+			json_object_new_uint64(interval_ns));
+		json_object_object_add(node_obj, "clients", clients_arr);
+		json_object_object_add(obj, path, node_obj);
+	}
+
+	proc_table_finish(&first);
+	proc_table_finish(&second);
+	return obj;
+}
+
+static void print_utilization(struct json_object *obj, const char *prefix,
+		const char *title, bool last)
+{
+	printf("%s%s%s:", prefix, last ? L_LAST : L_VAL, title);
+	bool first = true;
+	json_object_object_foreach(obj, name, counter_obj) {
+		printf("%s %s ", first ? "" : ",", name);
+		struct json_object *util_obj =
+			json_object_object_get(counter_obj, "utilization");
+		if (util_obj) {
+			printf("%.1f%%", 100 * json_object_get_double(util_obj));
+		} else {
+			printf("n/a");
+		}
+		first = false;
+	}
+	printf("%s\n", first ? " none" : "");
+}
+
+static void print_client(struct json_object *obj, const char *prefix)
+{
+	printf("%s (pid %"PRIu64", client %"PRIu64")\n",
+		json_object_get_string(json_object_object_get(obj, "comm")),
+		get_object_object_uint64(obj, "pid"),
+		get_object_object_uint64(obj, "id"));
+
+	struct json_object *engines_obj = json_object_object_get(obj, "engines");
+	print_utilization(engines_obj, prefix, "Engines", false);
+	struct json_object *cycles_obj = json_object_object_get(obj, "cycles");
+	if (json_object_object_length(cycles_obj) > 0) {
+		print_utilization(cycles_obj, prefix, "Cycles", false);
+	}
+
+	struct json_object *memory_obj = json_object_object_get(obj, "memory");
+	printf("%s" L_LAST "Memory:", prefix);
+	bool first = true;
+	json_object_object_foreach(memory_obj, name, size_obj) {
+		printf("%s %s ", first ? "" : ",", name);
+		print_size(json_object_get_uint64(size_obj));
+		first = false;
+	}
+	printf("%s\n", first ? " none" : "");
+}
+
+void print_clients(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, node_obj) {
+		printf("Node: %s (%s)\n", path, json_object_get_string(
+			json_object_object_get(node_obj, "pdev")));
+
+		struct json_object *clients_arr =
+			json_object_object_get(node_obj, "clients");
+		size_t clients_len = json_object_array_length(clients_arr);
+		if (clients_len == 0) {
+			printf(L_LAST "No clients\n");
+			continue;
+		}
+		for (size_t i = 0; i < clients_len; i++) {
+			bool last = i == clients_len - 1;
+			printf("%s", last ? L_LAST : L_VAL);
+			print_client(json_object_array_get_idx(clients_arr, i),
+				last ? L_GAP : L_LINE);
+		}
+	}
+}
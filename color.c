@@ -0,0 +1,332 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json_object.h>
+
+#include "color.h"
+#include "drm_info.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+/* Words per LUT entry: red, green, blue, reserved */
+#define LUT_STRIDE 4
+/* A channel matches a reference curve if it is never further than this from
+ * it, about one step of an 8-bit LUT */
+#define LUT_TOLERANCE 0x100
+
+enum lut_curve {
+	LUT_CURVE_LINEAR,
+	LUT_CURVE_SRGB_EOTF,
+	LUT_CURVE_SRGB_INV_EOTF,
+	LUT_CURVE_COUNT,
+};
+
+static const char *const curve_keys[] = {
+	[LUT_CURVE_LINEAR] = "linear",
+	[LUT_CURVE_SRGB_EOTF] = "srgb_eotf",
+	[LUT_CURVE_SRGB_INV_EOTF] = "srgb_inv_eotf",
+};
+
+static const char *const curve_names[] = {
+	[LUT_CURVE_LINEAR] = "linear",
+	[LUT_CURVE_SRGB_EOTF] = "sRGB EOTF",
+	[LUT_CURVE_SRGB_INV_EOTF] = "sRGB inverse EOTF",
+};
+
+static const char *const channel_keys[] = { "red", "green", "blue" };
+static const char *const channel_names[] = { "Red", "Green", "Blue" };
+
+/* Per-lane accumulators, lane 3 (the reserved word) is ignored */
+struct lut_stats {
+	uint16_t min[LUT_STRIDE], max[LUT_STRIDE];
+	uint16_t error[LUT_CURVE_COUNT][LUT_STRIDE];
+	uint16_t decreasing[LUT_STRIDE];
+};
+
+/* Reference curves are laid out like the LUT so they can be compared lane
+ * by lane. All CRTCs of a device usually share a LUT size, so only the last
+ * one is kept. */
+static struct {
+	size_t len;
+	uint16_t *curves[LUT_CURVE_COUNT];
+} ref_cache;
+
+static double srgb_eotf(double x)
+{
+	return x <= 0.04045 ? x / 12.92 : pow((x + 0.055) / 1.055, 2.4);
+}
+
+static double srgb_inv_eotf(double x)
+{
+	return x <= 0.0031308 ? x * 12.92 : 1.055 * pow(x, 1 / 2.4) - 0.055;
+}
+
+static bool reference_curves(size_t len)
+{
+	if (ref_cache.len == len) {
+		return true;
+	}
+
+	uint16_t *data = malloc(LUT_CURVE_COUNT * len * LUT_STRIDE * sizeof(*data));
+	if (!data) {
+		perror("malloc");
+		return false;
+	}
+	free(ref_cache.curves[0]);
+	for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+		ref_cache.curves[k] = &data[k * len * LUT_STRIDE];
+	}
+	ref_cache.len = len;
+
+	for (size_t i = 0; i < len; i++) {
+		double x = len > 1 ? (double)i / (len - 1) : 0;
+		double y[LUT_CURVE_COUNT] = {
+			[LUT_CURVE_LINEAR] = x,
+			[LUT_CURVE_SRGB_EOTF] = srgb_eotf(x),
+			[LUT_CURVE_SRGB_INV_EOTF] = srgb_inv_eotf(x),
+		};
+		for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+			uint16_t *entry = &ref_cache.curves[k][i * LUT_STRIDE];
+			entry[0] = entry[1] = entry[2] = lround(y[k] * 0xFFFF);
+			entry[3] = 0;
+		}
+	}
+	return true;
+}
+
+static void stats_scalar(struct lut_stats *stats, const uint16_t *lut,
+		size_t start, size_t end)
+{
+	for (size_t i = start * LUT_STRIDE; i < end * LUT_STRIDE; i++) {
+		size_t c = i % LUT_STRIDE;
+		uint16_t v = lut[i];
+		if (v < stats->min[c]) {
+			stats->min[c] = v;
+		}
+		if (v > stats->max[c]) {
+			stats->max[c] = v;
+		}
+		if (i >= LUT_STRIDE && v < lut[i - LUT_STRIDE]) {
+			stats->decreasing[c] = 1;
+		}
+		for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+			uint16_t ref = ref_cache.curves[k][i];
+			uint16_t error = v > ref ? v - ref : ref - v;
+			if (error > stats->error[k][c]) {
+				stats->error[k][c] = error;
+			}
+		}
+	}
+}
+
+#ifdef HAVE_X86_SIMD
+static void merge_lanes(uint16_t acc[static LUT_STRIDE], const uint16_t *lanes,
+		size_t n, bool use_min)
+{
+	for (size_t j = 0; j < n; j++) {
+		uint16_t *a = &acc[j % LUT_STRIDE];
+		if (use_min ? lanes[j] < *a : lanes[j] > *a) {
+			*a = lanes[j];
+		}
+	}
+}
+
+/* Four entries per iteration. Each entry is compared against the previous
+ * one by loading the same data again one entry earlier. */
+__attribute__((target("avx2")))
+static void stats_avx2(struct lut_stats *stats, const uint16_t *lut, size_t len)
+{
+	stats_scalar(stats, lut, 0, 1);
+
+	__m256i min = _mm256_set1_epi16(-1);
+	__m256i max = _mm256_setzero_si256();
+	__m256i decreasing = _mm256_setzero_si256();
+	__m256i error[LUT_CURVE_COUNT];
+	for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+		error[k] = _mm256_setzero_si256();
+	}
+
+	size_t i = 1;
+	for (; i + 4 <= len; i += 4) {
+		const uint16_t *p = &lut[i * LUT_STRIDE];
+		__m256i cur = _mm256_loadu_si256((const __m256i *)p);
+		__m256i prev = _mm256_loadu_si256((const __m256i *)(p - LUT_STRIDE));
+
+		min = _mm256_min_epu16(min, cur);
+		max = _mm256_max_epu16(max, cur);
+		/* prev > cur iff max(prev, cur) != cur */
+		__m256i ordered = _mm256_cmpeq_epi16(_mm256_max_epu16(prev, cur), cur);
+		decreasing = _mm256_or_si256(decreasing,
+			_mm256_andnot_si256(ordered, _mm256_set1_epi16(1)));
+
+		for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+			__m256i ref = _mm256_loadu_si256(
+				(const __m256i *)&ref_cache.curves[k][i * LUT_STRIDE]);
+			__m256i diff = _mm256_or_si256(_mm256_subs_epu16(cur, ref),
+				_mm256_subs_epu16(ref, cur));
+			error[k] = _mm256_max_epu16(error[k], diff);
+		}
+	}
+
+	uint16_t lanes[16];
+	_mm256_storeu_si256((__m256i *)lanes, min);
+	merge_lanes(stats->min, lanes, 16, true);
+	_mm256_storeu_si256((__m256i *)lanes, max);
+	merge_lanes(stats->max, lanes, 16, false);
+	_mm256_storeu_si256((__m256i *)lanes, decreasing);
+	merge_lanes(stats->decreasing, lanes, 16, false);
+	for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+		_mm256_storeu_si256((__m256i *)lanes, error[k]);
+		merge_lanes(stats->error[k], lanes, 16, false);
+	}
+
+	stats_scalar(stats, lut, i, len);
+}
+#endif
+
+static void lut_stats(struct lut_stats *stats, const uint16_t *lut, size_t len)
+{
+	memset(stats, 0, sizeof(*stats));
+	memset(stats->min, 0xFF, sizeof(stats->min));
+
+#ifdef HAVE_X86_SIMD
+	if (__builtin_cpu_supports("avx2")) {
+		stats_avx2(stats, lut, len);
+		return;
+	}
+#endif
+	stats_scalar(stats, lut, 0, len);
+}
+
+static uint16_t max_error(const struct lut_stats *stats, enum lut_curve curve)
+{
+	uint16_t error = 0;
+	for (size_t c = 0; c < 3; c++) {
+		if (stats->error[curve][c] > error) {
+			error = stats->error[curve][c];
+		}
+	}
+	return error;
+}
+
+struct json_object *lut_to_json(const uint16_t *lut, size_t len)
+{
+	if (len == 0 || !reference_curves(len)) {
+		return NULL;
+	}
+
+	struct lut_stats stats;
+	lut_stats(&stats, lut, len);
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "size", json_object_new_uint64(len));
+
+	const char *shape = "custom";
+	uint16_t best = LUT_TOLERANCE + 1;
+	struct json_object *error_obj = json_object_new_object();
+	for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+		uint16_t error = max_error(&stats, k);
+		json_object_object_add(error_obj, curve_keys[k],
+			json_object_new_uint64(error));
+		if (error < best) {
+			best = error;
+			shape = curve_keys[k];
+		}
+	}
+	json_object_object_add(obj, "shape", json_object_new_string(shape));
+	json_object_object_add(obj, "identity",
+		json_object_new_boolean(strcmp(shape, "linear") == 0));
+	json_object_object_add(obj, "max_error", error_obj);
+
+	struct json_object *channels_obj = json_object_new_object();
+	for (size_t c = 0; c < 3; c++) {
+		struct json_object *channel_obj = json_object_new_object();
+		json_object_object_add(channel_obj, "min",
+			json_object_new_uint64(stats.min[c]));
+		json_object_object_add(channel_obj, "max",
+			json_object_new_uint64(stats.max[c]));
+		json_object_object_add(channel_obj, "monotonic",
+			json_object_new_boolean(!stats.decreasing[c]));
+		json_object_object_add(channels_obj, channel_keys[c], channel_obj);
+	}
+	json_object_object_add(obj, "channels", channels_obj);
+
+	return obj;
+}
+
+struct json_object *ctm_to_json(const uint64_t matrix[static 9])
+{
+	struct json_object *obj = json_object_new_object();
+	struct json_object *matrix_arr = json_object_new_array();
+	bool identity = true;
+	for (size_t i = 0; i < 9; i++) {
+		double coeff = (double)(matrix[i] & ~(1ULL << 63)) / (1ULL << 32);
+		if (matrix[i] >> 63) {
+			coeff = -coeff;
+		}
+		identity = identity && coeff == (i % 4 == 0 ? 1 : 0);
+		json_object_array_add(matrix_arr, json_object_new_double(coeff));
+	}
+	json_object_object_add(obj, "matrix", matrix_arr);
+	json_object_object_add(obj, "identity", json_object_new_boolean(identity));
+	return obj;
+}
+
+void print_lut(struct json_object *obj, const char *prefix)
+{
+	const char *shape = json_object_get_string(
+		json_object_object_get(obj, "shape"));
+	for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+		if (strcmp(shape, curve_keys[k]) == 0) {
+			shape = curve_names[k];
+		}
+	}
+	printf("%s" L_VAL "Size: %"PRIu64", shape: %s\n", prefix,
+		get_object_object_uint64(obj, "size"), shape);
+
+	struct json_object *error_obj = json_object_object_get(obj, "max_error");
+	printf("%s" L_VAL "Max deviation:", prefix);
+	for (size_t k = 0; k < LUT_CURVE_COUNT; k++) {
+		printf("%s %s %"PRIu64, k == 0 ? "" : ",", curve_names[k],
+			get_object_object_uint64(error_obj, curve_keys[k]));
+	}
+	printf("\n");
+
+	struct json_object *channels_obj = json_object_object_get(obj, "channels");
+	for (size_t c = 0; c < 3; c++) {
+		struct json_object *channel_obj =
+			json_object_object_get(channels_obj, channel_keys[c]);
+		bool monotonic = json_object_get_boolean(
+			json_object_object_get(channel_obj, "monotonic"));
+		printf("%s%s%s: %"PRIu64"-%"PRIu64"%s\n", prefix,
+			c == 2 ? L_LAST : L_VAL, channel_names[c],
+			get_object_object_uint64(channel_obj, "min"),
+			get_object_object_uint64(channel_obj, "max"),
+			monotonic ? "" : ", not monotonic");
+	}
+}
+
+void print_ctm(struct json_object *obj, const char *prefix)
+{
+	if (json_object_get_boolean(json_object_object_get(obj, "identity"))) {
+		printf("%s" L_LAST "Identity\n", prefix);
+		return;
+	}
+
+	struct json_object *matrix_arr = json_object_object_get(obj, "matrix");
+	for (size_t row = 0; row < 3; row++) {
+		printf("%s%s", prefix, row == 2 ? L_LAST : L_VAL);
+		for (size_t col = 0; col < 3; col++) {
+			printf("%s%9.6f", col == 0 ? "" : " ", json_object_get_double(
+				json_object_array_get_idx(matrix_arr, row * 3 + col)));
+		}
+		printf("\n");
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct json_object;
+
+/* Summarizes a LUT of len entries laid out like struct drm_color_lut: red,
+ * green, blue and a reserved word per entry. Rather than listing every
+ * entry, the summary has per-channel ranges and monotonicity, and the
+ * largest deviation from a linear ramp and from the sRGB transfer
+ * functions. */
+struct json_object *lut_to_json(const uint16_t *lut, size_t len);
+/* Decodes the S31.32 sign-magnitude coefficients of a struct drm_color_ctm */
+struct json_object *ctm_to_json(const uint64_t matrix[static 9]);
+
+void print_lut(struct json_object *obj, const char *prefix);
+void print_ctm(struct json_object *obj, const char *prefix);
+
+#endif
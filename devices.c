@@ -0,0 +1,221 @@
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <xf86drm.h>
+
+#include "devices.h"
+#include "drm_info.h"
+
+/* drmGetDevices() fills a caller-sized array and walks sysfs again for each
+ * call. Here /sys/class/drm is read once into a growable array, and only
+ * the three symlinks describing each node are resolved, in parallel, so
+ * that hosts with hundreds of nodes enumerate quickly. */
+
+#define DEVICES_MAX_THREADS 8
+
+static const struct {
+	const char *prefix;
+	int type;
+} node_prefixes[] = {
+	{ "card", DRM_NODE_PRIMARY },
+	{ "controlD", DRM_NODE_CONTROL },
+	{ "renderD", DRM_NODE_RENDER },
+};
+
+/* Connectors such as "card0-DP-1" share the directory, node names are a
+ * prefix followed by the minor number only */
+static bool parse_node_name(const char *name, int *type, unsigned *minor)
+{
+	size_t prefixes_len = sizeof(node_prefixes) / sizeof(node_prefixes[0]);
+	for (size_t i = 0; i < prefixes_len; i++) {
+		size_t len = strlen(node_prefixes[i].prefix);
+		if (strncmp(name, node_prefixes[i].prefix, len) != 0 ||
+				name[len] < '0' || name[len] > '9') {
+			continue;
+		}
+		char *end;
+		unsigned long val = strtoul(name + len, &end, 10);
+		if (*end != '\0') {
+			return false;
+		}
+		*type = node_prefixes[i].type;
+		*minor = val;
+		return true;
+	}
+	return false;
+}
+
+/* Copies the last component of a symlink target, e.g. "pci" from
+ * "../../../bus/pci". Leaves buf empty if it doesn't fit. */
+static void read_link_base(int dir_fd, const char *path, char *buf,
+		size_t size)
+{
+	char target[PATH_MAX];
+	buf[0] = '\0';
+	ssize_t len = readlinkat(dir_fd, path, target, sizeof(target) - 1);
+	if (len < 0) {
+		return;
+	}
+	target[len] = '\0';
+	const char *base = strrchr(target, '/');
+	base = base ? base + 1 : target;
+	size_t base_len = strlen(base);
+	if (base_len >= size) {
+		return;
+	}
+	memcpy(buf, base, base_len + 1);
+}
+
+struct resolve_job {
+	int class_fd;
+	struct drm_node *nodes;
+	size_t len, start, step;
+};
+
+static void *resolve_worker(void *data)
+{
+	struct resolve_job *job = data;
+	for (size_t i = job->start; i < job->len; i += job->step) {
+		struct drm_node *node = &job->nodes[i];
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/device", node->name);
+		read_link_base(job->class_fd, path, node->bus_id, sizeof(node->bus_id));
+		snprintf(path, sizeof(path), "%s/device/subsystem", node->name);
+		read_link_base(job->class_fd, path, node->bus, sizeof(node->bus));
+		snprintf(path, sizeof(path), "%s/device/driver", node->name);
+		read_link_base(job->class_fd, path, node->driver, sizeof(node->driver));
+	}
+	return NULL;
+}
+
+static void resolve_nodes(int class_fd, struct drm_node *nodes, size_t len)
+{
+	long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads_len = nproc > 0 ? (size_t)nproc : 1;
+	if (threads_len > DEVICES_MAX_THREADS) {
+		threads_len = DEVICES_MAX_THREADS;
+	}
+	/* Not worth a thread for a handful of nodes */
+	if (threads_len > len / 16 + 1) {
+		threads_len = len / 16 + 1;
+	}
+
+	pthread_t threads[DEVICES_MAX_THREADS];
+	struct resolve_job jobs[DEVICES_MAX_THREADS];
+	bool started[DEVICES_MAX_THREADS] = {0};
+	for (size_t i = 0; i < threads_len; i++) {
+		jobs[i] = (struct resolve_job){
+			.class_fd = class_fd,
+			.nodes = nodes,
+			.len = len,
+			.start = i,
+			.step = threads_len,
+		};
+		/* The calling thread takes the first share */
+		started[i] = i > 0 &&
+			pthread_create(&threads[i], NULL, resolve_worker, &jobs[i]) == 0;
+	}
+	for (size_t i = 0; i < threads_len; i++) {
+		if (!started[i]) {
+			resolve_worker(&jobs[i]);
+		}
+	}
+	for (size_t i = 0; i < threads_len; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+}
+
+static bool matches(const struct drm_node *node,
+		const struct drm_filter *filter)
+{
+	if (!filter) {
+		return true;
+	}
+	if (filter->driver && strcmp(node->driver, filter->driver) != 0) {
+		return false;
+	}
+	if (filter->bus && strcmp(node->bus, filter->bus) != 0 &&
+			strncmp(node->bus_id, filter->bus, strlen(filter->bus)) != 0) {
+		return false;
+	}
+	return true;
+}
+
+static int node_cmp(const void *a_ptr, const void *b_ptr)
+{
+	const struct drm_node *a = a_ptr, *b = b_ptr;
+	return a->minor < b->minor ? -1 : a->minor > b->minor;
+}
+
+struct drm_node *drm_nodes_list(const char *root, int type,
+		const struct drm_filter *filter, size_t *len)
+{
+	char class_path[PATH_MAX];
+	snprintf(class_path, sizeof(class_path), "%s/class/drm", root);
+
+	DIR *dir = opendir(class_path);
+	if (!dir) {
+		perror(class_path);
+		return NULL;
+	}
+
+	struct drm_node *nodes = NULL;
+	size_t nodes_len = 0, nodes_cap = 0;
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		int node_type;
+		unsigned minor;
+		size_t name_len = strlen(ent->d_name);
+		if (name_len >= sizeof(nodes->name) ||
+				!parse_node_name(ent->d_name, &node_type, &minor) ||
+				node_type != type) {
+			continue;
+		}
+		if (nodes_len == nodes_cap) {
+			nodes_cap = nodes_cap ? 2 * nodes_cap : 16;
+			struct drm_node *new_nodes =
+				realloc(nodes, nodes_cap * sizeof(*nodes));
+			if (!new_nodes) {
+				perror("realloc");
+				free(nodes);
+				closedir(dir);
+				return NULL;
+			}
+			nodes = new_nodes;
+		}
+		struct drm_node *node = &nodes[nodes_len++];
+		*node = (struct drm_node){
+			.type = node_type,
+			.minor = minor,
+		};
+		memcpy(node->name, ent->d_name, name_len + 1);
+	}
+
+	if (nodes_len > 0) {
+		resolve_nodes(dirfd(dir), nodes, nodes_len);
+		qsort(nodes, nodes_len, sizeof(*nodes), node_cmp);
+	}
+	closedir(dir);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < nodes_len; i++) {
+		if (matches(&nodes[i], filter)) {
+			nodes[kept++] = nodes[i];
+		}
+	}
+
+	*len = kept;
+	/* Callers may iterate over an empty list */
+	if (!nodes) {
+		nodes = calloc(1, sizeof(*nodes));
+	}
+	return nodes;
+}
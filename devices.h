@@ -0,0 +1,24 @@
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#include <stddef.h>
+
+struct drm_filter;
+
+struct drm_node {
+	char name[32]; /* e.g. "card0" */
+	int type; /* DRM_NODE_* */
+	unsigned minor;
+	char driver[64]; /* empty if no driver is bound */
+	char bus[32]; /* subsystem, e.g. "pci" or "platform" */
+	char bus_id[64]; /* e.g. "0000:03:00.0" */
+};
+
+/* Lists the nodes of the given type under <root>/class/drm which match
+ * filter, sorted by minor number. Nothing is opened in /dev, and the bus
+ * and driver of each node are resolved concurrently. Returns NULL on
+ * error, the array must be freed by the caller. */
+struct drm_node *drm_nodes_list(const char *root, int type,
+	const struct drm_filter *filter, size_t *len);
+
+#endif
@@ -0,0 +1,304 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <drm_fourcc.h>
+#include <json_object.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+#include "tables.h"
+
+/* Checks a dump for settings known to cost display performance. Each rule
+ * applies to one kind of object, and every object of a device is visited
+ * once, running all rules of its kind. Adding a check means adding a
+ * function and a line to doctor_rules[]. */
+
+enum doctor_scope {
+	DOCTOR_DEVICE,
+	DOCTOR_CONNECTOR,
+	DOCTOR_CRTC,
+	DOCTOR_PLANE,
+};
+
+static const char *const doctor_scope_names[] = {
+	[DOCTOR_DEVICE] = "device",
+	[DOCTOR_CONNECTOR] = "connector",
+	[DOCTOR_CRTC] = "crtc",
+	[DOCTOR_PLANE] = "plane",
+};
+
+enum doctor_severity {
+	DOCTOR_INFO,
+	DOCTOR_WARNING,
+};
+
+static const char *const doctor_severity_names[] = {
+	[DOCTOR_INFO] = "info",
+	[DOCTOR_WARNING] = "warning",
+};
+
+struct doctor_device {
+	struct json_object *caps_obj;
+	struct json_object *client_caps_obj;
+	struct json_object *encoders_arr;
+	struct json_object *crtcs_arr;
+};
+
+/* Returns true and describes the problem in msg if obj has it */
+typedef bool (*doctor_check)(const struct doctor_device *dev,
+	struct json_object *obj, char *msg, size_t size);
+
+static uint64_t prop_value(struct json_object *obj, const char *name)
+{
+	struct json_object *props_obj = json_object_object_get(obj, "properties");
+	return get_object_object_uint64(
+		json_object_object_get(props_obj, name), "value");
+}
+
+static bool has_prop(struct json_object *obj, const char *name)
+{
+	struct json_object *props_obj = json_object_object_get(obj, "properties");
+	return json_object_object_get(props_obj, name) != NULL;
+}
+
+static bool check_async_page_flip(const struct doctor_device *dev,
+		struct json_object *obj, char *msg, size_t size)
+{
+	(void)obj;
+	if (get_object_object_uint64(dev->caps_obj, "ASYNC_PAGE_FLIP")) {
+		return false;
+	}
+	snprintf(msg, size, "legacy async page flips are not supported, "
+		"tearing flips wait for vblank");
+	return true;
+}
+
+static bool check_atomic_async_page_flip(const struct doctor_device *dev,
+		struct json_object *obj, char *msg, size_t size)
+{
+	(void)obj;
+	struct json_object *atomic_obj =
+		json_object_object_get(dev->client_caps_obj, "ATOMIC");
+	if (!json_object_get_boolean(atomic_obj) ||
+			get_object_object_uint64(dev->caps_obj, "ATOMIC_ASYNC_PAGE_FLIP")) {
+		return false;
+	}
+	snprintf(msg, size, "atomic async page flips are not supported, "
+		"atomic compositors can't tear");
+	return true;
+}
+
+static bool check_vrr_disabled(const struct doctor_device *dev,
+		struct json_object *obj, char *msg, size_t size)
+{
+	if (get_object_object_uint64(obj, "status") != DRM_MODE_CONNECTED ||
+			!prop_value(obj, "vrr_capable")) {
+		return false;
+	}
+
+	uint64_t crtc_id = prop_value(obj, "CRTC_ID");
+	if (!crtc_id) {
+		struct json_object *enc_obj = find_by_id(dev->encoders_arr,
+			get_object_object_uint64(obj, "encoder_id"));
+		crtc_id = get_object_object_uint64(enc_obj, "crtc_id");
+	}
+	struct json_object *crtc_obj = find_by_id(dev->crtcs_arr, crtc_id);
+	if (!crtc_obj || !has_prop(crtc_obj, "VRR_ENABLED") ||
+			prop_value(crtc_obj, "VRR_ENABLED")) {
+		return false;
+	}
+	snprintf(msg, size, "VRR capable, but VRR_ENABLED is off on CRTC %"PRIu64,
+		crtc_id);
+	return true;
+}
+
+static bool check_refresh_mismatch(const struct doctor_device *dev,
+		struct json_object *obj, char *msg, size_t size)
+{
+	(void)dev;
+	struct json_object *mode_obj = json_object_object_get(obj, "mode");
+	if (!mode_obj) {
+		return false;
+	}
+	double refresh = mode_refresh_rate(mode_obj);
+	uint64_t vrefresh = get_object_object_uint64(mode_obj, "vrefresh");
+	if (fabs(refresh - vrefresh) < 0.5) {
+		return false;
+	}
+	snprintf(msg, size, "mode %s refreshes at %.3f Hz, but claims %"PRIu64" Hz",
+		get_object_object_string(mode_obj, "name"), refresh, vrefresh);
+	return true;
+}
+
+static bool check_linear_scanout(const struct doctor_device *dev,
+		struct json_object *obj, char *msg, size_t size)
+{
+	(void)dev;
+	struct json_object *fb_obj = json_object_object_get(obj, "fb");
+	struct json_object *modifier_obj = json_object_object_get(fb_obj, "modifier");
+	if (!modifier_obj ||
+			json_object_get_uint64(modifier_obj) != DRM_FORMAT_MOD_LINEAR) {
+		return false;
+	}
+
+	uint32_t format = get_object_object_uint64(fb_obj, "format");
+	struct json_object *props_obj = json_object_object_get(obj, "properties");
+	struct json_object *in_formats_arr = json_object_object_get(
+		json_object_object_get(props_obj, "IN_FORMATS"), "data");
+	for (size_t i = 0; i < json_object_array_length(in_formats_arr); i++) {
+		struct json_object *mod_obj = json_object_array_get_idx(in_formats_arr, i);
+		uint64_t mod = get_object_object_uint64(mod_obj, "modifier");
+		if (mod == DRM_FORMAT_MOD_LINEAR || mod == DRM_FORMAT_MOD_INVALID) {
+			continue;
+		}
+		struct json_object *formats_arr =
+			json_object_object_get(mod_obj, "formats");
+		for (size_t j = 0; j < json_object_array_length(formats_arr); j++) {
+			if (json_object_get_uint64(
+					json_object_array_get_idx(formats_arr, j)) != format) {
+				continue;
+			}
+			const char *mod_str = basic_modifier_str(mod);
+			snprintf(msg, size, "%s framebuffer %"PRIu64" is LINEAR, "
+				"but the plane also accepts %s", format_str(format),
+				get_object_object_uint64(fb_obj, "id"),
+				mod_str ? mod_str : "a tiled modifier");
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool check_cursor_size(const struct doctor_device *dev,
+		struct json_object *obj, char *msg, size_t size)
+{
+	struct json_object *fb_obj = json_object_object_get(obj, "fb");
+	if (!fb_obj || prop_value(obj, "type") != DRM_PLANE_TYPE_CURSOR) {
+		return false;
+	}
+	uint64_t max_width = get_object_object_uint64(dev->caps_obj, "CURSOR_WIDTH");
+	uint64_t max_height =
+		get_object_object_uint64(dev->caps_obj, "CURSOR_HEIGHT");
+	uint64_t width = get_object_object_uint64(fb_obj, "width");
+	uint64_t height = get_object_object_uint64(fb_obj, "height");
+	if (max_width == 0 || max_height == 0 ||
+			(width <= max_width && height <= max_height)) {
+		return false;
+	}
+	snprintf(msg, size, "cursor framebuffer is %"PRIu64"x%"PRIu64", "
+		"larger than the %"PRIu64"x%"PRIu64" the driver advertises",
+		width, height, max_width, max_height);
+	return true;
+}
+
+static const struct {
+	const char *name;
+	enum doctor_scope scope;
+	enum doctor_severity severity;
+	doctor_check check;
+} doctor_rules[] = {
+	{ "async-page-flip", DOCTOR_DEVICE, DOCTOR_INFO, check_async_page_flip },
+	{ "atomic-async-page-flip", DOCTOR_DEVICE, DOCTOR_INFO,
+		check_atomic_async_page_flip },
+	{ "vrr-disabled", DOCTOR_CONNECTOR, DOCTOR_INFO, check_vrr_disabled },
+	{ "refresh-mismatch", DOCTOR_CRTC, DOCTOR_WARNING, check_refresh_mismatch },
+	{ "linear-scanout", DOCTOR_PLANE, DOCTOR_WARNING, check_linear_scanout },
+	{ "cursor-size", DOCTOR_PLANE, DOCTOR_WARNING, check_cursor_size },
+};
+
+#define DOCTOR_RULES (sizeof(doctor_rules) / sizeof(doctor_rules[0]))
+
+static void run_rules(const struct doctor_device *dev, enum doctor_scope scope,
+		struct json_object *obj, struct json_object *findings_arr)
+{
+	char msg[256];
+	for (size_t i = 0; i < DOCTOR_RULES; i++) {
+		if (doctor_rules[i].scope != scope ||
+				!doctor_rules[i].check(dev, obj, msg, sizeof(msg))) {
+			continue;
+		}
+		struct json_object *finding_obj = json_object_new_object();
+		json_object_object_add(finding_obj, "rule",
+			json_object_new_string(doctor_rules[i].name));
+		json_object_object_add(finding_obj, "severity", json_object_new_string(
+			doctor_severity_names[doctor_rules[i].severity]));
+		json_object_object_add(finding_obj, "object",
+			json_object_new_string(doctor_scope_names[scope]));
+		if (scope != DOCTOR_DEVICE) {
+			json_object_object_add(finding_obj, "id", json_object_new_uint64(
+				get_object_object_uint64(obj, "id")));
+		}
+		json_object_object_add(finding_obj, "message",
+			json_object_new_string(msg));
+		json_object_array_add(findings_arr, finding_obj);
+	}
+}
+
+static void run_rules_array(const struct doctor_device *dev,
+		enum doctor_scope scope, struct json_object *arr,
+		struct json_object *findings_arr)
+{
+	for (size_t i = 0; i < json_object_array_length(arr); i++) {
+		run_rules(dev, scope, json_object_array_get_idx(arr, i), findings_arr);
+	}
+}
+
+struct json_object *doctor_info(struct json_object *drm_obj)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		struct json_object *driver_obj =
+			json_object_object_get(dev_obj, "driver");
+		struct doctor_device dev = {
+			.caps_obj = json_object_object_get(driver_obj, "caps"),
+			.client_caps_obj = json_object_object_get(driver_obj, "client_caps"),
+			.encoders_arr = json_object_object_get(dev_obj, "encoders"),
+			.crtcs_arr = json_object_object_get(dev_obj, "crtcs"),
+		};
+
+		struct json_object *findings_arr = json_object_new_array();
+		run_rules(&dev, DOCTOR_DEVICE, dev_obj, findings_arr);
+		run_rules_array(&dev, DOCTOR_CONNECTOR,
+			json_object_object_get(dev_obj, "connectors"), findings_arr);
+		run_rules_array(&dev, DOCTOR_CRTC, dev.crtcs_arr, findings_arr);
+		run_rules_array(&dev, DOCTOR_PLANE,
+			json_object_object_get(dev_obj, "planes"), findings_arr);
+
+		struct json_object *dev_doctor_obj = json_object_new_object();
+		json_object_object_add(dev_doctor_obj, "rules",
+			json_object_new_uint64(DOCTOR_RULES));
+		json_object_object_add(dev_doctor_obj, "findings", findings_arr);
+		json_object_object_add(obj, path, dev_doctor_obj);
+	}
+	return obj;
+}
+
+void print_doctor(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, dev_obj) {
+		printf("Node: %s\n", path);
+
+		struct json_object *findings_arr =
+			json_object_object_get(dev_obj, "findings");
+		size_t findings_len = json_object_array_length(findings_arr);
+		printf("%s%"PRIu64" rules checked, %zu findings\n",
+			findings_len ? L_VAL : L_LAST,
+			get_object_object_uint64(dev_obj, "rules"), findings_len);
+		for (size_t i = 0; i < findings_len; i++) {
+			struct json_object *finding_obj =
+				json_object_array_get_idx(findings_arr, i);
+			printf("%s%s: ", i == findings_len - 1 ? L_LAST : L_VAL,
+				get_object_object_string(finding_obj, "severity"));
+			if (json_object_object_get(finding_obj, "id")) {
+				printf("%s %"PRIu64": ",
+					get_object_object_string(finding_obj, "object"),
+					get_object_object_uint64(finding_obj, "id"));
+			}
+			printf("%s (%s)\n",
+				get_object_object_string(finding_obj, "message"),
+				get_object_object_string(finding_obj, "rule"));
+		}
+	}
+}
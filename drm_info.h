@@ -1,12 +1,78 @@
 #ifndef DRM_INFO_H
 #define DRM_INFO_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 struct json_object;
 
-struct json_object *egl_info(char *paths[]);
-struct json_object *drm_info(char *paths[]);
+/* Restricts which devices are listed, NULL fields match anything */
+struct drm_filter {
+	const char *driver;
+	/* Bus type, e.g. "pci", or bus ID prefix, e.g. "0000:03:" */
+	const char *bus;
+};
+
+struct json_object *egl_info(char *paths[], bool gl);
+struct json_object *drm_info(char *paths[], const struct drm_filter *filter,
+	bool blobs);
 void print_drm(struct json_object *obj);
+/* Refresh rate of a mode object in Hz, computed from its timings */
+double mode_refresh_rate(struct json_object *mode_obj);
 void print_egl(struct json_object *obj);
+struct json_object *scanout_info(struct json_object *drm_obj,
+	uint32_t format, uint64_t modifier);
+void print_scanout(struct json_object *obj);
+struct json_object *zero_copy_info(struct json_object *drm_obj,
+	struct json_object *egl_obj);
+void print_zero_copy(struct json_object *obj);
+struct json_object *prime_info(struct json_object *drm_obj,
+	struct json_object *egl_obj);
+void print_prime(struct json_object *obj);
+struct json_object *sysfs_info(const char *root, char *paths[]);
+void print_sysfs(struct json_object *obj);
+struct json_object *vblank_record(struct json_object *drm_obj, size_t samples);
+struct json_object *vblank_info(struct json_object *rec_obj);
+void print_vblank(struct json_object *obj);
+struct json_object *trace_info(struct json_object *drm_obj, const char *path,
+	unsigned seconds);
+void print_trace(struct json_object *obj);
+struct json_object *clients_info(struct json_object *drm_obj, const char *root);
+void print_clients(struct json_object *obj);
+struct json_object *sample_info(const char *root, char *paths[],
+	unsigned rate_hz, unsigned seconds);
+void print_samples(struct json_object *obj);
+struct json_object *probe_info(struct json_object *drm_obj, bool live);
+void print_probe(struct json_object *obj);
+struct json_object *bandwidth_info(struct json_object *drm_obj);
+void print_bandwidth(struct json_object *obj);
+struct json_object *plane_usage_info(struct json_object *drm_obj);
+void print_plane_usage(struct json_object *obj);
+struct json_object *doctor_info(struct json_object *drm_obj);
+void print_doctor(struct json_object *obj);
+struct json_object *plan_info(struct json_object *drm_obj, const char *spec);
+void print_plan(struct json_object *obj);
+struct json_object *routing_info(struct json_object *drm_obj);
+void print_routing(struct json_object *obj);
+
+/* Accessors for the objects built by drm_info(), returning NULL or 0 if
+ * the key is missing */
+const char *get_object_object_string(struct json_object *obj,
+	const char *key);
+uint64_t get_object_object_uint64(struct json_object *obj, const char *key);
+double get_object_object_double(struct json_object *obj, const char *key);
+/* Returns the element of arr with the given "id", or NULL */
+struct json_object *find_by_id(struct json_object *arr, uint64_t id);
+const char *plane_type_str(uint64_t type);
+/* Prints a byte count in KiB, MiB or GiB */
+void print_size(uint64_t bytes);
+
+/* Tree drawing for pretty-printers */
+#define L_LINE "│   "
+#define L_VAL  "├───"
+#define L_LAST "└───"
+#define L_GAP  "    "
 
 /* according to CTA 861.G */
 enum {
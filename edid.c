@@ -0,0 +1,707 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <json_object.h>
+
+#include "drm_info.h"
+#include "edid.h"
+
+#define EDID_BLOCK_SIZE 128
+#define EDID_DESCRIPTOR_SIZE 18
+
+static const uint8_t edid_header[] = {
+	0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00,
+};
+
+static bool block_checksum(const uint8_t *block)
+{
+	uint8_t sum = 0;
+	for (size_t i = 0; i < EDID_BLOCK_SIZE; i++) {
+		sum += block[i];
+	}
+	return sum == 0;
+}
+
+static void add_timing(struct edid *edid, const struct edid_timing *timing)
+{
+	if (edid->timings_len < EDID_MAX_TIMINGS) {
+		edid->timings[edid->timings_len++] = *timing;
+	}
+}
+
+/* Returns false for unused descriptors, which have a zero pixel clock */
+static bool parse_detailed_timing(struct edid_timing *t, const uint8_t *d,
+		enum edid_timing_source source)
+{
+	uint16_t pixel_clock = d[0] | d[1] << 8;
+	if (pixel_clock == 0) {
+		return false;
+	}
+
+	uint16_t hblank = d[3] | (d[4] & 0x0F) << 8;
+	uint16_t vblank = d[6] | (d[7] & 0x0F) << 8;
+	uint16_t hsync_offset = d[8] | (d[11] & 0xC0) << 2;
+	uint16_t hsync_width = d[9] | (d[11] & 0x30) << 4;
+	uint16_t vsync_offset = d[10] >> 4 | (d[11] & 0x0C) << 2;
+	uint16_t vsync_width = (d[10] & 0x0F) | (d[11] & 0x03) << 4;
+
+	*t = (struct edid_timing){
+		.source = source,
+		.pixel_clock_khz = pixel_clock * 10,
+		.hdisplay = d[2] | (d[4] & 0xF0) << 4,
+		.vdisplay = d[5] | (d[7] & 0xF0) << 4,
+		.interlaced = d[17] & 0x80,
+	};
+	t->hsync_start = t->hdisplay + hsync_offset;
+	t->hsync_end = t->hsync_start + hsync_width;
+	t->htotal = t->hdisplay + hblank;
+	t->vsync_start = t->vdisplay + vsync_offset;
+	t->vsync_end = t->vsync_start + vsync_width;
+	t->vtotal = t->vdisplay + vblank;
+	return true;
+}
+
+/* Descriptor text is terminated by a newline and padded with spaces */
+static void parse_descriptor_string(const uint8_t *d, const char **str,
+		size_t *len)
+{
+	const char *text = (const char *)&d[5];
+	size_t n = 0;
+	while (n < 13 && text[n] != '\n') {
+		n++;
+	}
+	while (n > 0 && text[n - 1] == ' ') {
+		n--;
+	}
+	*str = text;
+	*len = n;
+}
+
+static void parse_range_limits(struct edid_range *range, const uint8_t *d,
+		bool edid_1_4)
+{
+	uint8_t offsets = edid_1_4 ? d[4] : 0;
+	range->present = true;
+	range->min_vrefresh = d[5] + (offsets & 0x01 ? 255 : 0);
+	range->max_vrefresh = d[6] + (offsets & 0x02 ? 255 : 0);
+	range->min_hfreq = d[7] + (offsets & 0x04 ? 255 : 0);
+	range->max_hfreq = d[8] + (offsets & 0x08 ? 255 : 0);
+	range->max_pixel_clock = d[9] * 10;
+}
+
+static void parse_descriptor(struct edid *edid, const uint8_t *d)
+{
+	struct edid_timing timing;
+	if (parse_detailed_timing(&timing, d, EDID_TIMING_BASE)) {
+		add_timing(edid, &timing);
+		return;
+	}
+
+	switch (d[3]) {
+	case 0xFC:
+		parse_descriptor_string(d, &edid->name, &edid->name_len);
+		break;
+	case 0xFF:
+		parse_descriptor_string(d, &edid->serial_str, &edid->serial_str_len);
+		break;
+	case 0xFD:
+		parse_range_limits(&edid->range, d,
+			edid->version == 1 && edid->revision >= 4);
+		break;
+	}
+}
+
+static void parse_cta_vendor_block(struct edid *edid, const uint8_t *p,
+		size_t len)
+{
+	if (len < 3) {
+		return;
+	}
+	uint32_t oui = p[0] | p[1] << 8 | p[2] << 16;
+	/* HDMI Forum VSDB, the VRR range is in payload bytes 8 and 9 */
+	if (oui == 0xC45DD8 && len >= 10) {
+		uint16_t vrr_min = p[8] & 0x3F;
+		uint16_t vrr_max = (p[8] & 0xC0) << 2 | p[9];
+		if (vrr_min || vrr_max) {
+			edid->cta.vrr.present = true;
+			edid->cta.vrr.min_vrefresh = vrr_min;
+			edid->cta.vrr.max_vrefresh = vrr_max;
+		}
+	}
+}
+
+static void parse_cta_extended_block(struct edid *edid, const uint8_t *p,
+		size_t len)
+{
+	if (len < 1) {
+		return;
+	}
+	uint8_t ext_tag = p[0];
+	p++;
+	len--;
+
+	switch (ext_tag) {
+	case 0x05: /* Colorimetry */
+		if (len >= 2) {
+			edid->cta.colorimetry = p[0] | p[1] << 8;
+		}
+		break;
+	case 0x06: /* HDR static metadata */
+		if (len < 2) {
+			break;
+		}
+		edid->cta.hdr.present = true;
+		edid->cta.hdr.eotfs = p[0];
+		edid->cta.hdr.metadata_types = p[1];
+		edid->cta.hdr.max_luminance = len >= 3 ? p[2] : 0;
+		edid->cta.hdr.max_frame_avg = len >= 4 ? p[3] : 0;
+		edid->cta.hdr.min_luminance = len >= 5 ? p[4] : 0;
+		break;
+	}
+}
+
+static void parse_cta(struct edid *edid, const uint8_t *block)
+{
+	edid->cta.present = true;
+	edid->cta.revision = block[1];
+
+	uint8_t dtd_offset = block[2];
+	if (edid->cta.revision >= 2) {
+		edid->cta.underscan = block[3] & 0x80;
+		edid->cta.basic_audio = block[3] & 0x40;
+		edid->cta.ycbcr444 = block[3] & 0x20;
+		edid->cta.ycbcr422 = block[3] & 0x10;
+	}
+	/* The last byte is the checksum */
+	if (dtd_offset < 4 || dtd_offset > EDID_BLOCK_SIZE - 1) {
+		return;
+	}
+
+	/* Data block collection, only present since revision 3 */
+	size_t i = 4;
+	while (edid->cta.revision >= 3 && i < dtd_offset) {
+		uint8_t tag = block[i] >> 5;
+		size_t len = block[i] & 0x1F;
+		const uint8_t *p = &block[i + 1];
+		if (i + 1 + len > dtd_offset) {
+			break;
+		}
+
+		switch (tag) {
+		case 2: /* Video */
+			for (size_t j = 0; j < len && edid->cta.vics_len < EDID_MAX_VICS; j++) {
+				/* Bit 7 marks native modes for VICs 1-64 */
+				uint8_t vic = p[j];
+				if ((vic & 0x7F) >= 1 && (vic & 0x7F) <= 64) {
+					vic &= 0x7F;
+				}
+				edid->cta.vics[edid->cta.vics_len++] = vic;
+			}
+			break;
+		case 3:
+			parse_cta_vendor_block(edid, p, len);
+			break;
+		case 7:
+			parse_cta_extended_block(edid, p, len);
+			break;
+		}
+
+		i += 1 + len;
+	}
+
+	for (i = dtd_offset; i + EDID_DESCRIPTOR_SIZE <= EDID_BLOCK_SIZE - 1;
+			i += EDID_DESCRIPTOR_SIZE) {
+		struct edid_timing timing;
+		if (!parse_detailed_timing(&timing, &block[i], EDID_TIMING_CTA)) {
+			break;
+		}
+		add_timing(edid, &timing);
+	}
+}
+
+static uint32_t le24(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | (uint32_t)p[2] << 16;
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+/* Type I (DisplayID 1.x) and Type VII (DisplayID 2.x) detailed timings
+ * share a layout, only the pixel clock unit differs */
+static void parse_displayid_timings(struct edid *edid, const uint8_t *p,
+		size_t len, uint32_t clock_unit_khz)
+{
+	for (size_t i = 0; i + 20 <= len; i += 20) {
+		const uint8_t *d = &p[i];
+		struct edid_timing t = {
+			.source = EDID_TIMING_DISPLAYID,
+			.pixel_clock_khz = (le24(d) + 1) * clock_unit_khz,
+			.interlaced = d[3] & 0x10,
+			.hdisplay = le16(&d[4]) + 1,
+			.vdisplay = le16(&d[12]) + 1,
+		};
+		t.htotal = t.hdisplay + le16(&d[6]) + 1;
+		t.hsync_start = t.hdisplay + (le16(&d[8]) & 0x7FFF) + 1;
+		t.hsync_end = t.hsync_start + le16(&d[10]) + 1;
+		t.vtotal = t.vdisplay + le16(&d[14]) + 1;
+		t.vsync_start = t.vdisplay + (le16(&d[16]) & 0x7FFF) + 1;
+		t.vsync_end = t.vsync_start + le16(&d[18]) + 1;
+		add_timing(edid, &t);
+	}
+}
+
+static void parse_displayid(struct edid *edid, const uint8_t *block)
+{
+	/* The section starts after the extension tag and ends before the
+	 * block checksum */
+	const uint8_t *section = &block[1];
+	size_t section_len = section[1];
+	if (5 + section_len > EDID_BLOCK_SIZE - 1) {
+		return;
+	}
+
+	edid->displayid.present = true;
+	edid->displayid.version = section[0];
+
+	size_t i = 4;
+	while (i + 3 <= 4 + section_len) {
+		uint8_t tag = section[i];
+		uint8_t rev = section[i + 1] & 0x07;
+		size_t len = section[i + 2];
+		const uint8_t *p = &section[i + 3];
+		if (i + 3 + len > 4 + section_len) {
+			break;
+		}
+		if (tag == 0 && len == 0) {
+			/* Padding */
+			break;
+		}
+
+		switch (tag) {
+		case 0x03:
+			parse_displayid_timings(edid, p, len, 10);
+			break;
+		case 0x22:
+			parse_displayid_timings(edid, p, len, 1);
+			break;
+		case 0x09: /* Video timing range limits */
+			if (len >= 15) {
+				edid->displayid.range.present = true;
+				edid->displayid.range.max_pixel_clock = le24(&p[3]) / 100;
+				edid->displayid.range.min_hfreq = p[6];
+				edid->displayid.range.max_hfreq = p[7];
+				edid->displayid.range.min_vrefresh = p[10];
+				edid->displayid.range.max_vrefresh = p[11];
+			}
+			break;
+		case 0x25: /* Dynamic video timing range limits */
+			if (len >= 9) {
+				edid->displayid.range.present = true;
+				edid->displayid.range.max_pixel_clock = le24(&p[3]) / 1000;
+				edid->displayid.range.min_vrefresh = p[6];
+				edid->displayid.range.max_vrefresh = p[7] |
+					(rev >= 1 ? (p[8] & 0x03) << 8 : 0);
+			}
+			break;
+		}
+
+		i += 3 + len;
+	}
+}
+
+bool edid_parse(struct edid *edid, const uint8_t *data, size_t len)
+{
+	memset(edid, 0, sizeof(*edid));
+	if (len < EDID_BLOCK_SIZE ||
+			memcmp(data, edid_header, sizeof(edid_header)) != 0) {
+		return false;
+	}
+
+	edid->checksum_valid = block_checksum(data);
+
+	uint16_t mfg = data[8] << 8 | data[9];
+	edid->manufacturer[0] = '@' + ((mfg >> 10) & 0x1F);
+	edid->manufacturer[1] = '@' + ((mfg >> 5) & 0x1F);
+	edid->manufacturer[2] = '@' + (mfg & 0x1F);
+	edid->product = le16(&data[10]);
+	edid->serial = le16(&data[12]) | (uint32_t)le16(&data[14]) << 16;
+	edid->week = data[16];
+	edid->year = 1990 + data[17];
+	edid->version = data[18];
+	edid->revision = data[19];
+
+	edid->digital = data[20] & 0x80;
+	uint8_t bpc = (data[20] >> 4) & 0x07;
+	if (edid->digital && edid->version == 1 && edid->revision >= 4 &&
+			bpc >= 1 && bpc <= 6) {
+		edid->bpc = 4 + 2 * bpc;
+	}
+	edid->width_cm = data[21];
+	edid->height_cm = data[22];
+
+	for (size_t i = 0; i < 4; i++) {
+		parse_descriptor(edid, &data[0x36 + i * EDID_DESCRIPTOR_SIZE]);
+	}
+
+	edid->extensions = data[0x7E];
+	for (size_t i = 1; i <= edid->extensions; i++) {
+		if ((i + 1) * EDID_BLOCK_SIZE > len) {
+			break;
+		}
+		const uint8_t *block = &data[i * EDID_BLOCK_SIZE];
+		switch (block[0]) {
+		case 0x02:
+			parse_cta(edid, block);
+			break;
+		case 0x70:
+			parse_displayid(edid, block);
+			break;
+		}
+	}
+
+	return true;
+}
+
+static struct json_object *new_string_len(const char *str, size_t len)
+{
+	return str ? json_object_new_string_len(str, len) : NULL;
+}
+
+static struct json_object *range_to_json(const struct edid_range *range)
+{
+	if (!range->present) {
+		return NULL;
+	}
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "min_vrefresh",
+		json_object_new_uint64(range->min_vrefresh));
+	json_object_object_add(obj, "max_vrefresh",
+		json_object_new_uint64(range->max_vrefresh));
+	if (range->min_hfreq || range->max_hfreq) {
+		json_object_object_add(obj, "min_hfreq_khz",
+			json_object_new_uint64(range->min_hfreq));
+		json_object_object_add(obj, "max_hfreq_khz",
+			json_object_new_uint64(range->max_hfreq));
+	}
+	if (range->max_pixel_clock) {
+		json_object_object_add(obj, "max_pixel_clock_mhz",
+			json_object_new_uint64(range->max_pixel_clock));
+	}
+	return obj;
+}
+
+static const char *timing_source_str(enum edid_timing_source source)
+{
+	switch (source) {
+	case EDID_TIMING_BASE:
+		return "base";
+	case EDID_TIMING_CTA:
+		return "cta";
+	case EDID_TIMING_DISPLAYID:
+		return "displayid";
+	}
+	return "unknown";
+}
+
+static struct json_object *timing_to_json(const struct edid_timing *t)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "source",
+		json_object_new_string(timing_source_str(t->source)));
+	json_object_object_add(obj, "clock",
+		json_object_new_uint64(t->pixel_clock_khz));
+	json_object_object_add(obj, "hdisplay", json_object_new_uint64(t->hdisplay));
+	json_object_object_add(obj, "hsync_start",
+		json_object_new_uint64(t->hsync_start));
+	json_object_object_add(obj, "hsync_end", json_object_new_uint64(t->hsync_end));
+	json_object_object_add(obj, "htotal", json_object_new_uint64(t->htotal));
+	json_object_object_add(obj, "vdisplay", json_object_new_uint64(t->vdisplay));
+	json_object_object_add(obj, "vsync_start",
+		json_object_new_uint64(t->vsync_start));
+	json_object_object_add(obj, "vsync_end", json_object_new_uint64(t->vsync_end));
+	json_object_object_add(obj, "vtotal", json_object_new_uint64(t->vtotal));
+	json_object_object_add(obj, "interlaced",
+		json_object_new_boolean(t->interlaced));
+	return obj;
+}
+
+/* CTA-861.3 coded luminance values */
+static double max_luminance(uint8_t cv)
+{
+	return 50.0 * pow(2.0, cv / 32.0);
+}
+
+struct json_object *edid_to_json(const uint8_t *data, size_t len)
+{
+	struct edid edid;
+	if (!edid_parse(&edid, data, len)) {
+		return NULL;
+	}
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "checksum_valid",
+		json_object_new_boolean(edid.checksum_valid));
+	json_object_object_add(obj, "manufacturer",
+		json_object_new_string(edid.manufacturer));
+	json_object_object_add(obj, "product", json_object_new_uint64(edid.product));
+	json_object_object_add(obj, "serial", json_object_new_uint64(edid.serial));
+	json_object_object_add(obj, "week", json_object_new_uint64(edid.week));
+	json_object_object_add(obj, "year", json_object_new_uint64(edid.year));
+	json_object_object_add(obj, "version", json_object_new_uint64(edid.version));
+	json_object_object_add(obj, "revision",
+		json_object_new_uint64(edid.revision));
+	json_object_object_add(obj, "name",
+		new_string_len(edid.name, edid.name_len));
+	json_object_object_add(obj, "serial_string",
+		new_string_len(edid.serial_str, edid.serial_str_len));
+	json_object_object_add(obj, "digital", json_object_new_boolean(edid.digital));
+	json_object_object_add(obj, "bpc",
+		edid.bpc ? json_object_new_uint64(edid.bpc) : NULL);
+	json_object_object_add(obj, "width_cm", json_object_new_uint64(edid.width_cm));
+	json_object_object_add(obj, "height_cm",
+		json_object_new_uint64(edid.height_cm));
+	json_object_object_add(obj, "range", range_to_json(&edid.range));
+	json_object_object_add(obj, "extensions",
+		json_object_new_uint64(edid.extensions));
+
+	struct json_object *timings_arr = json_object_new_array();
+	for (size_t i = 0; i < edid.timings_len; i++) {
+		json_object_array_add(timings_arr, timing_to_json(&edid.timings[i]));
+	}
+	json_object_object_add(obj, "timings", timings_arr);
+
+	struct json_object *cta_obj = NULL;
+	if (edid.cta.present) {
+		cta_obj = json_object_new_object();
+		json_object_object_add(cta_obj, "revision",
+			json_object_new_uint64(edid.cta.revision));
+		json_object_object_add(cta_obj, "underscan",
+			json_object_new_boolean(edid.cta.underscan));
+		json_object_object_add(cta_obj, "basic_audio",
+			json_object_new_boolean(edid.cta.basic_audio));
+		json_object_object_add(cta_obj, "ycbcr444",
+			json_object_new_boolean(edid.cta.ycbcr444));
+		json_object_object_add(cta_obj, "ycbcr422",
+			json_object_new_boolean(edid.cta.ycbcr422));
+
+		struct json_object *vics_arr = json_object_new_array();
+		for (size_t i = 0; i < edid.cta.vics_len; i++) {
+			json_object_array_add(vics_arr,
+				json_object_new_uint64(edid.cta.vics[i]));
+		}
+		json_object_object_add(cta_obj, "vics", vics_arr);
+		json_object_object_add(cta_obj, "colorimetry",
+			json_object_new_uint64(edid.cta.colorimetry));
+
+		struct json_object *hdr_obj = NULL;
+		if (edid.cta.hdr.present) {
+			hdr_obj = json_object_new_object();
+			json_object_object_add(hdr_obj, "eotfs",
+				json_object_new_uint64(edid.cta.hdr.eotfs));
+			json_object_object_add(hdr_obj, "metadata_types",
+				json_object_new_uint64(edid.cta.hdr.metadata_types));
+			uint8_t max_cv = edid.cta.hdr.max_luminance;
+			uint8_t min_cv = edid.cta.hdr.min_luminance;
+			json_object_object_add(hdr_obj, "max_luminance", max_cv ?
+				json_object_new_double(max_luminance(max_cv)) : NULL);
+			json_object_object_add(hdr_obj, "max_frame_avg_luminance",
+				edid.cta.hdr.max_frame_avg ? json_object_new_double(
+					max_luminance(edid.cta.hdr.max_frame_avg)) : NULL);
+			json_object_object_add(hdr_obj, "min_luminance",
+				max_cv && min_cv ? json_object_new_double(max_luminance(max_cv) *
+					(min_cv / 255.0) * (min_cv / 255.0) / 100.0) : NULL);
+		}
+		json_object_object_add(cta_obj, "hdr_static_metadata", hdr_obj);
+		json_object_object_add(cta_obj, "vrr", range_to_json(&edid.cta.vrr));
+	}
+	json_object_object_add(obj, "cta", cta_obj);
+
+	struct json_object *displayid_obj = NULL;
+	if (edid.displayid.present) {
+		displayid_obj = json_object_new_object();
+		json_object_object_add(displayid_obj, "version",
+			json_object_new_uint64(edid.displayid.version));
+		json_object_object_add(displayid_obj, "range",
+			range_to_json(&edid.displayid.range));
+	}
+	json_object_object_add(obj, "displayid", displayid_obj);
+
+	return obj;
+}
+
+static void print_range(struct json_object *obj)
+{
+	printf("%"PRIu64"-%"PRIu64" Hz",
+		get_object_object_uint64(obj, "min_vrefresh"),
+		get_object_object_uint64(obj, "max_vrefresh"));
+	if (json_object_object_get(obj, "min_hfreq_khz")) {
+		printf(", %"PRIu64"-%"PRIu64" kHz",
+			get_object_object_uint64(obj, "min_hfreq_khz"),
+			get_object_object_uint64(obj, "max_hfreq_khz"));
+	}
+	if (json_object_object_get(obj, "max_pixel_clock_mhz")) {
+		printf(", max %"PRIu64" MHz",
+			get_object_object_uint64(obj, "max_pixel_clock_mhz"));
+	}
+	printf("\n");
+}
+
+static void print_timing(struct json_object *obj)
+{
+	uint64_t clock = get_object_object_uint64(obj, "clock");
+	uint64_t htotal = get_object_object_uint64(obj, "htotal");
+	uint64_t vtotal = get_object_object_uint64(obj, "vtotal");
+	double refresh = htotal && vtotal ?
+		clock * 1000.0 / (htotal * vtotal) : 0;
+	bool interlaced = json_object_get_boolean(
+		json_object_object_get(obj, "interlaced"));
+	if (interlaced) {
+		refresh *= 2;
+	}
+
+	printf("%"PRIu64"x%"PRIu64"%s@%.02f %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64
+		" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" (%s)\n",
+		get_object_object_uint64(obj, "hdisplay"),
+		get_object_object_uint64(obj, "vdisplay"),
+		interlaced ? "i" : "", refresh,
+		get_object_object_uint64(obj, "hdisplay"),
+		get_object_object_uint64(obj, "hsync_start"),
+		get_object_object_uint64(obj, "hsync_end"), htotal,
+		get_object_object_uint64(obj, "vdisplay"),
+		get_object_object_uint64(obj, "vsync_start"),
+		get_object_object_uint64(obj, "vsync_end"), vtotal,
+		get_object_object_string(obj, "source"));
+}
+
+static void print_cta(struct json_object *obj, const char *prefix)
+{
+	printf("%s" L_VAL "CTA-861 revision %"PRIu64":", prefix,
+		get_object_object_uint64(obj, "revision"));
+	static const char *const flags[] = {
+		"underscan", "basic_audio", "ycbcr444", "ycbcr422",
+	};
+	for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+		if (json_object_get_boolean(json_object_object_get(obj, flags[i]))) {
+			printf(" %s", flags[i]);
+		}
+	}
+	printf("\n");
+
+	struct json_object *vics_arr = json_object_object_get(obj, "vics");
+	printf("%s" L_LINE L_VAL "VICs:", prefix);
+	for (size_t i = 0; i < json_object_array_length(vics_arr); i++) {
+		printf(" %"PRIu64, json_object_get_uint64(
+			json_object_array_get_idx(vics_arr, i)));
+	}
+	if (json_object_array_length(vics_arr) == 0) {
+		printf(" none");
+	}
+	printf("\n");
+
+	struct json_object *vrr_obj = json_object_object_get(obj, "vrr");
+	if (vrr_obj) {
+		printf("%s" L_LINE L_VAL "VRR: ", prefix);
+		print_range(vrr_obj);
+	}
+
+	struct json_object *hdr_obj =
+		json_object_object_get(obj, "hdr_static_metadata");
+	if (!hdr_obj) {
+		printf("%s" L_LINE L_LAST "HDR static metadata: none\n", prefix);
+		return;
+	}
+
+	static const char *const eotfs[] = {
+		[CTA_EOTF_TRADITIONAL_SDR] = "SDR",
+		[CTA_EOTF_TRADITIONAL_HDR] = "traditional HDR",
+		[CTA_EOTF_SMPTE_2084] = "PQ",
+		[CTA_EOTF_HLG] = "HLG",
+	};
+	uint64_t eotf_mask = get_object_object_uint64(hdr_obj, "eotfs");
+	printf("%s" L_LINE L_LAST "HDR static metadata: EOTFs", prefix);
+	for (size_t i = 0; i < sizeof(eotfs) / sizeof(eotfs[0]); i++) {
+		if (eotf_mask & (1 << i)) {
+			printf(" %s", eotfs[i]);
+		}
+	}
+	if (json_object_object_get(hdr_obj, "max_luminance")) {
+		printf(", max %.0f cd/m²",
+			get_object_object_double(hdr_obj, "max_luminance"));
+	}
+	if (json_object_object_get(hdr_obj, "max_frame_avg_luminance")) {
+		printf(", max frame-average %.0f cd/m²",
+			get_object_object_double(hdr_obj, "max_frame_avg_luminance"));
+	}
+	if (json_object_object_get(hdr_obj, "min_luminance")) {
+		printf(", min %.4f cd/m²",
+			get_object_object_double(hdr_obj, "min_luminance"));
+	}
+	printf("\n");
+}
+
+void print_edid(struct json_object *obj, const char *prefix)
+{
+	const char *name = get_object_object_string(obj, "name");
+	printf("%s" L_VAL "Monitor: %s 0x%04"PRIx64"%s%s", prefix,
+		get_object_object_string(obj, "manufacturer"),
+		get_object_object_uint64(obj, "product"),
+		name ? " " : "", name ? name : "");
+	const char *serial = get_object_object_string(obj, "serial_string");
+	if (serial) {
+		printf(", serial %s", serial);
+	}
+	printf(", %"PRIu64"\n", get_object_object_uint64(obj, "year"));
+
+	printf("%s" L_VAL "EDID %"PRIu64".%"PRIu64", %s", prefix,
+		get_object_object_uint64(obj, "version"),
+		get_object_object_uint64(obj, "revision"),
+		json_object_get_boolean(json_object_object_get(obj, "digital")) ?
+			"digital" : "analog");
+	if (json_object_object_get(obj, "bpc")) {
+		printf(", %"PRIu64" bpc", get_object_object_uint64(obj, "bpc"));
+	}
+	printf(", %"PRIu64"x%"PRIu64" cm", get_object_object_uint64(obj, "width_cm"),
+		get_object_object_uint64(obj, "height_cm"));
+	if (!json_object_get_boolean(
+			json_object_object_get(obj, "checksum_valid"))) {
+		printf(", bad checksum");
+	}
+	printf("\n");
+
+	struct json_object *range_obj = json_object_object_get(obj, "range");
+	if (range_obj) {
+		printf("%s" L_VAL "Range limits: ", prefix);
+		print_range(range_obj);
+	}
+
+	struct json_object *cta_obj = json_object_object_get(obj, "cta");
+	if (cta_obj) {
+		print_cta(cta_obj, prefix);
+	}
+
+	struct json_object *displayid_obj = json_object_object_get(obj, "displayid");
+	if (displayid_obj) {
+		uint64_t version = get_object_object_uint64(displayid_obj, "version");
+		printf("%s" L_VAL "DisplayID %"PRIu64".%"PRIu64"\n", prefix,
+			version >> 4, version & 0xF);
+		range_obj = json_object_object_get(displayid_obj, "range");
+		if (range_obj) {
+			printf("%s" L_LINE L_LAST "Range limits: ", prefix);
+			print_range(range_obj);
+		}
+	}
+
+	struct json_object *timings_arr = json_object_object_get(obj, "timings");
+	size_t timings_len = json_object_array_length(timings_arr);
+	printf("%s" L_LAST "Detailed timings:%s\n", prefix,
+		timings_len == 0 ? " none" : "");
+	for (size_t i = 0; i < timings_len; i++) {
+		printf("%s" L_GAP "%s", prefix, i == timings_len - 1 ? L_LAST : L_VAL);
+		print_timing(json_object_array_get_idx(timings_arr, i));
+	}
+}
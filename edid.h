@@ -0,0 +1,86 @@
+#ifndef EDID_H
+#define EDID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct json_object;
+
+#define EDID_MAX_TIMINGS 32
+#define EDID_MAX_VICS 64
+
+enum edid_timing_source {
+	EDID_TIMING_BASE,
+	EDID_TIMING_CTA,
+	EDID_TIMING_DISPLAYID,
+};
+
+struct edid_timing {
+	enum edid_timing_source source;
+	uint32_t pixel_clock_khz;
+	uint16_t hdisplay, hsync_start, hsync_end, htotal;
+	uint16_t vdisplay, vsync_start, vsync_end, vtotal;
+	bool interlaced;
+};
+
+struct edid_range {
+	bool present;
+	uint16_t min_vrefresh, max_vrefresh; /* Hz */
+	uint16_t min_hfreq, max_hfreq; /* kHz */
+	uint16_t max_pixel_clock; /* MHz, 0 if unknown */
+};
+
+/* Decoded EDID. Strings point into the parsed buffer and are not
+ * NUL-terminated. */
+struct edid {
+	bool checksum_valid;
+	char manufacturer[4];
+	uint16_t product;
+	uint32_t serial;
+	uint8_t week;
+	uint16_t year;
+	uint8_t version, revision;
+	bool digital;
+	uint8_t bpc; /* 0 if unknown */
+	uint8_t width_cm, height_cm;
+	const char *name, *serial_str;
+	size_t name_len, serial_str_len;
+	struct edid_range range;
+	uint8_t extensions;
+
+	struct edid_timing timings[EDID_MAX_TIMINGS];
+	size_t timings_len;
+
+	struct {
+		bool present;
+		uint8_t revision;
+		bool underscan, basic_audio, ycbcr444, ycbcr422;
+		uint8_t vics[EDID_MAX_VICS];
+		size_t vics_len;
+		uint16_t colorimetry; /* Colorimetry Data Block bits */
+		struct {
+			bool present;
+			uint8_t eotfs; /* bit n is CTA_EOTF n */
+			uint8_t metadata_types;
+			/* Coded values, 0 if absent */
+			uint8_t max_luminance, max_frame_avg, min_luminance;
+		} hdr;
+		struct edid_range vrr; /* HDMI Forum VSDB */
+	} cta;
+
+	struct {
+		bool present;
+		uint8_t version;
+		struct edid_range range;
+	} displayid;
+};
+
+/* Parses the base block and the CTA-861 and DisplayID extensions directly
+ * from data, without allocating. Returns false if data isn't an EDID. */
+bool edid_parse(struct edid *edid, const uint8_t *data, size_t len);
+
+struct json_object *edid_to_json(const uint8_t *data, size_t len);
+void print_edid(struct json_object *obj, const char *prefix);
+
+#endif
@@ -1,16 +1,82 @@
+// libEGL is loaded on demand so that plain KMS dumps don't pay for it.
+#define EGL_EGL_PROTOTYPES 0
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
-#include <GL/gl.h>
-#include <assert.h>
+#include <dlfcn.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "drm_info.h"
 #include "modifiers.h"
 #include "tables.h"
 #include <json.h>
 #include <json_object.h>
 
+// eglInitialize can hang on a broken driver, give up on a device after this.
+#define EGL_DEVICE_TIMEOUT_MS 10000
+
+static PFNEGLGETPROCADDRESSPROC eglGetProcAddress;
+static PFNEGLGETERRORPROC eglGetError;
+static PFNEGLGETPLATFORMDISPLAYPROC eglGetPlatformDisplay;
+static PFNEGLINITIALIZEPROC eglInitialize;
+static PFNEGLTERMINATEPROC eglTerminate;
+static PFNEGLQUERYSTRINGPROC eglQueryString;
+static PFNEGLBINDAPIPROC eglBindAPI;
+static PFNEGLGETCONFIGSPROC eglGetConfigs;
+static PFNEGLCREATECONTEXTPROC eglCreateContext;
+static PFNEGLDESTROYCONTEXTPROC eglDestroyContext;
+static PFNEGLMAKECURRENTPROC eglMakeCurrent;
+static PFNEGLRELEASETHREADPROC eglReleaseThread;
+// Only glGetString is needed, don't pull in the GL headers for it
+#define GL_RENDERER 0x1F01
+static const unsigned char *(*glGetString)(unsigned int name);
+
+static bool load_egl(void) {
+  void *lib = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+  if (!lib) {
+    fprintf(stderr, "failed to load libEGL: %s\n", dlerror());
+    return false;
+  }
+
+  eglGetProcAddress =
+      (PFNEGLGETPROCADDRESSPROC)dlsym(lib, "eglGetProcAddress");
+  if (!eglGetProcAddress) {
+    fprintf(stderr, "failed to load libEGL: %s\n", dlerror());
+    dlclose(lib);
+    return false;
+  }
+
+  // EGL 1.5 allows looking up core functions with eglGetProcAddress, and
+  // we require 1.5 anyway. This also gets us glGetString without having
+  // to pick between libGL, libGLESv2 and libOpenGL.
+  eglGetError = (void *)eglGetProcAddress("eglGetError");
+  eglGetPlatformDisplay = (void *)eglGetProcAddress("eglGetPlatformDisplay");
+  eglInitialize = (void *)eglGetProcAddress("eglInitialize");
+  eglTerminate = (void *)eglGetProcAddress("eglTerminate");
+  eglQueryString = (void *)eglGetProcAddress("eglQueryString");
+  eglBindAPI = (void *)eglGetProcAddress("eglBindAPI");
+  eglGetConfigs = (void *)eglGetProcAddress("eglGetConfigs");
+  eglCreateContext = (void *)eglGetProcAddress("eglCreateContext");
+  eglDestroyContext = (void *)eglGetProcAddress("eglDestroyContext");
+  eglMakeCurrent = (void *)eglGetProcAddress("eglMakeCurrent");
+  eglReleaseThread = (void *)eglGetProcAddress("eglReleaseThread");
+  glGetString = (void *)eglGetProcAddress("glGetString");
+  if (!eglGetError || !eglGetPlatformDisplay || !eglInitialize ||
+      !eglTerminate || !eglQueryString || !eglBindAPI || !eglGetConfigs ||
+      !eglCreateContext || !eglDestroyContext || !eglMakeCurrent ||
+      !eglReleaseThread || !glGetString) {
+    fprintf(stderr, "libEGL is missing EGL 1.5 entry points\n");
+    dlclose(lib);
+    return false;
+  }
+  return true;
+}
+
 static const EGLint context_attribs[] = {
     EGL_CONTEXT_MAJOR_VERSION,
     2,
@@ -33,74 +99,352 @@ static const EGLint config_attribs[] = {
 };
 */
 
-struct json_object *egl_dev_info(EGLDeviceEXT dev);
+enum probe_state {
+  PROBE_PENDING,
+  PROBE_RUNNING,
+  PROBE_DONE,
+  PROBE_TIMED_OUT,
+};
+
+struct egl_probe {
+  EGLDeviceEXT dev;
+  const char *path;
+  enum probe_state state;
+  struct timespec deadline;
+  struct json_object *obj;
+};
+
+// Shared between egl_info() and the workers. Workers stuck in a driver may
+// outlive egl_info(), so the pool is reference-counted.
+struct egl_pool {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int refs;
+  struct egl_probe *probes;
+  size_t probes_len;
+  size_t next;
+  bool gl;
+};
+
+static struct json_object *egl_dev_info(EGLDeviceEXT dev, const char *path,
+                                        bool gl);
+
+static void pool_unref_locked(struct egl_pool *pool) {
+  if (--pool->refs > 0) {
+    pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t i = 0; i < pool->probes_len; i++) {
+    json_object_put(pool->probes[i].obj);
+  }
+  pthread_cond_destroy(&pool->cond);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->probes);
+  free(pool);
+}
+
+static void timespec_add_ms(struct timespec *ts, long ms) {
+  ts->tv_sec += ms / 1000;
+  ts->tv_nsec += (ms % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+static bool timespec_before(const struct timespec *a,
+                            const struct timespec *b) {
+  return a->tv_sec < b->tv_sec ||
+         (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void *probe_worker(void *data) {
+  struct egl_pool *pool = data;
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->next < pool->probes_len) {
+    struct egl_probe *probe = &pool->probes[pool->next++];
+    probe->state = PROBE_RUNNING;
+    clock_gettime(CLOCK_MONOTONIC, &probe->deadline);
+    timespec_add_ms(&probe->deadline, EGL_DEVICE_TIMEOUT_MS);
+    // egl_info() may be waiting without a deadline, let it pick this one up
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    struct json_object *obj =
+        egl_dev_info(probe->dev, probe->path, pool->gl);
+
+    pthread_mutex_lock(&pool->lock);
+    if (probe->state == PROBE_TIMED_OUT) {
+      // egl_info() gave up on this device and started another worker
+      json_object_put(obj);
+      break;
+    }
+    probe->obj = obj;
+    probe->state = PROBE_DONE;
+    pthread_cond_signal(&pool->cond);
+  }
+  pool_unref_locked(pool);
+
+  eglReleaseThread();
+  return NULL;
+}
+
+static bool start_worker(struct egl_pool *pool) {
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  pool->refs++;
+  pthread_t thread;
+  int ret = pthread_create(&thread, &attr, probe_worker, pool);
+  pthread_attr_destroy(&attr);
+  if (ret != 0) {
+    fprintf(stderr, "pthread_create: %s\n", strerror(ret));
+    pool->refs--;
+    return false;
+  }
+  return true;
+}
+
+// Probes the remaining devices on the calling thread, without timeouts.
+// Must be called with the pool locked.
+static void probe_inline(struct egl_pool *pool) {
+  pool->refs++;
+  pthread_mutex_unlock(&pool->lock);
+  probe_worker(pool);
+  pthread_mutex_lock(&pool->lock);
+}
+
+// Probes all devices concurrently. Must be called with the pool locked.
+static void probe_devices(struct egl_pool *pool) {
+  long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t workers = nproc > 0 ? (size_t)nproc : 1;
+  if (workers > pool->probes_len) {
+    workers = pool->probes_len;
+  }
+
+  size_t started = 0;
+  for (size_t i = 0; i < workers; i++) {
+    if (start_worker(pool)) {
+      started++;
+    }
+  }
+  if (started == 0) {
+    probe_inline(pool);
+    return;
+  }
+
+  bool replace_failed = false;
+  while (true) {
+    bool pending = false, running = false;
+    struct timespec now, deadline = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (size_t i = 0; i < pool->probes_len; i++) {
+      struct egl_probe *probe = &pool->probes[i];
+      switch (probe->state) {
+      case PROBE_PENDING:
+        pending = true;
+        break;
+      case PROBE_RUNNING:
+        if (!timespec_before(&now, &probe->deadline)) {
+          fprintf(stderr, "%s: EGL device probe timed out after %d ms\n",
+                  probe->path[0] ? probe->path : "EGL device",
+                  EGL_DEVICE_TIMEOUT_MS);
+          probe->state = PROBE_TIMED_OUT;
+          // The stuck worker won't pick up more devices, replace it
+          if (pool->next < pool->probes_len && !start_worker(pool)) {
+            replace_failed = true;
+          }
+          break;
+        }
+        if (!running || timespec_before(&probe->deadline, &deadline)) {
+          deadline = probe->deadline;
+        }
+        running = true;
+        break;
+      case PROBE_DONE:
+      case PROBE_TIMED_OUT:
+        break;
+      }
+    }
+
+    if (pending && !running && replace_failed) {
+      // Live workers always have a running probe, none is left to pick up
+      // the pending ones
+      replace_failed = false;
+      probe_inline(pool);
+    } else if (running) {
+      pthread_cond_timedwait(&pool->cond, &pool->lock, &deadline);
+    } else if (pending) {
+      pthread_cond_wait(&pool->cond, &pool->lock);
+    } else {
+      break;
+    }
+  }
+}
+
+struct json_object *egl_info(char *paths[], bool gl) {
+  if (!load_egl()) {
+    return NULL;
+  }
 
-struct json_object *egl_info(char *paths[]) {
-  const char *device_paths[16] = {0};
-  EGLDeviceEXT devices[16] = {0};
-  EGLint num_devices = 16;
   const PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT =
       (void *)eglGetProcAddress("eglQueryDevicesEXT");
   const PFNEGLQUERYDEVICESTRINGEXTPROC eglQueryDeviceStringEXT =
       (void *)eglGetProcAddress("eglQueryDeviceStringEXT");
-  eglQueryDevicesEXT(num_devices, devices, &num_devices);
-  for (int i = 0; i < num_devices; i++) {
-    device_paths[i] =
-        eglQueryDeviceStringEXT(devices[i], EGL_DRM_DEVICE_FILE_EXT);
-    if (device_paths[i] == 0) {
-      device_paths[i] = "";
+  if (!eglQueryDevicesEXT || !eglQueryDeviceStringEXT) {
+    fprintf(stderr, "EGL_EXT_device_enumeration not supported\n");
+    return NULL;
+  }
+
+  EGLint num_devices = 0;
+  if (!eglQueryDevicesEXT(0, NULL, &num_devices)) {
+    fprintf(stderr, "eglQueryDevicesEXT failed: 0x%x\n", eglGetError());
+    return NULL;
+  }
+  EGLDeviceEXT *devices = calloc(num_devices ? num_devices : 1,
+                                 sizeof(*devices));
+  struct egl_pool *pool = calloc(1, sizeof(*pool));
+  if (pool) {
+    pool->probes = calloc(num_devices ? num_devices : 1,
+                          sizeof(*pool->probes));
+  }
+  if (!devices || !pool || !pool->probes) {
+    perror("calloc");
+    free(devices);
+    if (pool) {
+      free(pool->probes);
     }
+    free(pool);
+    return NULL;
+  }
+  if (!eglQueryDevicesEXT(num_devices, devices, &num_devices)) {
+    fprintf(stderr, "eglQueryDevicesEXT failed: 0x%x\n", eglGetError());
+    num_devices = 0;
   }
 
-  struct json_object *obj = json_object_new_object();
-  for (int i = 0; i < num_devices; i++) {
-    if (!paths[0]) {
-      // Collect from all devices.
-      struct json_object *dev = egl_dev_info(devices[i]);
-      if (dev)
-        json_object_object_add(obj, device_paths[i], dev);
-    } else {
+  for (EGLint i = 0; i < num_devices; i++) {
+    const char *device_path =
+        eglQueryDeviceStringEXT(devices[i], EGL_DRM_DEVICE_FILE_EXT);
+    if (device_path == 0) {
+      device_path = "";
+    }
+
+    bool wanted = !paths[0];
+    for (char **path = paths; *path; ++path) {
       // Check if it was passed in.
-      for (char **path = paths; *path; ++path) {
-        if (!strcmp(*path, device_paths[i])) {
-          struct json_object *dev = egl_dev_info(devices[i]);
-          if (dev)
-            json_object_object_add(obj, *path, dev);
-        }
+      if (!strcmp(*path, device_path)) {
+        wanted = true;
       }
     }
+    if (!wanted) {
+      continue;
+    }
+
+    struct egl_probe *probe = &pool->probes[pool->probes_len++];
+    probe->dev = devices[i];
+    probe->path = device_path;
   }
+  free(devices);
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_condattr_t condattr;
+  pthread_condattr_init(&condattr);
+  pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+  pthread_cond_init(&pool->cond, &condattr);
+  pthread_condattr_destroy(&condattr);
+  pool->refs = 1;
+  pool->gl = gl;
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->probes_len > 0) {
+    probe_devices(pool);
+  }
+
+  struct json_object *obj = json_object_new_object();
+  for (size_t i = 0; i < pool->probes_len; i++) {
+    struct egl_probe *probe = &pool->probes[i];
+    if (probe->state == PROBE_DONE && probe->obj) {
+      json_object_object_add(obj, probe->path, probe->obj);
+      probe->obj = NULL;
+    }
+  }
+  pool_unref_locked(pool);
   return obj;
 }
 
-struct json_object *egl_dev_info(EGLDeviceEXT dev) {
+static struct json_object *new_string_or_null(const char *str) {
+  return str ? json_object_new_string(str) : NULL;
+}
+
+static struct json_object *egl_device_strings(
+    EGLDeviceEXT dev, PFNEGLQUERYDEVICESTRINGEXTPROC eglQueryDeviceStringEXT) {
+  struct json_object *obj = json_object_new_object();
+  // EGL_EXT_device_query_name
+  json_object_object_add(
+      obj, "vendor",
+      new_string_or_null(eglQueryDeviceStringEXT(dev, EGL_VENDOR)));
+  json_object_object_add(
+      obj, "renderer",
+      new_string_or_null(eglQueryDeviceStringEXT(dev, EGL_RENDERER_EXT)));
+  // EGL_EXT_device_drm and EGL_EXT_device_drm_render_node
+  json_object_object_add(obj, "drm_device_file",
+                         new_string_or_null(eglQueryDeviceStringEXT(
+                             dev, EGL_DRM_DEVICE_FILE_EXT)));
+  json_object_object_add(obj, "drm_render_node_file",
+                         new_string_or_null(eglQueryDeviceStringEXT(
+                             dev, EGL_DRM_RENDER_NODE_FILE_EXT)));
+  json_object_object_add(
+      obj, "extensions",
+      new_string_or_null(eglQueryDeviceStringEXT(dev, EGL_EXTENSIONS)));
+  // Unsupported queries above leave EGL_BAD_PARAMETER behind
+  eglGetError();
+  return obj;
+}
+
+// Everything but the GL strings only needs an initialized display. Creating
+// a context spins up the whole driver, so it's only done when asked for.
+static struct json_object *egl_dev_info(EGLDeviceEXT dev, const char *path,
+                                        bool gl) {
+  const PFNEGLQUERYDEVICESTRINGEXTPROC eglQueryDeviceStringEXT =
+      (void *)eglGetProcAddress("eglQueryDeviceStringEXT");
   const PFNEGLQUERYDMABUFFORMATSEXTPROC eglQueryDmaBufFormatsEXT =
       (void *)eglGetProcAddress("eglQueryDmaBufFormatsEXT");
   const PFNEGLQUERYDMABUFMODIFIERSEXTPROC eglQueryDmaBufModifiersEXT =
       (void *)eglGetProcAddress("eglQueryDmaBufModifiersEXT");
+  if (!path[0]) {
+    path = "EGL device";
+  }
+  if (!eglQueryDeviceStringEXT || !eglQueryDmaBufFormatsEXT ||
+      !eglQueryDmaBufModifiersEXT) {
+    fprintf(stderr, "%s: EGL_EXT_image_dma_buf_import_modifiers not "
+            "supported\n", path);
+    return NULL;
+  }
+
   // initialize EGL for wayland.
   int egl_major = 0;
   int egl_minor = 0;
   EGLDisplay display =
       eglGetPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, dev, NULL);
-  assert(display);
+  if (display == EGL_NO_DISPLAY) {
+    fprintf(stderr, "%s: eglGetPlatformDisplay failed: 0x%x\n", path,
+            eglGetError());
+    return NULL;
+  }
   if (eglInitialize(display, &egl_major, &egl_minor) != EGL_TRUE) {
+    fprintf(stderr, "%s: eglInitialize failed: 0x%x\n", path, eglGetError());
+    return NULL;
+  }
+  if (egl_major != 1 || egl_minor < 5) {
+    fprintf(stderr, "%s: EGL 1.5 required, got %d.%d\n", path, egl_major,
+            egl_minor);
+    eglTerminate(display);
     return NULL;
   }
-  assert(egl_major == 1);
-  assert(egl_minor >= 5);
-  EGLConfig configs[256];
-  int num_configs = 256;
-  int num_exists_configs = 0;
-  eglBindAPI(EGL_OPENGL_ES_API);
-  eglGetConfigs(display, configs, num_configs, &num_exists_configs);
-  // Shits broke yo.
-  // eglChooseConfig(display, config_attribs, configs, num_configs,
-  // &num_configs); assert(num_configs > 0);
-  assert(num_exists_configs > 0);
-  EGLContext context =
-      eglCreateContext(display, configs[0], EGL_NO_CONTEXT, context_attribs);
-  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
 
   struct json_object *obj = json_object_new_object();
 
@@ -110,55 +454,87 @@ struct json_object *egl_dev_info(EGLDeviceEXT dev) {
   json_object_object_add(
       obj, "version",
       json_object_new_string(eglQueryString(display, EGL_VERSION)));
-  json_object_object_add(
-      obj, "renderer",
-      json_object_new_string((const char *)glGetString(GL_RENDERER)));
+  json_object_object_add(obj, "device",
+                         egl_device_strings(dev, eglQueryDeviceStringEXT));
 
-  EGLint formats[256] = {0};
-  EGLint num_formats = 256;
-  if (eglQueryDmaBufFormatsEXT(display, num_formats, formats, &num_formats) !=
-      EGL_TRUE) {
-    return NULL;
+  if (gl) {
+    // Shits broke yo.
+    // eglChooseConfig(display, config_attribs, configs, num_configs,
+    // &num_configs); assert(num_configs > 0);
+    // Any config will do, it's only used to make a context current.
+    EGLConfig config;
+    EGLint num_configs = 0;
+    EGLContext context = EGL_NO_CONTEXT;
+    const char *renderer = NULL;
+    eglBindAPI(EGL_OPENGL_ES_API);
+    if (eglGetConfigs(display, &config, 1, &num_configs) != EGL_TRUE ||
+        num_configs < 1) {
+      fprintf(stderr, "%s: no EGL config available\n", path);
+    } else {
+      context =
+          eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    }
+    if (context != EGL_NO_CONTEXT &&
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+      renderer = (const char *)glGetString(GL_RENDERER);
+    } else {
+      fprintf(stderr, "%s: failed to make a GLES context current: 0x%x\n",
+              path, eglGetError());
+    }
+    // The string is copied before the context goes away
+    json_object_object_add(obj, "renderer", new_string_or_null(renderer));
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT) {
+      eglDestroyContext(display, context);
+    }
+  } else {
+    json_object_object_add(obj, "renderer", NULL);
+  }
+
+  EGLint num_formats = 0;
+  EGLint *formats = NULL;
+  if (eglQueryDmaBufFormatsEXT(display, 0, NULL, &num_formats) != EGL_TRUE ||
+      (num_formats > 0 &&
+       (!(formats = calloc(num_formats, sizeof(*formats))) ||
+        eglQueryDmaBufFormatsEXT(display, num_formats, formats,
+                                 &num_formats) != EGL_TRUE))) {
+    fprintf(stderr, "%s: eglQueryDmaBufFormatsEXT failed: 0x%x\n", path,
+            eglGetError());
+    num_formats = 0;
   }
   struct json_object *formats_arr = json_object_new_array();
 
   for (int f = 0; f < num_formats; f++) {
-    EGLuint64KHR modifiers[256] = {0};
-    EGLint num_modifiers = 256;
-    assert(eglQueryDmaBufModifiersEXT(display, formats[f], num_modifiers,
-                                      modifiers, NULL,
-                                      &num_modifiers) == EGL_TRUE);
+    EGLint num_modifiers = 0;
+    EGLuint64KHR *modifiers = NULL;
+    if (eglQueryDmaBufModifiersEXT(display, formats[f], 0, NULL, NULL,
+                                   &num_modifiers) != EGL_TRUE ||
+        (num_modifiers > 0 &&
+         (!(modifiers = calloc(num_modifiers, sizeof(*modifiers))) ||
+          eglQueryDmaBufModifiersEXT(display, formats[f], num_modifiers,
+                                     modifiers, NULL,
+                                     &num_modifiers) != EGL_TRUE))) {
+      fprintf(stderr, "%s: eglQueryDmaBufModifiersEXT failed: 0x%x\n", path,
+              eglGetError());
+      num_modifiers = 0;
+    }
     struct json_object *format_obj = json_object_new_object();
     struct json_object *modifier_arr = json_object_new_array();
     for (int m = 0; m < num_modifiers; m++) {
       json_object_array_add(modifier_arr, json_object_new_uint64(modifiers[m]));
     }
+    free(modifiers);
     json_object_object_add(format_obj, "format",
                            json_object_new_uint64(formats[f]));
     json_object_object_add(format_obj, "modifiers", modifier_arr);
     json_object_array_add(formats_arr, format_obj);
   }
+  free(formats);
 
   json_object_object_add(obj, "formats", formats_arr);
-  return obj;
-}
 
-static const char *get_object_object_string(struct json_object *obj,
-                                            const char *key) {
-  struct json_object *str_obj = json_object_object_get(obj, key);
-  if (!str_obj) {
-    return NULL;
-  }
-  return json_object_get_string(str_obj);
-}
-
-static uint64_t get_object_object_uint64(struct json_object *obj,
-                                         const char *key) {
-  struct json_object *uint64_obj = json_object_object_get(obj, key);
-  if (!uint64_obj) {
-    return 0;
-  }
-  return json_object_get_uint64(uint64_obj);
+  eglTerminate(display);
+  return obj;
 }
 
 void print_egl(struct json_object *obj) {
@@ -167,7 +543,19 @@ void print_egl(struct json_object *obj) {
     (void)path;
     printf("vendor: %s\n", get_object_object_string(device_obj, "vendor"));
     printf("version: %s\n", get_object_object_string(device_obj, "version"));
-    printf("renderer: %s\n", get_object_object_string(device_obj, "renderer"));
+    const char *renderer = get_object_object_string(device_obj, "renderer");
+    struct json_object *dev_obj = json_object_object_get(device_obj, "device");
+    if (!renderer && dev_obj) {
+      renderer = get_object_object_string(dev_obj, "renderer");
+    }
+    printf("renderer: %s\n", renderer ? renderer : "unknown");
+    if (dev_obj) {
+      const char *render_node =
+          get_object_object_string(dev_obj, "drm_render_node_file");
+      if (render_node) {
+        printf("render node: %s\n", render_node);
+      }
+    }
 
     struct json_object *formats_arr =
         json_object_object_get(device_obj, "formats");
@@ -7,10 +7,39 @@ def case_print(f, c, s):
 	f.write('\tcase {}:\n'.format(c))
 	f.write('\t\treturn "{}";\n'.format(s))
 
+def parse_int(s, defines={}):
+	s = defines.get(s, s)
+	try:
+		return int(s.rstrip('ULul'), 0)
+	except ValueError:
+		return None
+
 info = {
 	'fmt': r'^#define (\w+)\s*(?:\\$\s*)?fourcc_code',
 	'basic_pre': r'^#define (I915_FORMAT_MOD_\w+)\b',
 	'basic_post': r'^#define (DRM_FORMAT_MOD_(?:INVALID|LINEAR|SAMSUNG|QCOM|VIVANTE|NVIDIA|BROADCOM|ALLWINNER)\w*)\s',
+	'vendor': r'^#define DRM_FORMAT_MOD_VENDOR_(\w+)\s',
+}
+
+# Modifier field layouts, as (vendor, field, shift, mask). Vendors describe
+# their bitfields in a handful of different ways in drm_fourcc.h.
+field_patterns = {
+	# AMD_FMT_MOD_TILE_SHIFT 8 / AMD_FMT_MOD_TILE_MASK 0x1F
+	'shift_mask': r'^#define ([A-Z]+)_FMT_MOD_(\w+)_SHIFT\s+(\w+)\s*$',
+	# __fourcc_mod_broadcom_param_shift 8 / __fourcc_mod_broadcom_param_bits 48
+	'private': r'^#define __fourcc_mod_([a-z]+)_(\w+)_(shift|mask|bits)\s+(\w+)\s*$',
+	# VIVANTE_MOD_TS_MASK (0xfULL << 48)
+	'shifted_mask': r'^#define ([A-Z]+)_MOD_(\w+)_MASK\s+\((\w+)\s*<<\s*(\d+)\)',
+	# DRM_FORMAT_MOD_NVIDIA_BLOCK_LINEAR_2D(c, s, g, k, h) with a body of
+	# ((h) & 0xf) | (((k) & 0xff) << 12) | ...
+	'macro': r'^#define DRM_FORMAT_MOD_([A-Z]+)_(\w+)\(([\w, ]+)\)\s*\\\n\s*fourcc_mod_code\(\1,((?:[^\n]*\\\n)*[^\n]*)',
+}
+
+# Prefixes of the named values of a field, where they differ from its name
+value_aliases = {
+	('AMD', 'TILE_VERSION'): 'TILE_VER',
+	('AMD', 'DCC_MAX_COMPRESSED_BLOCK'): 'DCC_BLOCK',
+	('AMLOGIC', 'OPTIONS'): 'OPTION',
 }
 
 with open(sys.argv[1], 'r') as f:
@@ -18,9 +47,182 @@ with open(sys.argv[1], 'r') as f:
 	for k, v in info.items():
 		info[k] = re.findall(v, data, flags=re.M)
 
+	defines = dict(re.findall(r'^#define (\w+)\s+(\w+)\s*$', data, flags=re.M))
+	fields = {}
+
+	for vendor, name, shift in re.findall(field_patterns['shift_mask'], data, flags=re.M):
+		mask = defines.get('{}_FMT_MOD_{}_MASK'.format(vendor, name))
+		if mask is not None:
+			fields.setdefault(vendor, []).append((name, parse_int(shift), parse_int(mask)))
+
+	private = {}
+	for vendor, name, kind, value in re.findall(field_patterns['private'], data, flags=re.M):
+		private.setdefault((vendor.upper(), name.upper()), {})[kind] = parse_int(value)
+	for (vendor, name), v in private.items():
+		if 'mask' in v:
+			mask = v['mask']
+		elif 'bits' in v:
+			mask = (1 << v['bits']) - 1
+		else:
+			continue
+		fields.setdefault(vendor, []).append((name, v.get('shift', 0), mask))
+
+	for vendor, name, mask, shift in re.findall(field_patterns['shifted_mask'], data, flags=re.M):
+		fields.setdefault(vendor, []).append((name, int(shift), parse_int(mask)))
+
+	mod_layouts = {}
+	for vendor, macro, params, body in re.findall(field_patterns['macro'], data, flags=re.M):
+		# Skip generic helpers such as DRM_FORMAT_MOD_ARM_CODE(type, val)
+		if macro == 'CODE':
+			continue
+		# Constant bits set by the macro, e.g. the 0x10 of NVIDIA's layout
+		bits = 0
+		for value in re.findall(r'\(\s*(0x[0-9a-fA-F]+|\d+)\s*\|', body):
+			bits |= int(value, 0)
+		mod_layouts.setdefault(vendor, ('DRM_FORMAT_MOD_{}_{}'.format(vendor, macro), bits))
+		if vendor in fields:
+			continue
+		for param in [p.strip() for p in params.split(',')]:
+			m = re.search(r'\(\(\({0}\) & (\w+)\) << (\d+)\)|\(\({0}\) & (\w+)\)'.format(param), body)
+			if not m:
+				continue
+			if m.group(1):
+				field = (param.strip('_').upper(), int(m.group(2)), parse_int(m.group(1), defines))
+			else:
+				field = (param.strip('_').upper(), 0, parse_int(m.group(3), defines))
+			if field[2] is not None:
+				fields.setdefault(vendor, []).append(field)
+
+	fields = {k: sorted(v, key=lambda field: field[1])
+		for k, v in fields.items() if k in info['vendor']}
+
+	# Named values of the fields, e.g. AMD_FMT_MOD_TILE_VER_GFX9 for the
+	# TILE_VERSION field. A constant belongs to the field with the longest
+	# matching prefix, so TILE_VER_GFX9 isn't taken as a TILE value.
+	values = {}
+	for vendor, vendor_fields in fields.items():
+		prefixes = [(value_aliases.get((vendor, name), name) + '_', name, shift, mask)
+			for name, shift, mask in vendor_fields]
+		pattern = r'^#define {}_(?:FMT_MOD_|MOD_|FBC_)(\w+)\s+\(?(\w+?)(?:ULL)?(?:\s*<<\s*(\d+))?\)?\s*$'.format(vendor)
+		for rest, value, value_shift in re.findall(pattern, data, flags=re.M):
+			matches = [p for p in prefixes if rest.startswith(p[0])]
+			value = parse_int(value)
+			if not matches or value is None:
+				continue
+			prefix, name, shift, mask = max(matches, key=lambda p: len(p[0]))
+			value_name = rest[len(prefix):]
+			if value_name in ('SHIFT', 'MASK') or value_name.endswith(('_SHIFT', '_MASK')):
+				continue
+			# Values are either shifted in place, as VIVANTE_MOD_TS_64_4, or
+			# not at all, as AMD_FMT_MOD_TILE_GFX9_64K_S
+			value <<= int(value_shift or 0)
+			if value_shift and int(value_shift) >= shift:
+				value >>= shift
+			if value == 0 or value & ~mask:
+				continue
+			values.setdefault((vendor, name), []).append((value_name, value))
+
+# Plane layouts which can't be derived from the format name, as
+# (bytes per block, block width, block height) per plane, then the
+# horizontal and vertical subsampling of the chroma planes. Mirrors the
+# kernel's drm_format_info table.
+layouts = {
+	'R10': ([(2, 1, 1)], 1, 1),
+	'R12': ([(2, 1, 1)], 1, 1),
+	'YUYV': ([(4, 2, 1)], 2, 1),
+	'YVYU': ([(4, 2, 1)], 2, 1),
+	'UYVY': ([(4, 2, 1)], 2, 1),
+	'VYUY': ([(4, 2, 1)], 2, 1),
+	'AYUV': ([(4, 1, 1)], 1, 1),
+	'AVUY8888': ([(4, 1, 1)], 1, 1),
+	'XYUV8888': ([(4, 1, 1)], 1, 1),
+	'XVUY8888': ([(4, 1, 1)], 1, 1),
+	'VUY888': ([(3, 1, 1)], 1, 1),
+	'VUY101010': ([(4, 1, 1)], 1, 1),
+	'Y210': ([(8, 2, 1)], 2, 1),
+	'Y212': ([(8, 2, 1)], 2, 1),
+	'Y216': ([(8, 2, 1)], 2, 1),
+	'Y410': ([(4, 1, 1)], 1, 1),
+	'Y412': ([(8, 1, 1)], 1, 1),
+	'Y416': ([(8, 1, 1)], 1, 1),
+	'XVYU2101010': ([(4, 1, 1)], 1, 1),
+	'XVYU12_16161616': ([(8, 1, 1)], 1, 1),
+	'XVYU16161616': ([(8, 1, 1)], 1, 1),
+	'Y0L0': ([(8, 2, 2)], 2, 2),
+	'X0L0': ([(8, 2, 2)], 2, 2),
+	'Y0L2': ([(8, 2, 2)], 2, 2),
+	'X0L2': ([(8, 2, 2)], 2, 2),
+	'NV12': ([(1, 1, 1), (2, 1, 1)], 2, 2),
+	'NV21': ([(1, 1, 1), (2, 1, 1)], 2, 2),
+	'NV16': ([(1, 1, 1), (2, 1, 1)], 2, 1),
+	'NV61': ([(1, 1, 1), (2, 1, 1)], 2, 1),
+	'NV24': ([(1, 1, 1), (2, 1, 1)], 1, 1),
+	'NV42': ([(1, 1, 1), (2, 1, 1)], 1, 1),
+	'NV15': ([(5, 4, 1), (10, 4, 1)], 2, 2),
+	'NV20': ([(5, 4, 1), (10, 4, 1)], 2, 1),
+	'NV30': ([(5, 4, 1), (10, 4, 1)], 1, 1),
+	'P010': ([(2, 1, 1), (4, 1, 1)], 2, 2),
+	'P012': ([(2, 1, 1), (4, 1, 1)], 2, 2),
+	'P016': ([(2, 1, 1), (4, 1, 1)], 2, 2),
+	'P210': ([(2, 1, 1), (4, 1, 1)], 2, 1),
+	'P030': ([(4, 3, 1), (8, 3, 1)], 2, 2),
+	'Q410': ([(2, 1, 1), (2, 1, 1), (2, 1, 1)], 1, 1),
+	'Q401': ([(2, 1, 1), (2, 1, 1), (2, 1, 1)], 1, 1),
+	'YUV410': ([(1, 1, 1)] * 3, 4, 4),
+	'YVU410': ([(1, 1, 1)] * 3, 4, 4),
+	'YUV411': ([(1, 1, 1)] * 3, 4, 1),
+	'YVU411': ([(1, 1, 1)] * 3, 4, 1),
+	'YUV420': ([(1, 1, 1)] * 3, 2, 2),
+	'YVU420': ([(1, 1, 1)] * 3, 2, 2),
+	'YUV422': ([(1, 1, 1)] * 3, 2, 1),
+	'YVU422': ([(1, 1, 1)] * 3, 2, 1),
+	'YUV444': ([(1, 1, 1)] * 3, 1, 1),
+	'YVU444': ([(1, 1, 1)] * 3, 1, 1),
+}
+
+# Splits the digits of packed RGB names into one bit width per channel, e.g.
+# 2101010 into 2, 10, 10, 10 for XRGB2101010
+def channel_bits(digits, channels):
+	if channels == 0:
+		if not digits:
+			yield []
+		return
+	for n in (1, 2):
+		if len(digits) < n or digits[0] == '0' or int(digits[:n]) > 16:
+			break
+		for rest in channel_bits(digits[n:], channels - 1):
+			yield [int(digits[:n])] + rest
+
+def layout(name):
+	if name in layouts:
+		return layouts[name]
+	# Packed RGB with a separate alpha plane, e.g. XRGB8888_A8
+	if name.endswith('_A8'):
+		base = layout(name[:-len('_A8')])
+		if base and len(base[0]) == 1:
+			return (base[0] + [(1, 1, 1)], 1, 1)
+		return None
+	m = re.match(r'^([ARGBXCD]+)(\d+)F?$', name)
+	if not m:
+		return None
+	for bits in channel_bits(m.group(2), len(m.group(1))):
+		total = sum(bits)
+		if total < 8 and 8 % total == 0:
+			# Several pixels per byte, e.g. C4
+			return ([(1, 8 // total, 1)], 1, 1)
+		if total % 8 == 0:
+			return ([(total // 8, 1, 1)], 1, 1)
+	return None
+
+format_layouts = [(ident, layout(ident[len('DRM_FORMAT_'):])) for ident in info['fmt']]
+format_layouts = [(ident, l) for ident, l in format_layouts if l]
+
 with open(sys.argv[2], 'w') as f:
 	f.write('''\
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <drm_fourcc.h>
 
 #include "tables.h"
@@ -41,6 +243,56 @@ const char *format_str(uint32_t format)
 	}
 }
 
+static const struct {
+	const char *name;
+	uint32_t format;
+} formats[] = {
+''')
+
+	for ident in info['fmt']:
+		f.write('\t{{ "{}", {} }},\n'.format(ident[len('DRM_FORMAT_'):], ident))
+
+	f.write('''\
+};
+
+uint32_t format_from_str(const char *name)
+{
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		if (strcmp(formats[i].name, name) == 0) {
+			return formats[i].format;
+		}
+	}
+	return DRM_FORMAT_INVALID;
+}
+
+static const struct format_info format_infos[] = {
+''')
+
+	for ident, (planes, hsub, vsub) in format_layouts:
+		f.write('\t{{ {}, {}, {{ {} }}, {{ {} }}, {{ {} }}, {}, {} }},\n'.format(ident, len(planes),
+			', '.join(str(p[0]) for p in planes),
+			', '.join(str(p[1]) for p in planes),
+			', '.join(str(p[2]) for p in planes),
+			hsub, vsub))
+
+	f.write('''\
+};
+
+const struct format_info *format_info(uint32_t format)
+{
+	switch (format) {
+''')
+
+	for i, (ident, _) in enumerate(format_layouts):
+		f.write('\tcase {}:\n'.format(ident))
+		f.write('\t\treturn &format_infos[{}];\n'.format(i))
+
+	f.write('''\
+	default:
+		return NULL;
+	}
+}
+
 const char *basic_modifier_str(uint64_t modifier)
 {
 	switch (modifier) {
@@ -51,7 +303,86 @@ const char *basic_modifier_str(uint64_t modifier)
 
 	f.write('''\
 	default:
-		return "unknown";
+		return NULL;
+	}
+}
+
+static const struct {
+	const char *name;
+	uint64_t modifier;
+} modifiers[] = {
+''')
+
+	for ident in info['basic_pre'] + info['basic_post']:
+		f.write('\t{{ "{0}", {0} }},\n'.format(ident))
+
+	f.write('''\
+};
+
+uint64_t modifier_from_str(const char *name)
+{
+	for (size_t i = 0; i < sizeof(modifiers) / sizeof(modifiers[0]); i++) {
+		if (strcmp(modifiers[i].name, name) == 0) {
+			return modifiers[i].modifier;
+		}
 	}
+	return DRM_FORMAT_MOD_INVALID;
+}
+''')
+
+	f.write('''
+bool modifier_constant(size_t i, const char **name, uint64_t *modifier)
+{
+	if (i >= sizeof(modifiers) / sizeof(modifiers[0])) {
+		return false;
+	}
+	*name = modifiers[i].name;
+	*modifier = modifiers[i].modifier;
+	return true;
+}
+''')
+
+	for (vendor, name), field_values in sorted(values.items()):
+		f.write('\nstatic const struct modifier_value {}_{}_values[] = {{\n'.format(
+			vendor.lower(), name.lower()))
+		for value_name, value in field_values:
+			f.write('\t{{ "{}", {} }},\n'.format(value_name, value))
+		f.write('};\n')
+
+	for vendor, vendor_fields in sorted(fields.items()):
+		f.write('\nstatic const struct modifier_field {}_fields[] = {{\n'.format(vendor.lower()))
+		for name, shift, mask in vendor_fields:
+			f.write('\t{{ "{}", {}, 0x{:X}ULL, '.format(name, shift, mask))
+			if (vendor, name) in values:
+				f.write('{0}, sizeof({0}) / sizeof({0}[0]) }},\n'.format(
+					'{}_{}_values'.format(vendor.lower(), name.lower())))
+			else:
+				f.write('NULL, 0 },\n')
+		f.write('};\n')
+
+	f.write('''
+static const struct modifier_vendor modifier_vendors[256] = {
+''')
+
+	for vendor in info['vendor']:
+		vendor_fields = fields.get(vendor, [])
+		fields_mask = 0
+		for name, shift, mask in vendor_fields:
+			fields_mask |= mask << shift
+		layout, layout_bits = mod_layouts.get(vendor, (vendor, 0))
+		f.write('\t[DRM_FORMAT_MOD_VENDOR_{}] = {{ "{}", "{}", 0x{:X}ULL, '.format(
+			vendor, vendor, layout, layout_bits))
+		if vendor_fields:
+			f.write('{0}_fields, sizeof({0}_fields) / sizeof({0}_fields[0]), '.format(vendor.lower()))
+		else:
+			f.write('NULL, 0, ')
+		f.write('0x{:X}ULL }},\n'.format(fields_mask & 0x00FFFFFFFFFFFFFF))
+
+	f.write('''\
+};
+
+const struct modifier_vendor *modifier_vendor(uint8_t vendor)
+{
+	return &modifier_vendors[vendor];
 }
 ''')
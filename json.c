@@ -14,7 +14,14 @@
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
+#include "base64.h"
+#include "color.h"
+#include "devices.h"
 #include "drm_info.h"
+#include "edid.h"
+#include "pci_ids.h"
+#include "props.h"
+#include "scanout.h"
 #include "tables.h"
 
 static const struct {
@@ -183,6 +190,18 @@ static struct json_object *device_info(int fd)
 		json_object_object_add(device_data_obj, "subsystem_device",
 			json_object_new_uint64(pci_dev->subdevice_id));
 
+		char vendor_name[256], device_name[256];
+		if (pci_ids_lookup(pci_dev->vendor_id, pci_dev->device_id,
+				vendor_name, sizeof(vendor_name),
+				device_name, sizeof(device_name))) {
+			json_object_object_add(device_data_obj, "vendor_name",
+				json_object_new_string(vendor_name));
+			if (device_name[0]) {
+				json_object_object_add(device_data_obj, "device_name",
+					json_object_new_string(device_name));
+			}
+		}
+
 		bus_data_obj = json_object_new_object();
 		json_object_object_add(bus_data_obj, "domain",
 			json_object_new_uint64(pci_bus->domain));
@@ -368,6 +387,59 @@ static struct json_object *path_info(int fd, uint32_t blob_id)
 	return obj;
 }
 
+static struct json_object *edid_info(int fd, uint32_t blob_id)
+{
+	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
+	if (!blob) {
+		perror("drmModeGetPropertyBlob");
+		return NULL;
+	}
+
+	struct json_object *obj = edid_to_json(blob->data, blob->length);
+
+	drmModeFreePropertyBlob(blob);
+
+	return obj;
+}
+
+static struct json_object *lut_info(int fd, uint32_t blob_id)
+{
+	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
+	if (!blob) {
+		perror("drmModeGetPropertyBlob");
+		return NULL;
+	}
+
+	struct json_object *obj = lut_to_json(blob->data,
+		blob->length / sizeof(struct drm_color_lut));
+
+	drmModeFreePropertyBlob(blob);
+
+	return obj;
+}
+
+static struct json_object *ctm_info(int fd, uint32_t blob_id)
+{
+	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
+	if (!blob) {
+		perror("drmModeGetPropertyBlob");
+		return NULL;
+	}
+
+	struct json_object *obj = NULL;
+	if (blob->length == sizeof(struct drm_color_ctm)) {
+		const struct drm_color_ctm *ctm = blob->data;
+		obj = ctm_to_json(ctm->matrix);
+	} else {
+		fprintf(stderr, "CTM blob has unexpected size %"PRIu32"\n",
+			blob->length);
+	}
+
+	drmModeFreePropertyBlob(blob);
+
+	return obj;
+}
+
 static struct json_object *hdr_output_metadata_info(int fd, uint32_t blob_id)
 {
 	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
@@ -431,6 +503,145 @@ exit:
 	return obj;
 }
 
+/* Blob contents exported in this snapshot, keyed by a hash of their
+ * contents. Identical blobs (e.g. the same LUT on every CRTC) are encoded
+ * once and share the same JSON string. */
+struct blob_entry {
+	uint64_t hash;
+	uint8_t *data;
+	size_t len;
+	struct json_object *str_obj;
+};
+
+static struct {
+	bool enabled;
+	struct blob_entry *entries;
+	size_t cap, len;
+} blob_cache;
+
+static uint64_t blob_hash(const uint8_t *data, size_t len)
+{
+	/* FNV-1a */
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+static struct blob_entry *find_blob(struct blob_entry *entries, size_t cap,
+		uint64_t hash, const uint8_t *data, size_t len)
+{
+	size_t i = hash & (cap - 1);
+	while (entries[i].str_obj && (entries[i].hash != hash ||
+			entries[i].len != len || memcmp(entries[i].data, data, len) != 0)) {
+		i = (i + 1) & (cap - 1);
+	}
+	return &entries[i];
+}
+
+static bool grow_blob_cache(void)
+{
+	size_t cap = blob_cache.cap ? 2 * blob_cache.cap : 64;
+	struct blob_entry *entries = calloc(cap, sizeof(*entries));
+	if (!entries) {
+		perror("calloc");
+		return false;
+	}
+	for (size_t i = 0; i < blob_cache.cap; i++) {
+		struct blob_entry *entry = &blob_cache.entries[i];
+		if (entry->str_obj) {
+			*find_blob(entries, cap, entry->hash, entry->data, entry->len) =
+				*entry;
+		}
+	}
+	free(blob_cache.entries);
+	blob_cache.entries = entries;
+	blob_cache.cap = cap;
+	return true;
+}
+
+static void blob_cache_finish(void)
+{
+	for (size_t i = 0; i < blob_cache.cap; i++) {
+		json_object_put(blob_cache.entries[i].str_obj);
+		free(blob_cache.entries[i].data);
+	}
+	free(blob_cache.entries);
+	memset(&blob_cache, 0, sizeof(blob_cache));
+}
+
+static struct json_object *blob_value_info(int fd, uint32_t blob_id)
+{
+	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
+	if (!blob) {
+		perror("drmModeGetPropertyBlob");
+		return NULL;
+	}
+
+	const uint8_t *data = blob->data;
+	size_t len = blob->length;
+	uint64_t hash = blob_hash(data, len);
+
+	struct json_object *str_obj = NULL;
+	if (2 * (blob_cache.len + 1) > blob_cache.cap && !grow_blob_cache()) {
+		goto exit;
+	}
+	struct blob_entry *entry = find_blob(blob_cache.entries, blob_cache.cap,
+		hash, data, len);
+	if (!entry->str_obj) {
+		char *str = malloc(base64_encoded_len(len) + 1);
+		uint8_t *copy = malloc(len ? len : 1);
+		if (!str || !copy) {
+			perror("malloc");
+			free(str);
+			free(copy);
+			goto exit;
+		}
+		base64_encode(str, data, len);
+		memcpy(copy, data, len);
+
+		entry->hash = hash;
+		entry->data = copy;
+		entry->len = len;
+		entry->str_obj = json_object_new_string(str);
+		blob_cache.len++;
+		free(str);
+	}
+	str_obj = json_object_get(entry->str_obj);
+
+exit:
+	drmModeFreePropertyBlob(blob);
+	return str_obj;
+}
+
+#ifdef HAVE_GETFB2
+/* Bytes used by the planes of a framebuffer. Planes which share a buffer
+ * have increasing offsets, the padding between them is counted. Extra planes
+ * added by the modifier, e.g. for compression metadata, can't be sized from
+ * their pitch and are left out. */
+static uint64_t fb2_memory(const drmModeFB2 *fb2, const struct format_info *info)
+{
+	uint64_t end = 0, separate = 0;
+	for (size_t i = 0; i < info->planes; i++) {
+		uint64_t rows = fb2->height;
+		if (i > 0) {
+			rows = (rows + info->vsub - 1) / info->vsub;
+		}
+		// The pitch covers one row of blocks
+		rows = (rows + info->block_h[i] - 1) / info->block_h[i];
+		uint64_t size = (uint64_t)fb2->pitches[i] * rows;
+		if (i > 0 && fb2->offsets[i] <= fb2->offsets[0]) {
+			// Stored in a buffer of its own
+			separate += size;
+		} else if (fb2->offsets[i] + size > end) {
+			end = fb2->offsets[i] + size;
+		}
+	}
+	return end - fb2->offsets[0] + separate;
+}
+#endif
+
 static struct json_object *fb_info(int fd, uint32_t id)
 {
 #ifdef HAVE_GETFB2
@@ -466,6 +677,12 @@ static struct json_object *fb_info(int fd, uint32_t id)
 				json_object_new_uint64(fb2->pitches[i]));
 		}
 
+		const struct format_info *info = format_info(fb2->pixel_format);
+		if (info) {
+			json_object_object_add(obj, "memory",
+				json_object_new_uint64(fb2_memory(fb2, info)));
+		}
+
 		drmModeFreeFB2(fb2);
 
 		return obj;
@@ -489,12 +706,39 @@ static struct json_object *fb_info(int fd, uint32_t id)
 	json_object_object_add(obj, "bpp", json_object_new_uint64(fb->bpp));
 	json_object_object_add(obj, "depth", json_object_new_uint64(fb->depth));
 
+	json_object_object_add(obj, "memory",
+		json_object_new_uint64((uint64_t)fb->pitch * fb->height));
+
 	drmModeFreeFB(fb);
 
 	return obj;
 }
 
 
+static struct json_object *fixed_16_16_info(int fd, uint32_t value)
+{
+	(void)fd;
+	return json_object_new_uint64(value >> 16);
+}
+
+static const struct {
+	uint32_t type; /* the property type the decoder applies to */
+	struct json_object *(*decode)(int fd, uint32_t value);
+} prop_data_decoders[PROP_DECODER_COUNT] = {
+	[PROP_DECODER_IN_FORMATS] = { DRM_MODE_PROP_BLOB, in_formats_info },
+	[PROP_DECODER_MODE_ID] = { DRM_MODE_PROP_BLOB, mode_id_info },
+	[PROP_DECODER_WRITEBACK_PIXEL_FORMATS] =
+		{ DRM_MODE_PROP_BLOB, writeback_pixel_formats_info },
+	[PROP_DECODER_PATH] = { DRM_MODE_PROP_BLOB, path_info },
+	[PROP_DECODER_HDR_OUTPUT_METADATA] =
+		{ DRM_MODE_PROP_BLOB, hdr_output_metadata_info },
+	[PROP_DECODER_EDID] = { DRM_MODE_PROP_BLOB, edid_info },
+	[PROP_DECODER_LUT] = { DRM_MODE_PROP_BLOB, lut_info },
+	[PROP_DECODER_CTM] = { DRM_MODE_PROP_BLOB, ctm_info },
+	[PROP_DECODER_FIXED_16_16] = { DRM_MODE_PROP_RANGE, fixed_16_16_info },
+	[PROP_DECODER_FB] = { DRM_MODE_PROP_OBJECT, fb_info },
+};
+
 static struct json_object *properties_info(int fd, uint32_t id, uint32_t type)
 {
 	drmModeObjectProperties *props = drmModeObjectGetProperties(fd, id, type);
@@ -576,8 +820,10 @@ static struct json_object *properties_info(int fd, uint32_t id, uint32_t type)
 			value_obj = json_object_new_uint64(value);
 			break;
 		case DRM_MODE_PROP_BLOB:
-			// TODO: base64-encode blob contents
-			value_obj = NULL;
+			// base64-encoded blob contents, only when asked for
+			if (blob_cache.enabled && value) {
+				value_obj = blob_value_info(fd, value);
+			}
 			break;
 		case DRM_MODE_PROP_SIGNED_RANGE:
 			value_obj = json_object_new_int64((int64_t)value);
@@ -586,38 +832,12 @@ static struct json_object *properties_info(int fd, uint32_t id, uint32_t type)
 		json_object_object_add(prop_obj, "value", value_obj);
 
 		struct json_object *data_obj = NULL;
-		switch (type) {
-		case DRM_MODE_PROP_BLOB:
-			if (!value) {
-				break;
-			}
-			if (strcmp(prop->name, "IN_FORMATS") == 0) {
-				data_obj = in_formats_info(fd, value);
-			} else if (strcmp(prop->name, "MODE_ID") == 0) {
-				data_obj = mode_id_info(fd, value);
-			} else if (strcmp(prop->name, "WRITEBACK_PIXEL_FORMATS") == 0) {
-				data_obj = writeback_pixel_formats_info(fd, value);
-			} else if (strcmp(prop->name, "PATH") == 0) {
-				data_obj = path_info(fd, value);
-			} else if (strcmp(prop->name, "HDR_OUTPUT_METADATA") == 0) {
-				data_obj = hdr_output_metadata_info(fd, value);
-			}
-			break;
-		case DRM_MODE_PROP_RANGE:
-			// This is a special case, as the SRC_* properties are
-			// in 16.16 fixed point
-			if (strncmp(prop->name, "SRC_", 4) == 0) {
-				data_obj = json_object_new_uint64(value >> 16);
-			}
-			break;
-		case DRM_MODE_PROP_OBJECT:
-			if (!value) {
-				break;
-			}
-			if (strcmp(prop->name, "FB_ID") == 0) {
-				data_obj = fb_info(fd, value);
-			}
-			break;
+		enum prop_decoder decoder = prop_decoder_lookup(prop->name);
+		// Blob and object IDs of 0 mean there is nothing to decode
+		if (prop_data_decoders[decoder].decode &&
+				prop_data_decoders[decoder].type == type &&
+				(value || type == DRM_MODE_PROP_RANGE)) {
+			data_obj = prop_data_decoders[decoder].decode(fd, value);
 		}
 		json_object_object_add(prop_obj, "data", data_obj);
 
@@ -717,6 +937,41 @@ static struct json_object *encoders_info(int fd, drmModeRes *res)
 	return arr;
 }
 
+static struct json_object *legacy_gamma_info(int fd, uint32_t crtc_id,
+		int size)
+{
+	if (size <= 0) {
+		return NULL;
+	}
+
+	uint16_t *ramps = malloc(3 * size * sizeof(*ramps));
+	uint16_t *lut = malloc(size * sizeof(struct drm_color_lut));
+	if (!ramps || !lut) {
+		perror("malloc");
+		free(ramps);
+		free(lut);
+		return NULL;
+	}
+
+	struct json_object *obj = NULL;
+	if (drmModeCrtcGetGamma(fd, crtc_id, size, &ramps[0], &ramps[size],
+			&ramps[2 * size]) == 0) {
+		for (int i = 0; i < size; i++) {
+			lut[4 * i] = ramps[i];
+			lut[4 * i + 1] = ramps[size + i];
+			lut[4 * i + 2] = ramps[2 * size + i];
+			lut[4 * i + 3] = 0;
+		}
+		obj = lut_to_json(lut, size);
+	} else {
+		perror("drmModeCrtcGetGamma");
+	}
+
+	free(ramps);
+	free(lut);
+	return obj;
+}
+
 static struct json_object *crtcs_info(int fd, drmModeRes *res)
 {
 	struct json_object *arr = json_object_new_array();
@@ -745,6 +1000,8 @@ static struct json_object *crtcs_info(int fd, drmModeRes *res)
 		}
 		json_object_object_add(crtc_obj, "gamma_size",
 			json_object_new_int(crtc->gamma_size));
+		json_object_object_add(crtc_obj, "gamma",
+			legacy_gamma_info(fd, crtc->crtc_id, crtc->gamma_size));
 
 		struct json_object *props_obj = properties_info(fd,
 			crtc->crtc_id, DRM_MODE_OBJECT_CRTC);
@@ -820,6 +1077,38 @@ static struct json_object *planes_info(int fd)
 	return arr;
 }
 
+/* Sums the memory of the framebuffers scanned out by planes, counting
+ * framebuffers shown on several planes once */
+static struct json_object *scanout_memory_info(struct json_object *planes_arr)
+{
+	size_t planes_len = json_object_array_length(planes_arr);
+	uint32_t fb_ids[planes_len + 1];
+	size_t fbs_len = 0;
+	uint64_t bytes = 0;
+	for (size_t i = 0; i < planes_len; i++) {
+		struct json_object *plane_obj = json_object_array_get_idx(planes_arr, i);
+		struct json_object *fb_obj = json_object_object_get(plane_obj, "fb");
+		struct json_object *memory_obj = json_object_object_get(fb_obj, "memory");
+		if (!memory_obj) {
+			continue;
+		}
+		uint32_t fb_id = json_object_get_uint64(json_object_object_get(fb_obj, "id"));
+		size_t j;
+		for (j = 0; j < fbs_len && fb_ids[j] != fb_id; j++)
+			;
+		if (j < fbs_len) {
+			continue;
+		}
+		fb_ids[fbs_len++] = fb_id;
+		bytes += json_object_get_uint64(memory_obj);
+	}
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "bytes", json_object_new_uint64(bytes));
+	json_object_object_add(obj, "framebuffers", json_object_new_uint64(fbs_len));
+	return obj;
+}
+
 static struct json_object *node_info(const char *path)
 {
 	int fd = open(path, O_RDONLY);
@@ -858,7 +1147,13 @@ static struct json_object *node_info(const char *path)
 	json_object_object_add(obj, "connectors", connectors_info(fd, res));
 	json_object_object_add(obj, "encoders", encoders_info(fd, res));
 	json_object_object_add(obj, "crtcs", crtcs_info(fd, res));
-	json_object_object_add(obj, "planes", planes_info(fd));
+	struct json_object *planes_arr = planes_info(fd);
+	json_object_object_add(obj, "planes", planes_arr);
+	if (planes_arr) {
+		json_object_object_add(obj, "scanout_memory",
+			scanout_memory_info(planes_arr));
+		json_object_object_add(obj, "scanout_index", scanout_index_info(obj));
+	}
 
 	drmModeFreeResources(res);
 
@@ -867,27 +1162,29 @@ static struct json_object *node_info(const char *path)
 	return obj;
 }
 
-/* paths is a NULL terminated argv array */
-struct json_object *drm_info(char *paths[])
+/* paths is a NULL terminated argv array. If it's empty, the primary nodes
+ * matching filter are listed. If blobs is set, the contents of blob
+ * properties are included base64-encoded. */
+struct json_object *drm_info(char *paths[], const struct drm_filter *filter,
+		bool blobs)
 {
 	struct json_object *obj = json_object_new_object();
+	blob_cache.enabled = blobs;
 
 	/* Print everything by default */
 	if (!paths[0]) {
-		drmDevice *devices[64];
-		int n = drmGetDevices(devices, sizeof(devices) / sizeof(devices[0]));
-		if (n < 0) {
-			perror("drmGetDevices");
+		size_t n;
+		struct drm_node *nodes = drm_nodes_list("/sys", DRM_NODE_PRIMARY,
+			filter, &n);
+		if (!nodes) {
 			json_object_put(obj);
+			blob_cache_finish();
 			return NULL;
 		}
 
-		for (int i = 0; i < n; ++i) {
-			drmDevice *dev = devices[i];
-			if (!(dev->available_nodes & (1 << DRM_NODE_PRIMARY)))
-				continue;
-
-			const char *path = dev->nodes[DRM_NODE_PRIMARY];
+		for (size_t i = 0; i < n; ++i) {
+			char path[PATH_MAX];
+			snprintf(path, sizeof(path), "%s/%s", DRM_DIR_NAME, nodes[i].name);
 			struct json_object *dev_obj = node_info(path);
 			if (!dev_obj) {
 				fprintf(stderr, "Failed to retrieve information from %s\n", path);
@@ -897,7 +1194,7 @@ struct json_object *drm_info(char *paths[])
 			json_object_object_add(obj, path, dev_obj);
 		}
 
-		drmFreeDevices(devices, n);
+		free(nodes);
 	} else {
 		for (char **path = paths; *path; ++path) {
 			struct json_object *dev = node_info(*path);
@@ -908,5 +1205,6 @@ struct json_object *drm_info(char *paths[])
 		}
 	}
 
+	blob_cache_finish();
 	return obj;
 }
@@ -1,4 +1,5 @@
 #include <getopt.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,43 +9,449 @@
 #include <json_util.h>
 
 #include "drm_info.h"
+#include "scanout.h"
+
+enum {
+	OPT_CAN_SCANOUT = 256,
+	OPT_GL,
+	OPT_ZERO_COPY,
+	OPT_PRIME,
+	OPT_SYSFS,
+	OPT_BLOBS,
+	OPT_VBLANK,
+	OPT_TRACE,
+	OPT_TRACE_FILE,
+	OPT_CLIENTS,
+	OPT_SAMPLE,
+	OPT_PROBE,
+	OPT_DRIVER,
+	OPT_BUS,
+	OPT_BANDWIDTH,
+	OPT_PLANE_USAGE,
+	OPT_DOCTOR,
+	OPT_PLAN,
+	OPT_ROUTING,
+};
+
+static const struct option long_options[] = {
+	{ "input", required_argument, NULL, 'i' },
+	{ "can-scanout", required_argument, NULL, OPT_CAN_SCANOUT },
+	{ "gl", no_argument, NULL, OPT_GL },
+	{ "zero-copy", no_argument, NULL, OPT_ZERO_COPY },
+	{ "prime", no_argument, NULL, OPT_PRIME },
+	{ "sysfs", optional_argument, NULL, OPT_SYSFS },
+	{ "blobs", no_argument, NULL, OPT_BLOBS },
+	{ "vblank", optional_argument, NULL, OPT_VBLANK },
+	{ "trace", optional_argument, NULL, OPT_TRACE },
+	{ "trace-file", required_argument, NULL, OPT_TRACE_FILE },
+	{ "clients", optional_argument, NULL, OPT_CLIENTS },
+	{ "sample", optional_argument, NULL, OPT_SAMPLE },
+	{ "probe", no_argument, NULL, OPT_PROBE },
+	{ "driver", required_argument, NULL, OPT_DRIVER },
+	{ "bus", required_argument, NULL, OPT_BUS },
+	{ "bandwidth", no_argument, NULL, OPT_BANDWIDTH },
+	{ "plane-usage", no_argument, NULL, OPT_PLANE_USAGE },
+	{ "doctor", no_argument, NULL, OPT_DOCTOR },
+	{ "plan", required_argument, NULL, OPT_PLAN },
+	{ "routing", no_argument, NULL, OPT_ROUTING },
+	{ 0 },
+};
+
+/* What to print, only one can be picked */
+enum mode {
+	MODE_DRM,
+	MODE_EGL,
+	MODE_CAN_SCANOUT,
+	MODE_ZERO_COPY,
+	MODE_PRIME,
+	MODE_SYSFS,
+	MODE_VBLANK,
+	MODE_TRACE,
+	MODE_CLIENTS,
+	MODE_SAMPLE,
+	MODE_PROBE,
+	MODE_BANDWIDTH,
+	MODE_PLANE_USAGE,
+	MODE_DOCTOR,
+	MODE_PLAN,
+	MODE_ROUTING,
+};
+
+static const char *const mode_names[] = {
+	[MODE_EGL] = "-g",
+	[MODE_CAN_SCANOUT] = "--can-scanout",
+	[MODE_ZERO_COPY] = "--zero-copy",
+	[MODE_PRIME] = "--prime",
+	[MODE_SYSFS] = "--sysfs",
+	[MODE_VBLANK] = "--vblank",
+	[MODE_TRACE] = "--trace",
+	[MODE_CLIENTS] = "--clients",
+	[MODE_SAMPLE] = "--sample",
+	[MODE_PROBE] = "--probe",
+	[MODE_BANDWIDTH] = "--bandwidth",
+	[MODE_PLANE_USAGE] = "--plane-usage",
+	[MODE_DOCTOR] = "--doctor",
+	[MODE_PLAN] = "--plan",
+	[MODE_ROUTING] = "--routing",
+};
+
+static const char usage[] =
+	"usage: drm_info [-jg] [--gl] [--blobs] [-i dump.json]\n"
+	"                [--can-scanout format[:modifier]] [--zero-copy]\n"
+	"                [--prime] [--sysfs[=root]] [--vblank[=samples]]\n"
+	"                [--trace[=seconds]] [--trace-file trace_pipe]\n"
+	"                [--clients[=proc]] [--sample[=rate[:seconds]]]\n"
+	"                [--probe] [--driver name] [--bus bus] [--bandwidth]\n"
+	"                [--plane-usage] [--doctor] [--plan layers] [--routing]\n"
+	"                [--] [path]...\n";
+
+struct egl_collect {
+	char **paths;
+	struct json_object *obj;
+};
+
+static void *collect_egl(void *data)
+{
+	struct egl_collect *collect = data;
+	collect->obj = egl_info(collect->paths, false);
+	return NULL;
+}
+
+/* EGL initialization is slow, overlap it with the KMS queries */
+static struct json_object *drm_egl_info(char *paths[],
+		const struct drm_filter *filter, struct json_object **egl_obj)
+{
+	struct egl_collect collect = { .paths = paths };
+	pthread_t thread;
+	int ret = pthread_create(&thread, NULL, collect_egl, &collect);
+	if (ret != 0) {
+		collect_egl(&collect);
+	}
+
+	struct json_object *obj = drm_info(paths, filter, false);
+
+	if (ret == 0) {
+		pthread_join(thread, NULL);
+	}
+	*egl_obj = collect.obj;
+	return obj;
+}
+
+static void set_mode(enum mode *mode, enum mode new_mode)
+{
+	if (*mode != MODE_DRM && *mode != new_mode) {
+		fprintf(stderr, "%s can't be combined with %s\n",
+			mode_names[new_mode], mode_names[*mode]);
+		exit(EXIT_FAILURE);
+	}
+	*mode = new_mode;
+}
+
+/* The dump most modes start from, read from -i or queried from the
+ * devices */
+static struct json_object *load_drm(const char *input, char *paths[],
+		const struct drm_filter *filter, bool blobs)
+{
+	if (!input) {
+		return drm_info(paths, filter, blobs);
+	}
+	struct json_object *obj = json_object_from_file(input);
+	if (!obj) {
+		fprintf(stderr, "%s\n", json_util_get_last_err());
+	}
+	return obj;
+}
 
 int main(int argc, char *argv[])
 {
+	enum mode mode = MODE_DRM;
 	bool json = false;
-	bool egl = false;
+	bool gl = false;
+	const char *input = NULL;
+	const char *sysfs_root = NULL;
+	bool blobs = false;
+	size_t vblank_samples = 0;
+	unsigned trace_seconds = 5;
+	const char *trace_file = NULL;
+	const char *proc_root = NULL;
+	unsigned sample_rate = 0, sample_seconds = 2;
+	const char *plan_spec = NULL;
+	struct drm_filter filter = {0};
+	uint32_t scanout_format = 0;
+	uint64_t scanout_modifier = 0;
 
 	int opt;
-	while ((opt = getopt(argc, argv, "jg")) != -1) {
+	while ((opt = getopt_long(argc, argv, "jgi:", long_options, NULL)) != -1) {
 		switch (opt) {
 		case 'j':
 			json = true;
 			break;
 		case 'g':
-			egl = true;
+			set_mode(&mode, MODE_EGL);
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case OPT_GL:
+			set_mode(&mode, MODE_EGL);
+			gl = true;
+			break;
+		case OPT_ZERO_COPY:
+			set_mode(&mode, MODE_ZERO_COPY);
+			break;
+		case OPT_PRIME:
+			set_mode(&mode, MODE_PRIME);
+			break;
+		case OPT_SYSFS:
+			sysfs_root = optarg ? optarg : "/sys";
+			break;
+		case OPT_BLOBS:
+			blobs = true;
+			break;
+		case OPT_VBLANK:
+			set_mode(&mode, MODE_VBLANK);
+			vblank_samples = optarg ? strtoul(optarg, NULL, 10) : 120;
+			if (vblank_samples < 2) {
+				fprintf(stderr, "--vblank needs at least 2 samples\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPT_TRACE:
+			set_mode(&mode, MODE_TRACE);
+			if (optarg) {
+				char *end;
+				trace_seconds = strtoul(optarg, &end, 10);
+				if (end == optarg || *end != '\0' || trace_seconds == 0) {
+					fprintf(stderr, "--trace needs at least 1 second\n");
+					exit(EXIT_FAILURE);
+				}
+			}
+			break;
+		case OPT_TRACE_FILE:
+			set_mode(&mode, MODE_TRACE);
+			trace_file = optarg;
+			break;
+		case OPT_CLIENTS:
+			set_mode(&mode, MODE_CLIENTS);
+			proc_root = optarg ? optarg : "/proc";
+			break;
+		case OPT_SAMPLE:
+			set_mode(&mode, MODE_SAMPLE);
+			sample_rate = 100;
+			bool sample_valid = true;
+			if (optarg) {
+				char *end;
+				sample_rate = strtoul(optarg, &end, 10);
+				sample_valid = end != optarg;
+				if (sample_valid && *end == ':') {
+					const char *seconds = end + 1;
+					sample_seconds = strtoul(seconds, &end, 10);
+					sample_valid = end != seconds;
+				}
+				sample_valid &= *end == '\0';
+			}
+			if (!sample_valid || sample_rate == 0 || sample_rate > 100000 ||
+					sample_seconds == 0) {
+				fprintf(stderr, "--sample needs a rate between 1 and "
+					"100000 Hz and at least 1 second\n");
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case OPT_PROBE:
+			set_mode(&mode, MODE_PROBE);
+			break;
+		case OPT_DRIVER:
+			filter.driver = optarg;
+			break;
+		case OPT_BUS:
+			filter.bus = optarg;
+			break;
+		case OPT_BANDWIDTH:
+			set_mode(&mode, MODE_BANDWIDTH);
+			break;
+		case OPT_PLANE_USAGE:
+			set_mode(&mode, MODE_PLANE_USAGE);
+			break;
+		case OPT_DOCTOR:
+			set_mode(&mode, MODE_DOCTOR);
+			break;
+		case OPT_PLAN:
+			set_mode(&mode, MODE_PLAN);
+			plan_spec = optarg;
+			break;
+		case OPT_ROUTING:
+			set_mode(&mode, MODE_ROUTING);
+			break;
+		case OPT_CAN_SCANOUT:
+			set_mode(&mode, MODE_CAN_SCANOUT);
+			if (!parse_format_modifier(optarg, &scanout_format,
+					&scanout_modifier)) {
+				fprintf(stderr, "invalid format/modifier: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
 			break;
 		default:
-			fprintf(stderr, "usage: drm_info [-jg] [--] [path]...\n");
+			fprintf(stderr, "%s", usage);
 			exit(opt == '?' ? EXIT_SUCCESS : EXIT_FAILURE);
 		}
 	}
 
-	struct json_object *obj;
-	if(egl)
-		obj = egl_info(&argv[optind]);
-	else
-		obj = drm_info(&argv[optind]);
+	/* --sysfs only selects the root for --sample */
+	if (sysfs_root && mode != MODE_SAMPLE) {
+		set_mode(&mode, MODE_SYSFS);
+	}
+	if (input && (mode == MODE_ZERO_COPY || mode == MODE_SYSFS ||
+			mode == MODE_SAMPLE)) {
+		fprintf(stderr, "-i can't be combined with %s\n", mode_names[mode]);
+		exit(EXIT_FAILURE);
+	}
+	/* Filters apply to the enumeration of KMS devices */
+	if ((filter.driver || filter.bus) && (input || mode == MODE_EGL ||
+			mode == MODE_SYSFS || mode == MODE_SAMPLE)) {
+		fprintf(stderr, "--driver and --bus can't be combined with -i, -g, "
+			"--sysfs or --sample\n");
+		exit(EXIT_FAILURE);
+	}
+
+	char **paths = &argv[optind];
+	struct json_object *drm_obj = NULL, *egl_obj = NULL, *obj = NULL;
+	switch (mode) {
+	case MODE_DRM:
+		obj = load_drm(input, paths, &filter, blobs);
+		break;
+	case MODE_EGL:
+		obj = input ? load_drm(input, paths, &filter, false) :
+			egl_info(paths, gl);
+		break;
+	case MODE_CAN_SCANOUT:
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ?
+			scanout_info(drm_obj, scanout_format, scanout_modifier) : NULL;
+		break;
+	case MODE_ZERO_COPY:
+		drm_obj = drm_egl_info(paths, &filter, &egl_obj);
+		obj = drm_obj && egl_obj ? zero_copy_info(drm_obj, egl_obj) : NULL;
+		break;
+	case MODE_PRIME:
+		/* EGL is optional, the KMS formats alone are still useful */
+		drm_obj = input ? load_drm(input, paths, &filter, false) :
+			drm_egl_info(paths, &filter, &egl_obj);
+		obj = drm_obj ? prime_info(drm_obj, egl_obj) : NULL;
+		break;
+	case MODE_SYSFS:
+		obj = sysfs_info(sysfs_root, paths);
+		break;
+	case MODE_VBLANK:
+		/* With -i, the input is a recording made with --vblank -j */
+		if (input) {
+			drm_obj = load_drm(input, paths, &filter, false);
+		} else {
+			struct json_object *dump_obj = drm_info(paths, &filter, false);
+			drm_obj = dump_obj ? vblank_record(dump_obj, vblank_samples) : NULL;
+			json_object_put(dump_obj);
+		}
+		obj = drm_obj ? vblank_info(drm_obj) : NULL;
+		break;
+	case MODE_TRACE:
+		/* The dump is only used to map CRTC indices to object IDs */
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? trace_info(drm_obj, trace_file, trace_seconds) : NULL;
+		break;
+	case MODE_CLIENTS:
+		/* The dump is only used to match clients to devices */
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? clients_info(drm_obj, proc_root) : NULL;
+		break;
+	case MODE_SAMPLE:
+		obj = sample_info(sysfs_root ? sysfs_root : "/sys", paths,
+			sample_rate, sample_seconds);
+		break;
+	case MODE_PROBE:
+		/* Without a device, a dump is probed with a stand-in driver */
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? probe_info(drm_obj, !input) : NULL;
+		break;
+	case MODE_BANDWIDTH:
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? bandwidth_info(drm_obj) : NULL;
+		break;
+	case MODE_PLANE_USAGE:
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? plane_usage_info(drm_obj) : NULL;
+		break;
+	case MODE_DOCTOR:
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? doctor_info(drm_obj) : NULL;
+		break;
+	case MODE_PLAN:
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? plan_info(drm_obj, plan_spec) : NULL;
+		break;
+	case MODE_ROUTING:
+		drm_obj = load_drm(input, paths, &filter, false);
+		obj = drm_obj ? routing_info(drm_obj) : NULL;
+		break;
+	}
+	json_object_put(drm_obj);
+	json_object_put(egl_obj);
 	if (!obj) {
 		exit(EXIT_FAILURE);
 	}
+
 	if (json) {
 		json_object_to_fd(STDOUT_FILENO, obj,
 			JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED);
 	} else {
-		if(egl)
-			print_egl(obj);
-		else
+		switch (mode) {
+		case MODE_DRM:
 			print_drm(obj);
+			break;
+		case MODE_EGL:
+			print_egl(obj);
+			break;
+		case MODE_CAN_SCANOUT:
+			print_scanout(obj);
+			break;
+		case MODE_ZERO_COPY:
+			print_zero_copy(obj);
+			break;
+		case MODE_PRIME:
+			print_prime(obj);
+			break;
+		case MODE_SYSFS:
+			print_sysfs(obj);
+			break;
+		case MODE_VBLANK:
+			print_vblank(obj);
+			break;
+		case MODE_TRACE:
+			print_trace(obj);
+			break;
+		case MODE_CLIENTS:
+			print_clients(obj);
+			break;
+		case MODE_SAMPLE:
+			print_samples(obj);
+			break;
+		case MODE_PROBE:
+			print_probe(obj);
+			break;
+		case MODE_BANDWIDTH:
+			print_bandwidth(obj);
+			break;
+		case MODE_PLANE_USAGE:
+			print_plane_usage(obj);
+			break;
+		case MODE_DOCTOR:
+			print_doctor(obj);
+			break;
+		case MODE_PLAN:
+			print_plan(obj);
+			break;
+		case MODE_ROUTING:
+			print_routing(obj);
+			break;
+		}
 	}
 	json_object_put(obj);
 	return EXIT_SUCCESS;
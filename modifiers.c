@@ -6,135 +6,69 @@
 
 #include "tables.h"
 
-static void print_nvidia_modifier(uint64_t mod) {
-	if (!(mod & 0x10)) {
-		printf("NVIDIA(unknown)");
-		return;
-	}
-
-	uint64_t h = mod & 0xF;
-	uint64_t k = (mod >> 12) & 0xFF;
-	uint64_t g = (mod >> 20) & 0x3;
-	uint64_t s = (mod >> 22) & 0x1;
-	uint64_t c = (mod >> 23) & 0x7;
-
-	printf("NVIDIA_BLOCK_LINEAR_2D(h=%"PRIu64", k=%"PRIu64", g=%"PRIu64", "
-		"s=%"PRIu64", c=%"PRIu64")", h, k, g, s, c);
-}
-
-static const char *amd_tile_version_str(uint64_t tile_version) {
-	switch (tile_version) {
-	case AMD_FMT_MOD_TILE_VER_GFX9:
-		return "GFX9";
-	case AMD_FMT_MOD_TILE_VER_GFX10:
-		return "GFX10";
-	case AMD_FMT_MOD_TILE_VER_GFX10_RBPLUS:
-		return "GFX10_RBPLUS";
-	case AMD_FMT_MOD_TILE_VER_GFX11:
-		return "GFX11";
-	}
-	return "unknown";
+static uint8_t mod_vendor(uint64_t mod) {
+	return (uint8_t)(mod >> 56);
 }
 
-static const char *amd_tile_str(uint64_t tile, uint64_t tile_version) {
-	switch (tile_version) {
-	case AMD_FMT_MOD_TILE_VER_GFX11:
-		/* fallthrough */
-	case AMD_FMT_MOD_TILE_VER_GFX10_RBPLUS:
-		/* fallthrough */
-	case AMD_FMT_MOD_TILE_VER_GFX10:
-		/* fallthrough */
-	case AMD_FMT_MOD_TILE_VER_GFX9:
-		switch (tile) {
-		case AMD_FMT_MOD_TILE_GFX9_64K_S:
-			return "GFX9_64K_S";
-		case AMD_FMT_MOD_TILE_GFX9_64K_D:
-			return "GFX9_64K_D";
-		case AMD_FMT_MOD_TILE_GFX9_64K_S_X:
-			return "GFX9_64K_S_X";
-		case AMD_FMT_MOD_TILE_GFX9_64K_D_X:
-			return "GFX9_64K_D_X";
-		case AMD_FMT_MOD_TILE_GFX9_64K_R_X:
-			return "GFX9_64K_R_X";
-		case AMD_FMT_MOD_TILE_GFX11_256K_R_X:
-			return "GFX11_256K_R_X";
+/* Prints a field by the name of its value if drm_fourcc.h has one, and
+ * one-bit flags by their name alone */
+static void print_field(FILE *f, const struct modifier_field *field,
+		uint64_t value) {
+	for (size_t i = 0; i < field->values_len; i++) {
+		if (field->values[i].value == value) {
+			fprintf(f, "%s = %s", field->name, field->values[i].name);
+			return;
 		}
 	}
-	return "unknown";
-}
-
-static const char *amd_dcc_block_size_str(uint64_t size) {
-	switch (size) {
-	case AMD_FMT_MOD_DCC_BLOCK_64B:
-		return "64B";
-	case AMD_FMT_MOD_DCC_BLOCK_128B:
-		return "128B";
-	case AMD_FMT_MOD_DCC_BLOCK_256B:
-		return "256B";
+	if (field->mask == 1) {
+		fprintf(f, "%s", field->name);
+	} else {
+		fprintf(f, "%s = %"PRIu64, field->name, value);
 	}
-	return "unknown";
 }
 
-static bool amd_gfx9_tile_is_x_t(uint64_t tile) {
-	switch (tile) {
-	case AMD_FMT_MOD_TILE_GFX9_64K_S_X:
-	case AMD_FMT_MOD_TILE_GFX9_64K_D_X:
-	case AMD_FMT_MOD_TILE_GFX9_64K_R_X:
-		return true;
+/* Decodes a modifier using the field layouts extracted from drm_fourcc.h:
+ * well-known constants are printed as-is, otherwise the vendor's fields are
+ * stripped to find the base modifier or layout and printed as parameters. */
+static void print_generic_modifier(FILE *f, uint64_t mod) {
+	const char *name = basic_modifier_str(mod);
+	if (name) {
+		fprintf(f, "%s", name);
+		return;
 	}
-	return false;
-}
-
-static void print_amd_modifier(uint64_t mod) {
-	uint64_t tile_version = AMD_FMT_MOD_GET(TILE_VERSION, mod);
-	uint64_t tile = AMD_FMT_MOD_GET(TILE, mod);
-	uint64_t dcc = AMD_FMT_MOD_GET(DCC, mod);
-	uint64_t dcc_retile = AMD_FMT_MOD_GET(DCC_RETILE, mod);
 
-	printf("AMD(TILE_VERSION = %s, TILE = %s",
-		amd_tile_version_str(tile_version), amd_tile_str(tile, tile_version));
-
-	if (dcc) {
-		printf(", DCC");
-		if (dcc_retile) {
-			printf(", DCC_RETILE");
-		}
-		if (!dcc_retile && AMD_FMT_MOD_GET(DCC_PIPE_ALIGN, mod)) {
-			printf(", DCC_PIPE_ALIGN");
-		}
-		if (AMD_FMT_MOD_GET(DCC_INDEPENDENT_64B, mod)) {
-			printf(", DCC_INDEPENDENT_64B");
-		}
-		if (AMD_FMT_MOD_GET(DCC_INDEPENDENT_128B, mod)) {
-			printf(", DCC_INDEPENDENT_128B");
-		}
-		uint64_t dcc_max_compressed_block =
-			AMD_FMT_MOD_GET(DCC_MAX_COMPRESSED_BLOCK, mod);
-		printf(", DCC_MAX_COMPRESSED_BLOCK = %s",
-			amd_dcc_block_size_str(dcc_max_compressed_block));
-		if (AMD_FMT_MOD_GET(DCC_CONSTANT_ENCODE, mod)) {
-			printf(", DCC_CONSTANT_ENCODE");
-		}
+	const struct modifier_vendor *vendor = modifier_vendor(mod_vendor(mod));
+	if (!vendor->name) {
+		fprintf(f, "unknown");
+		return;
+	}
+	/* The layout goes first: NVIDIA's block linear layout with all of its
+	 * fields cleared is also DRM_FORMAT_MOD_NVIDIA_16BX2_BLOCK_ONE_GOB */
+	uint64_t base = mod & ~vendor->fields_mask;
+	if (vendor->fields_len > 0 &&
+			(base & ~(0xFFULL << 56)) == vendor->layout_bits) {
+		name = vendor->layout;
+	} else {
+		name = basic_modifier_str(base);
+	}
+	if (!name) {
+		fprintf(f, "%s(unknown)", vendor->name);
+		return;
 	}
 
-	if (tile_version >= AMD_FMT_MOD_TILE_VER_GFX9 && amd_gfx9_tile_is_x_t(tile)) {
-		printf(", PIPE_XOR_BITS = %"PRIu64, AMD_FMT_MOD_GET(PIPE_XOR_BITS, mod));
-		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX9) {
-			printf(", BANK_XOR_BITS = %"PRIu64, AMD_FMT_MOD_GET(BANK_XOR_BITS, mod));
-		}
-		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX10_RBPLUS) {
-			printf(", PACKERS = %"PRIu64, AMD_FMT_MOD_GET(PACKERS, mod));
-		}
-		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX9 && dcc) {
-			printf(", RB = %"PRIu64, AMD_FMT_MOD_GET(RB, mod));
-		}
-		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX9 && dcc &&
-				(dcc_retile || AMD_FMT_MOD_GET(DCC_PIPE_ALIGN, mod))) {
-			printf(", PIPE = %"PRIu64, AMD_FMT_MOD_GET(PIPE, mod));
+	fprintf(f, "%s(", name);
+	bool first = true;
+	for (size_t i = 0; i < vendor->fields_len; i++) {
+		const struct modifier_field *field = &vendor->fields[i];
+		uint64_t value = (mod >> field->shift) & field->mask;
+		if (!value) {
+			continue;
 		}
+		fprintf(f, "%s", first ? "" : ", ");
+		print_field(f, field, value);
+		first = false;
 	}
-
-	printf(")");
+	fprintf(f, ")");
 }
 
 static const char *arm_afbc_block_size_str(uint64_t block_size) {
@@ -163,164 +97,94 @@ static const char *arm_afrc_cu_size_str(uint64_t cu_size) {
 	return "unknown";
 }
 
-static void print_arm_modifier(uint64_t mod) {
+/* AFBC and AFRC reuse the same bits for different flags depending on the
+ * type, which a flat field layout can't describe */
+static void print_arm_modifier(FILE *f, uint64_t mod) {
 	uint64_t type = (mod >> 52) & 0xF;
 	uint64_t value = mod & 0x000FFFFFFFFFFFFFULL;
 
 	switch (type) {
 	case DRM_FORMAT_MOD_ARM_TYPE_AFBC:;
 		uint64_t block_size = value & AFBC_FORMAT_MOD_BLOCK_SIZE_MASK;
-		printf("ARM_AFBC(BLOCK_SIZE = %s", arm_afbc_block_size_str(block_size));
+		fprintf(f, "ARM_AFBC(BLOCK_SIZE = %s", arm_afbc_block_size_str(block_size));
 		if (value & AFBC_FORMAT_MOD_YTR) {
-			printf(", YTR");
+			fprintf(f, ", YTR");
 		}
 		if (value & AFBC_FORMAT_MOD_SPLIT) {
-			printf(", SPLIT");
+			fprintf(f, ", SPLIT");
 		}
 		if (value & AFBC_FORMAT_MOD_SPARSE) {
-			printf(", SPARSE");
+			fprintf(f, ", SPARSE");
 		}
 		if (value & AFBC_FORMAT_MOD_CBR) {
-			printf(", CBR");
+			fprintf(f, ", CBR");
 		}
 		if (value & AFBC_FORMAT_MOD_TILED) {
-			printf(", TILED");
+			fprintf(f, ", TILED");
 		}
 		if (value & AFBC_FORMAT_MOD_SC) {
-			printf(", SC");
+			fprintf(f, ", SC");
 		}
 		if (value & AFBC_FORMAT_MOD_DB) {
-			printf(", DB");
+			fprintf(f, ", DB");
 		}
 		if (value & AFBC_FORMAT_MOD_BCH) {
-			printf(", BCH");
+			fprintf(f, ", BCH");
 		}
 		if (value & AFBC_FORMAT_MOD_USM) {
-			printf(", USM");
+			fprintf(f, ", USM");
 		}
-		printf(")");
+		fprintf(f, ")");
 		break;
 	case DRM_FORMAT_MOD_ARM_TYPE_MISC:
 		switch (mod) {
 		case DRM_FORMAT_MOD_ARM_16X16_BLOCK_U_INTERLEAVED:
-			printf("ARM_16X16_BLOCK_U_INTERLEAVED");
+			fprintf(f, "ARM_16X16_BLOCK_U_INTERLEAVED");
 			break;
 		default:
-			printf("ARM_MISC(unknown)");
+			print_generic_modifier(f, mod);
 		}
 		break;
 	case DRM_FORMAT_MOD_ARM_TYPE_AFRC:;
 		uint64_t cu_size_p0 = value & AFRC_FORMAT_MOD_CU_SIZE_MASK;
 		uint64_t cu_size_p12 = (value >> 4) & AFRC_FORMAT_MOD_CU_SIZE_MASK;
-		printf("ARM_AFRC(");
-		printf("CU_SIZE_P0 = %s", arm_afrc_cu_size_str(cu_size_p0));
-		printf(", CU_SIZE_P12 = %s", arm_afrc_cu_size_str(cu_size_p12));
+		fprintf(f, "ARM_AFRC(");
+		fprintf(f, "CU_SIZE_P0 = %s", arm_afrc_cu_size_str(cu_size_p0));
+		fprintf(f, ", CU_SIZE_P12 = %s", arm_afrc_cu_size_str(cu_size_p12));
 		if (value & AFRC_FORMAT_MOD_LAYOUT_SCAN)
-			printf(", SCAN");
+			fprintf(f, ", SCAN");
 		else
-			printf(", ROT");
-		printf(")");
+			fprintf(f, ", ROT");
+		fprintf(f, ")");
 		break;
 	default:
-		printf("ARM(unknown)");
+		print_generic_modifier(f, mod);
 	}
 }
 
-static const char *amlogic_layout_str(uint64_t layout) {
-	switch (layout) {
-	case AMLOGIC_FBC_LAYOUT_BASIC:
-		return "BASIC";
-	case AMLOGIC_FBC_LAYOUT_SCATTER:
-		return "SCATTER";
+static void write_modifier(FILE *f, uint64_t mod) {
+	if (mod_vendor(mod) == DRM_FORMAT_MOD_VENDOR_ARM) {
+		print_arm_modifier(f, mod);
+	} else {
+		print_generic_modifier(f, mod);
 	}
-	return "unknown";
-}
-
-static void print_amlogic_modifier(uint64_t mod) {
-	uint64_t layout = mod & 0xFF;
-	uint64_t options = (mod >> 8) & 0xFF;
-
-	printf("AMLOGIC_FBC(layout = %s, options = %s)",
-		amlogic_layout_str(layout),
-		(options & AMLOGIC_FBC_OPTION_MEM_SAVING) ? "MEM_SAVING" : "0");
 }
 
-static const char *vivante_color_tiling_str(uint64_t tiling) {
-	switch (tiling) {
-	case 0:
-		return "LINEAR";
-	case DRM_FORMAT_MOD_VIVANTE_TILED:
-		return "TILED";
-	case DRM_FORMAT_MOD_VIVANTE_SUPER_TILED:
-		return "SUPER_TILED";
-	case DRM_FORMAT_MOD_VIVANTE_SPLIT_TILED:
-		return "SPLIT_TILED";
-	case DRM_FORMAT_MOD_VIVANTE_SPLIT_SUPER_TILED:
-		return "SPLIT_SUPER_TILED";
-	}
-	return "Unknown";
-}
-
-static const char *vivante_tile_status_str(uint64_t ts) {
-	switch (ts) {
-	case VIVANTE_MOD_TS_64_4:
-		return "64_4";
-	case VIVANTE_MOD_TS_64_2:
-		return "64_2";
-	case VIVANTE_MOD_TS_128_4:
-		return "128_4";
-	case VIVANTE_MOD_TS_256_4:
-		return "256_4";
-	}
-	return "Unknown";
-}
-
-static const char *vivante_compression_str(uint64_t comp) {
-	switch (comp) {
-	case VIVANTE_MOD_COMP_DEC400:
-		return "DEC400";
-	}
-	return "Unknown";
+void print_modifier(uint64_t mod) {
+	write_modifier(stdout, mod);
+	printf(" (0x%"PRIx64")", mod);
 }
 
-static void print_vivante_modifier(uint64_t mod) {
-	uint64_t ts = mod & VIVANTE_MOD_TS_MASK;
-	uint64_t comp = mod & VIVANTE_MOD_COMP_MASK;
-	uint64_t tiling = mod & ~VIVANTE_MOD_EXT_MASK;
-
-	printf("VIVANTE(tiling = %s", vivante_color_tiling_str(tiling));
-	if (ts != 0) {
-		printf(", ts = %s", vivante_tile_status_str(ts));
+char *modifier_str(uint64_t mod) {
+	char *str;
+	size_t len;
+	FILE *f = open_memstream(&str, &len);
+	if (!f) {
+		return NULL;
 	}
-	if (comp != 0) {
-		printf(", comp = %s", vivante_compression_str(comp));
+	write_modifier(f, mod);
+	if (fclose(f) != 0) {
+		return NULL;
 	}
-	printf(")");
-}
-
-static uint8_t mod_vendor(uint64_t mod) {
-	return (uint8_t)(mod >> 56);
-}
-
-void print_modifier(uint64_t mod) {
-	switch (mod_vendor(mod)) {
-	case DRM_FORMAT_MOD_VENDOR_NVIDIA:
-		print_nvidia_modifier(mod);
-		break;
-	case DRM_FORMAT_MOD_VENDOR_AMD:
-		print_amd_modifier(mod);
-		break;
-	case DRM_FORMAT_MOD_VENDOR_ARM:
-		print_arm_modifier(mod);
-		break;
-	case DRM_FORMAT_MOD_VENDOR_AMLOGIC:
-		print_amlogic_modifier(mod);
-		break;
-	case DRM_FORMAT_MOD_VENDOR_VIVANTE:
-		print_vivante_modifier(mod);
-		break;
-	default:
-		printf("%s", basic_modifier_str(mod));
-	}
-	printf(" (0x%"PRIx64")", mod);
+	return str;
 }
@@ -4,5 +4,7 @@
 #include <stdint.h>
 
 void print_modifier(uint64_t modifier);
+/* Returns a newly allocated name of the modifier, or NULL on error */
+char *modifier_str(uint64_t modifier);
 
 #endif
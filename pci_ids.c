@@ -0,0 +1,218 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pci_ids.h"
+
+static const char *const pci_ids_paths[] = {
+#ifdef PCI_IDS_PATH
+	PCI_IDS_PATH,
+#endif
+	"/usr/share/hwdata/pci.ids",
+	"/usr/share/misc/pci.ids",
+	"/usr/share/pci.ids",
+	"/usr/local/share/hwdata/pci.ids",
+};
+
+/* Names point into the mapped file, which stays mapped until exit */
+struct pci_id {
+	uint32_t key;
+	uint32_t name_len;
+	const char *name;
+};
+
+struct pci_id_list {
+	struct pci_id *data;
+	size_t len, cap;
+};
+
+static struct {
+	bool loaded;
+	const char *data;
+	size_t size;
+	struct pci_id_list vendors; /* keyed by vendor */
+	struct pci_id_list devices; /* keyed by vendor << 16 | device */
+} db;
+
+static bool id_list_add(struct pci_id_list *list, uint32_t key,
+		const char *name, size_t name_len)
+{
+	if (list->len == list->cap) {
+		size_t cap = list->cap ? 2 * list->cap : 1024;
+		struct pci_id *data = realloc(list->data, cap * sizeof(*data));
+		if (!data) {
+			perror("realloc");
+			return false;
+		}
+		list->data = data;
+		list->cap = cap;
+	}
+	list->data[list->len++] = (struct pci_id){ key, name_len, name };
+	return true;
+}
+
+static int id_cmp(const void *a_ptr, const void *b_ptr)
+{
+	const struct pci_id *a = a_ptr, *b = b_ptr;
+	return a->key < b->key ? -1 : a->key > b->key;
+}
+
+static bool parse_hex4(const char *p, const char *end, uint16_t *val)
+{
+	if (end - p < 4) {
+		return false;
+	}
+	*val = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = p[i];
+		int digit;
+		if (c >= '0' && c <= '9') {
+			digit = c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			digit = c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			digit = c - 'A' + 10;
+		} else {
+			return false;
+		}
+		*val = *val << 4 | digit;
+	}
+	return true;
+}
+
+/* Parses "XXXX  Name", returns false on malformed lines */
+static bool parse_entry(const char *p, const char *end, uint16_t *id,
+		const char **name, size_t *name_len)
+{
+	if (!parse_hex4(p, end, id)) {
+		return false;
+	}
+	p += 4;
+	while (p < end && (*p == ' ' || *p == '\t')) {
+		p++;
+	}
+	*name = p;
+	*name_len = end - p;
+	return *name_len > 0;
+}
+
+static bool index_file(const char *data, size_t size)
+{
+	const char *p = data, *data_end = data + size;
+	uint16_t vendor = 0;
+	bool in_vendor = false;
+
+	while (p < data_end) {
+		const char *end = memchr(p, '\n', data_end - p);
+		if (!end) {
+			end = data_end;
+		}
+
+		uint16_t id;
+		const char *name;
+		size_t name_len;
+		if (p[0] == '\t' && p + 1 < end && p[1] != '\t') {
+			/* Device line, subsystem lines start with two tabs */
+			if (in_vendor && parse_entry(p + 1, end, &id, &name, &name_len) &&
+					!id_list_add(&db.devices, (uint32_t)vendor << 16 | id,
+						name, name_len)) {
+				return false;
+			}
+		} else if (p[0] == 'C' && p + 1 < end && p[1] == ' ') {
+			/* Device classes follow all vendors, we don't need them */
+			break;
+		} else if (p[0] != '#' && p[0] != '\t' && p < end) {
+			in_vendor = parse_entry(p, end, &vendor, &name, &name_len);
+			if (in_vendor && !id_list_add(&db.vendors, vendor, name, name_len)) {
+				return false;
+			}
+		}
+
+		p = end + 1;
+	}
+
+	/* pci.ids is sorted already, but don't rely on it */
+	qsort(db.vendors.data, db.vendors.len, sizeof(*db.vendors.data), id_cmp);
+	qsort(db.devices.data, db.devices.len, sizeof(*db.devices.data), id_cmp);
+	return true;
+}
+
+static void load_db(void)
+{
+	db.loaded = true;
+
+	int fd = -1;
+	for (size_t i = 0; i < sizeof(pci_ids_paths) / sizeof(pci_ids_paths[0]); i++) {
+		fd = open(pci_ids_paths[i], O_RDONLY | O_CLOEXEC);
+		if (fd >= 0) {
+			break;
+		}
+	}
+	if (fd < 0) {
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		perror("mmap");
+		return;
+	}
+
+	if (!index_file(data, st.st_size)) {
+		munmap(data, st.st_size);
+		free(db.vendors.data);
+		free(db.devices.data);
+		memset(&db.vendors, 0, sizeof(db.vendors));
+		memset(&db.devices, 0, sizeof(db.devices));
+		return;
+	}
+	db.data = data;
+	db.size = st.st_size;
+}
+
+static const struct pci_id *find_id(const struct pci_id_list *list,
+		uint32_t key)
+{
+	if (list->len == 0) {
+		return NULL;
+	}
+	struct pci_id needle = { .key = key };
+	return bsearch(&needle, list->data, list->len, sizeof(*list->data),
+		id_cmp);
+}
+
+bool pci_ids_lookup(uint16_t vendor, uint16_t device,
+		char *vendor_name, size_t vendor_name_size,
+		char *device_name, size_t device_name_size)
+{
+	if (!db.loaded) {
+		load_db();
+	}
+
+	const struct pci_id *vendor_id = find_id(&db.vendors, vendor);
+	if (!vendor_id) {
+		return false;
+	}
+	snprintf(vendor_name, vendor_name_size, "%.*s",
+		(int)vendor_id->name_len, vendor_id->name);
+
+	const struct pci_id *device_id =
+		find_id(&db.devices, (uint32_t)vendor << 16 | device);
+	if (device_id) {
+		snprintf(device_name, device_name_size, "%.*s",
+			(int)device_id->name_len, device_id->name);
+	} else if (device_name_size > 0) {
+		device_name[0] = '\0';
+	}
+	return true;
+}
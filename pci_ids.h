@@ -0,0 +1,16 @@
+#ifndef PCI_IDS_H
+#define PCI_IDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Look up PCI vendor and device names in the pci.ids database. The file is
+ * mapped and indexed on first use. Returns false if the vendor is unknown or
+ * the database isn't available. If only the vendor is known, device_name is
+ * set to an empty string. */
+bool pci_ids_lookup(uint16_t vendor, uint16_t device,
+	char *vendor_name, size_t vendor_name_size,
+	char *device_name, size_t device_name_size);
+
+#endif
@@ -0,0 +1,263 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <drm_fourcc.h>
+#include <json_object.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+#include "tables.h"
+
+/* Planes left idle mean the GPU composites what the display engine could
+ * scan out directly. For each CRTC, the planes it can use are counted by
+ * type and state, and each idle plane is checked against the formats video
+ * players and cursors typically hand to the compositor. */
+
+/* Common outputs of video decoders */
+static const uint32_t video_formats[] = {
+	DRM_FORMAT_NV12,
+	DRM_FORMAT_P010,
+	DRM_FORMAT_YUYV,
+	DRM_FORMAT_YUV420,
+};
+
+#define CURSOR_FORMAT DRM_FORMAT_ARGB8888
+
+/* DRM_PLANE_TYPE_OVERLAY, PRIMARY and CURSOR */
+#define PLANE_TYPES 3
+
+/* Order of the summary, bottom to top */
+static const uint64_t type_order[PLANE_TYPES] = {
+	DRM_PLANE_TYPE_PRIMARY,
+	DRM_PLANE_TYPE_OVERLAY,
+	DRM_PLANE_TYPE_CURSOR,
+};
+
+static bool has_format(struct json_object *formats_arr, uint32_t format)
+{
+	for (size_t i = 0; i < json_object_array_length(formats_arr); i++) {
+		if (json_object_get_uint64(
+				json_object_array_get_idx(formats_arr, i)) == format) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* IN_FORMATS lists formats per modifier, the plain format list is used by
+ * drivers without it */
+static bool plane_supports(struct json_object *plane_obj, uint32_t format)
+{
+	struct json_object *props_obj =
+		json_object_object_get(plane_obj, "properties");
+	struct json_object *in_formats_arr = json_object_object_get(
+		json_object_object_get(props_obj, "IN_FORMATS"), "data");
+	if (!in_formats_arr) {
+		return has_format(json_object_object_get(plane_obj, "formats"),
+			format);
+	}
+	for (size_t i = 0; i < json_object_array_length(in_formats_arr); i++) {
+		struct json_object *mod_obj =
+			json_object_array_get_idx(in_formats_arr, i);
+		if (has_format(json_object_object_get(mod_obj, "formats"), format)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static struct json_object *idle_plane_info(struct json_object *plane_obj,
+		uint64_t type)
+{
+	struct json_object *props_obj =
+		json_object_object_get(plane_obj, "properties");
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "id",
+		json_object_new_uint64(get_object_object_uint64(plane_obj, "id")));
+	json_object_object_add(obj, "type", json_object_new_uint64(type));
+
+	/* zpos is a range property, immutable ones have min == max */
+	struct json_object *zpos_obj = json_object_object_get(props_obj, "zpos");
+	if (zpos_obj) {
+		struct json_object *spec_obj = json_object_object_get(zpos_obj, "spec");
+		json_object_object_add(obj, "zpos_min", json_object_new_uint64(
+			get_object_object_uint64(spec_obj, "min")));
+		json_object_object_add(obj, "zpos_max", json_object_new_uint64(
+			get_object_object_uint64(spec_obj, "max")));
+	}
+
+	struct json_object *video_arr = json_object_new_array();
+	for (size_t i = 0; i < sizeof(video_formats) / sizeof(video_formats[0]); i++) {
+		if (plane_supports(plane_obj, video_formats[i])) {
+			json_object_array_add(video_arr,
+				json_object_new_uint64(video_formats[i]));
+		}
+	}
+	json_object_object_add(obj, "video_formats", video_arr);
+	json_object_object_add(obj, "cursor",
+		json_object_new_boolean(plane_supports(plane_obj, CURSOR_FORMAT)));
+	return obj;
+}
+
+static struct json_object *crtc_usage_info(struct json_object *crtc_obj,
+		size_t crtc_index, struct json_object *planes_arr)
+{
+	uint32_t crtc_id = get_object_object_uint64(crtc_obj, "id");
+	uint64_t in_use[PLANE_TYPES] = {0}, idle[PLANE_TYPES] = {0},
+		elsewhere[PLANE_TYPES] = {0};
+
+	struct json_object *idle_arr = json_object_new_array();
+	for (size_t i = 0; i < json_object_array_length(planes_arr); i++) {
+		struct json_object *plane_obj = json_object_array_get_idx(planes_arr, i);
+		uint32_t possible_crtcs =
+			get_object_object_uint64(plane_obj, "possible_crtcs");
+		if (!(possible_crtcs & (1u << crtc_index))) {
+			continue;
+		}
+		uint64_t type = get_object_object_uint64(json_object_object_get(
+			json_object_object_get(plane_obj, "properties"), "type"), "value");
+		if (type >= PLANE_TYPES) {
+			continue;
+		}
+
+		uint32_t plane_crtc_id = get_object_object_uint64(plane_obj, "crtc_id");
+		if (plane_crtc_id == crtc_id) {
+			in_use[type]++;
+		} else if (plane_crtc_id != 0) {
+			elsewhere[type]++;
+		} else {
+			idle[type]++;
+			json_object_array_add(idle_arr, idle_plane_info(plane_obj, type));
+		}
+	}
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "id", json_object_new_uint64(crtc_id));
+	json_object_object_add(obj, "active",
+		json_object_new_boolean(json_object_object_get(crtc_obj, "mode") != NULL));
+
+	struct json_object *types_obj = json_object_new_object();
+	for (size_t i = 0; i < PLANE_TYPES; i++) {
+		uint64_t t = type_order[i];
+		if (in_use[t] + idle[t] + elsewhere[t] == 0) {
+			continue;
+		}
+		struct json_object *type_obj = json_object_new_object();
+		json_object_object_add(type_obj, "in_use",
+			json_object_new_uint64(in_use[t]));
+		json_object_object_add(type_obj, "idle", json_object_new_uint64(idle[t]));
+		/* Usable here, but enabled on another CRTC */
+		json_object_object_add(type_obj, "elsewhere",
+			json_object_new_uint64(elsewhere[t]));
+		json_object_object_add(types_obj, plane_type_str(t), type_obj);
+	}
+	json_object_object_add(obj, "types", types_obj);
+	json_object_object_add(obj, "idle_planes", idle_arr);
+	return obj;
+}
+
+struct json_object *plane_usage_info(struct json_object *drm_obj)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+		struct json_object *planes_arr =
+			json_object_object_get(dev_obj, "planes");
+
+		struct json_object *arr = json_object_new_array();
+		/* possible_crtcs is a 32-bit mask of CRTC indices */
+		for (size_t i = 0; i < json_object_array_length(crtcs_arr) && i < 32; i++) {
+			json_object_array_add(arr, crtc_usage_info(
+				json_object_array_get_idx(crtcs_arr, i), i, planes_arr));
+		}
+
+		struct json_object *dev_usage_obj = json_object_new_object();
+		json_object_object_add(dev_usage_obj, "crtcs", arr);
+		json_object_object_add(obj, path, dev_usage_obj);
+	}
+	return obj;
+}
+
+static void print_idle_plane(struct json_object *obj)
+{
+	printf("Plane %"PRIu64" (%s", get_object_object_uint64(obj, "id"),
+		plane_type_str(get_object_object_uint64(obj, "type")));
+	if (json_object_object_get(obj, "zpos_min")) {
+		uint64_t zpos_min = get_object_object_uint64(obj, "zpos_min");
+		uint64_t zpos_max = get_object_object_uint64(obj, "zpos_max");
+		if (zpos_min == zpos_max) {
+			printf(", zpos %"PRIu64, zpos_min);
+		} else {
+			printf(", zpos %"PRIu64"-%"PRIu64, zpos_min, zpos_max);
+		}
+	}
+	printf("): ");
+
+	struct json_object *video_arr = json_object_object_get(obj, "video_formats");
+	size_t video_len = json_object_array_length(video_arr);
+	bool cursor = json_object_get_boolean(json_object_object_get(obj, "cursor"));
+	if (video_len > 0) {
+		printf("video");
+		for (size_t i = 0; i < video_len; i++) {
+			printf("%s%s", i == 0 ? " " : ", ", format_str(
+				json_object_get_uint64(json_object_array_get_idx(video_arr, i))));
+		}
+	}
+	if (cursor) {
+		printf("%scursor", video_len > 0 ? "; " : "");
+	}
+	if (video_len == 0 && !cursor) {
+		printf("no video or cursor format");
+	}
+	printf("\n");
+}
+
+static void print_crtc_usage(struct json_object *obj, const char *prefix)
+{
+	bool active = json_object_get_boolean(json_object_object_get(obj, "active"));
+	printf("CRTC %"PRIu64"%s:", get_object_object_uint64(obj, "id"),
+		active ? "" : " (inactive)");
+
+	bool first = true;
+	json_object_object_foreach(json_object_object_get(obj, "types"), type,
+			type_obj) {
+		uint64_t elsewhere = get_object_object_uint64(type_obj, "elsewhere");
+		printf("%s %s %"PRIu64"/%"PRIu64" in use", first ? "" : ",", type,
+			get_object_object_uint64(type_obj, "in_use"),
+			get_object_object_uint64(type_obj, "in_use") +
+			get_object_object_uint64(type_obj, "idle") + elsewhere);
+		if (elsewhere) {
+			printf(" (%"PRIu64" elsewhere)", elsewhere);
+		}
+		first = false;
+	}
+	printf("%s\n", first ? " no plane" : "");
+
+	struct json_object *idle_arr = json_object_object_get(obj, "idle_planes");
+	size_t idle_len = json_object_array_length(idle_arr);
+	for (size_t i = 0; i < idle_len; i++) {
+		printf("%s%s", prefix, i == idle_len - 1 ? L_LAST : L_VAL);
+		print_idle_plane(json_object_array_get_idx(idle_arr, i));
+	}
+}
+
+void print_plane_usage(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, dev_obj) {
+		printf("Node: %s\n", path);
+
+		struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+		size_t crtcs_len = json_object_array_length(crtcs_arr);
+		if (crtcs_len == 0) {
+			printf(L_LAST "No CRTC\n");
+		}
+		for (size_t i = 0; i < crtcs_len; i++) {
+			bool last = i == crtcs_len - 1;
+			printf("%s", last ? L_LAST : L_VAL);
+			print_crtc_usage(json_object_array_get_idx(crtcs_arr, i),
+				last ? L_GAP : L_LINE);
+		}
+	}
+}
@@ -0,0 +1,671 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <drm_fourcc.h>
+#include <json_object.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+#include "modifiers.h"
+#include "scanout.h"
+#include "tables.h"
+
+/* Answers whether a set of layers fits on the planes of a device, e.g.
+ * "XRGB8888@1920x1080,NV12@1280x720;XRGB8888": layers are listed bottom to
+ * top, and each output, separated by ';', needs a CRTC of its own.
+ *
+ * Layers are placed one after the other with backtracking. Planes and CRTCs
+ * in use are kept as bitmasks, and the planes a layer may use regardless of
+ * the others (format, modifier and size) are computed once up front. A
+ * search state is fully described by the next layer, the planes and CRTCs
+ * in use, the CRTC of the current output and the zpos of the layer below,
+ * so states which failed once are remembered and never searched again.
+ * Interchangeable planes are always taken in the same order, which keeps
+ * the number of distinct states small on hardware with many overlays.
+ *
+ * The bottom layer of an output goes on a primary plane, as drivers need
+ * one to light up a CRTC. Planes without a zpos property are stacked by
+ * type. */
+
+#define PLAN_LAYERS_MAX 64
+/* Bounds the search when the memo doesn't help */
+#define PLAN_STATES_MAX (1 << 22)
+/* zpos values are clamped to fit in the memo key */
+#define PLAN_ZPOS_MAX 0xFFFE
+
+enum plan_constraint {
+	PLAN_FORMAT,
+	PLAN_SIZE,
+	PLAN_CRTC,
+	PLAN_POSSIBLE_CRTCS,
+	PLAN_IN_USE,
+	PLAN_PRIMARY,
+	PLAN_ZPOS,
+	PLAN_LIMIT,
+	PLAN_CONSTRAINTS,
+};
+
+static const char *const plan_constraint_names[PLAN_CONSTRAINTS] = {
+	[PLAN_FORMAT] = "format",
+	[PLAN_SIZE] = "size",
+	[PLAN_CRTC] = "crtc",
+	[PLAN_POSSIBLE_CRTCS] = "possible_crtcs",
+	[PLAN_IN_USE] = "in_use",
+	[PLAN_PRIMARY] = "primary",
+	[PLAN_ZPOS] = "zpos",
+	[PLAN_LIMIT] = "search_limit",
+};
+
+static const char *const plan_constraint_descs[PLAN_CONSTRAINTS] = {
+	[PLAN_FORMAT] = "no plane supports the format and modifier",
+	[PLAN_SIZE] = "larger than the planes supporting its format allow",
+	[PLAN_CRTC] = "no CRTC left for the output",
+	[PLAN_POSSIBLE_CRTCS] = "plane can't be used on the output's CRTC",
+	[PLAN_IN_USE] = "plane already used by another layer",
+	[PLAN_PRIMARY] = "only the bottom layer can use a primary plane",
+	[PLAN_ZPOS] = "plane can't be stacked above the layer below",
+	[PLAN_LIMIT] = "too many states searched",
+};
+
+struct plan_layer {
+	uint32_t format;
+	uint64_t modifier;
+	uint32_t width, height; /* 0 if not given */
+	size_t output;
+	bool bottom;
+};
+
+struct plan_plane {
+	uint32_t id;
+	uint64_t type;
+	uint32_t possible_crtcs;
+	uint32_t zpos_min, zpos_max;
+};
+
+struct plan_memo_entry {
+	uint64_t planes;
+	uint64_t rest;
+	bool used;
+};
+
+struct plan {
+	const struct plan_layer *layers;
+	size_t layers_len;
+	struct plan_plane planes[SCANOUT_MAX_PLANES];
+	size_t planes_len;
+	/* Plane indices sorted by zpos_min, so that lower planes are tried
+	 * first */
+	size_t order[SCANOUT_MAX_PLANES];
+	uint32_t crtc_ids[SCANOUT_MAX_CRTCS];
+	size_t crtcs_len;
+	uint64_t layer_planes[PLAN_LAYERS_MAX];
+	/* Lower indexed planes interchangeable with each plane. Of those,
+	 * only the first free one is tried. */
+	uint64_t same_lower[SCANOUT_MAX_PLANES];
+
+	/* Current assignment */
+	size_t layer_plane[PLAN_LAYERS_MAX];
+	uint32_t layer_zpos[PLAN_LAYERS_MAX];
+	size_t output_crtc[PLAN_LAYERS_MAX];
+
+	/* Failed states */
+	struct plan_memo_entry *memo;
+	size_t memo_cap, memo_len;
+
+	size_t states, memo_hits;
+	/* Constraints which rejected candidates, for the deepest layer reached */
+	size_t deepest;
+	uint32_t failed[PLAN_LAYERS_MAX];
+	bool limit;
+};
+
+static bool parse_layer(char *str, struct plan_layer *layer)
+{
+	char *size = strchr(str, '@');
+	if (size) {
+		*size++ = '\0';
+		char *end;
+		layer->width = strtoul(size, &end, 10);
+		if (*end != 'x') {
+			return false;
+		}
+		layer->height = strtoul(end + 1, &end, 10);
+		if (*end != '\0' || layer->width == 0 || layer->height == 0) {
+			return false;
+		}
+	}
+	return parse_format_modifier(str, &layer->format, &layer->modifier);
+}
+
+/* Returns the number of layers, or 0 if the spec is invalid */
+static size_t parse_spec(const char *spec, struct plan_layer *layers)
+{
+	char *copy = strdup(spec);
+	if (!copy) {
+		perror("strdup");
+		return 0;
+	}
+
+	size_t len = 0, outputs = 0;
+	char *output_save, *layer_save;
+	for (char *output = strtok_r(copy, ";", &output_save); output;
+			output = strtok_r(NULL, ";", &output_save)) {
+		bool bottom = true;
+		for (char *str = strtok_r(output, ",", &layer_save); str;
+				str = strtok_r(NULL, ",", &layer_save)) {
+			if (len == PLAN_LAYERS_MAX) {
+				fprintf(stderr, "--plan: at most %d layers\n", PLAN_LAYERS_MAX);
+				free(copy);
+				return 0;
+			}
+			struct plan_layer *layer = &layers[len++];
+			*layer = (struct plan_layer){ .output = outputs, .bottom = bottom };
+			if (!parse_layer(str, layer)) {
+				fprintf(stderr, "--plan: invalid layer: %s\n", str);
+				free(copy);
+				return 0;
+			}
+			bottom = false;
+		}
+		outputs++;
+	}
+	free(copy);
+	if (len == 0) {
+		fprintf(stderr, "--plan: no layer given\n");
+	}
+	return len;
+}
+
+static void sort_planes(struct plan *plan)
+{
+	/* Insertion sort, there are at most 64 planes */
+	for (size_t i = 0; i < plan->planes_len; i++) {
+		plan->order[i] = i;
+		for (size_t j = i; j > 0 &&
+				plan->planes[plan->order[j]].zpos_min <
+				plan->planes[plan->order[j - 1]].zpos_min; j--) {
+			size_t tmp = plan->order[j];
+			plan->order[j] = plan->order[j - 1];
+			plan->order[j - 1] = tmp;
+		}
+	}
+}
+
+static void load_planes(struct plan *plan, struct json_object *dev_obj,
+		const struct scanout_index *index)
+{
+	struct json_object *planes_arr = json_object_object_get(dev_obj, "planes");
+	plan->planes_len = index->planes_len;
+	for (size_t i = 0; i < plan->planes_len; i++) {
+		struct json_object *plane_obj = json_object_array_get_idx(planes_arr, i);
+		struct json_object *props_obj =
+			json_object_object_get(plane_obj, "properties");
+		struct plan_plane *plane = &plan->planes[i];
+		plane->id = index->plane_ids[i];
+		plane->possible_crtcs = index->plane_crtcs[i];
+		plane->type = get_object_object_uint64(
+			json_object_object_get(props_obj, "type"), "value");
+
+		struct json_object *zpos_obj = json_object_object_get(props_obj, "zpos");
+		if (zpos_obj) {
+			struct json_object *spec_obj =
+				json_object_object_get(zpos_obj, "spec");
+			uint64_t min = get_object_object_uint64(spec_obj, "min");
+			uint64_t max = get_object_object_uint64(spec_obj, "max");
+			plane->zpos_min = min < PLAN_ZPOS_MAX ? min : PLAN_ZPOS_MAX;
+			plane->zpos_max = max < PLAN_ZPOS_MAX ? max : PLAN_ZPOS_MAX;
+		} else if (plane->type == DRM_PLANE_TYPE_PRIMARY) {
+			plane->zpos_min = plane->zpos_max = 0;
+		} else if (plane->type == DRM_PLANE_TYPE_CURSOR) {
+			plane->zpos_min = plane->zpos_max = PLAN_ZPOS_MAX;
+		} else {
+			plane->zpos_min = 1;
+			plane->zpos_max = PLAN_ZPOS_MAX - 1;
+		}
+	}
+	sort_planes(plan);
+}
+
+/* Planes each layer may use on its own. Returns false and fills the
+ * constraint if a layer can't use any. */
+static bool filter_layers(struct plan *plan, const struct scanout_index *index,
+		struct json_object *dev_obj, size_t *layer,
+		enum plan_constraint *constraint)
+{
+	struct json_object *caps_obj = json_object_object_get(
+		json_object_object_get(dev_obj, "driver"), "caps");
+	struct json_object *fb_size_obj = json_object_object_get(dev_obj, "fb_size");
+	uint64_t cursor_width = get_object_object_uint64(caps_obj, "CURSOR_WIDTH");
+	uint64_t cursor_height = get_object_object_uint64(caps_obj, "CURSOR_HEIGHT");
+	uint64_t max_width = get_object_object_uint64(fb_size_obj, "max_width");
+	uint64_t max_height = get_object_object_uint64(fb_size_obj, "max_height");
+
+	for (size_t k = 0; k < plan->layers_len; k++) {
+		const struct plan_layer *l = &plan->layers[k];
+		struct scanout_entry entry;
+		scanout_index_lookup(index, l->format, l->modifier, &entry);
+		uint64_t planes = entry.planes;
+		if (!planes) {
+			*layer = k;
+			*constraint = PLAN_FORMAT;
+			return false;
+		}
+
+		for (size_t p = 0; p < plan->planes_len; p++) {
+			bool cursor = plan->planes[p].type == DRM_PLANE_TYPE_CURSOR;
+			if ((max_width && l->width > max_width) ||
+					(max_height && l->height > max_height) ||
+					(cursor && cursor_width && l->width > cursor_width) ||
+					(cursor && cursor_height && l->height > cursor_height)) {
+				planes &= ~(1ULL << p);
+			}
+		}
+		if (!planes) {
+			*layer = k;
+			*constraint = PLAN_SIZE;
+			return false;
+		}
+		plan->layer_planes[k] = planes;
+	}
+	return true;
+}
+
+static void find_same_planes(struct plan *plan)
+{
+	for (size_t p = 0; p < plan->planes_len; p++) {
+		const struct plan_plane *plane = &plan->planes[p];
+		for (size_t q = 0; q < p; q++) {
+			const struct plan_plane *other = &plan->planes[q];
+			bool same = other->type == plane->type &&
+				other->possible_crtcs == plane->possible_crtcs &&
+				other->zpos_min == plane->zpos_min &&
+				other->zpos_max == plane->zpos_max;
+			for (size_t k = 0; same && k < plan->layers_len; k++) {
+				same = !(plan->layer_planes[k] & (1ULL << p)) ==
+					!(plan->layer_planes[k] & (1ULL << q));
+			}
+			if (same) {
+				plan->same_lower[p] |= 1ULL << q;
+			}
+		}
+	}
+}
+
+static uint64_t memo_rest(size_t k, uint32_t crtcs, size_t crtc,
+		uint32_t zfloor)
+{
+	return k | (uint64_t)crtc << 8 | (uint64_t)zfloor << 16 |
+		(uint64_t)crtcs << 32;
+}
+
+static struct plan_memo_entry *memo_find(struct plan_memo_entry *memo,
+		size_t cap, uint64_t planes, uint64_t rest)
+{
+	/* Same open addressing as the scanout index */
+	uint64_t h = (planes ^ (rest * 0xC2B2AE3D27D4EB4FULL)) *
+		0x9E3779B97F4A7C15ULL;
+	size_t i = (h ^ (h >> 32)) & (cap - 1);
+	while (memo[i].used && (memo[i].planes != planes || memo[i].rest != rest)) {
+		i = (i + 1) & (cap - 1);
+	}
+	return &memo[i];
+}
+
+static void memo_add(struct plan *plan, uint64_t planes, uint64_t rest)
+{
+	if (2 * (plan->memo_len + 1) > plan->memo_cap) {
+		size_t cap = plan->memo_cap ? 2 * plan->memo_cap : 1024;
+		struct plan_memo_entry *memo = calloc(cap, sizeof(*memo));
+		if (!memo) {
+			/* Only costs time */
+			return;
+		}
+		for (size_t i = 0; i < plan->memo_cap; i++) {
+			struct plan_memo_entry *entry = &plan->memo[i];
+			if (entry->used) {
+				*memo_find(memo, cap, entry->planes, entry->rest) = *entry;
+			}
+		}
+		free(plan->memo);
+		plan->memo = memo;
+		plan->memo_cap = cap;
+	}
+
+	struct plan_memo_entry *entry =
+		memo_find(plan->memo, plan->memo_cap, planes, rest);
+	if (!entry->used) {
+		*entry = (struct plan_memo_entry){ planes, rest, true };
+		plan->memo_len++;
+	}
+}
+
+static bool memo_has(const struct plan *plan, uint64_t planes, uint64_t rest)
+{
+	return plan->memo_cap &&
+		memo_find(plan->memo, plan->memo_cap, planes, rest)->used;
+}
+
+static bool search(struct plan *plan, size_t k, uint64_t used_planes,
+	uint32_t used_crtcs, size_t crtc, uint32_t zfloor);
+
+/* Tries the planes of the CRTC for layer k, zfloor is one above the zpos of
+ * the layer below */
+static bool place(struct plan *plan, size_t k, uint64_t used_planes,
+		uint32_t used_crtcs, size_t crtc, uint32_t zfloor)
+{
+	const struct plan_layer *layer = &plan->layers[k];
+	for (size_t i = 0; i < plan->planes_len; i++) {
+		size_t p = plan->order[i];
+		uint64_t bit = 1ULL << p;
+		const struct plan_plane *plane = &plan->planes[p];
+		if (!(plan->layer_planes[k] & bit)) {
+			continue;
+		}
+		if (!(plane->possible_crtcs & (1U << crtc))) {
+			plan->failed[k] |= 1U << PLAN_POSSIBLE_CRTCS;
+			continue;
+		}
+		if (used_planes & bit) {
+			plan->failed[k] |= 1U << PLAN_IN_USE;
+			continue;
+		}
+		if (plan->same_lower[p] & ~used_planes) {
+			continue;
+		}
+		if (layer->bottom != (plane->type == DRM_PLANE_TYPE_PRIMARY)) {
+			plan->failed[k] |= 1U << PLAN_PRIMARY;
+			continue;
+		}
+		uint32_t zpos = plane->zpos_min > zfloor ? plane->zpos_min : zfloor;
+		if (zpos > plane->zpos_max) {
+			plan->failed[k] |= 1U << PLAN_ZPOS;
+			continue;
+		}
+
+		plan->layer_plane[k] = p;
+		plan->layer_zpos[k] = zpos;
+		if (search(plan, k + 1, used_planes | bit, used_crtcs, crtc,
+				zpos + 1)) {
+			return true;
+		}
+		if (plan->limit) {
+			return false;
+		}
+	}
+	return false;
+}
+
+static bool search(struct plan *plan, size_t k, uint64_t used_planes,
+		uint32_t used_crtcs, size_t crtc, uint32_t zfloor)
+{
+	if (k == plan->layers_len) {
+		return true;
+	}
+	if (k > plan->deepest) {
+		plan->deepest = k;
+	}
+
+	const struct plan_layer *layer = &plan->layers[k];
+	if (layer->bottom) {
+		/* The previous output doesn't matter anymore */
+		crtc = 0;
+		zfloor = 0;
+	}
+	uint64_t rest = memo_rest(k, used_crtcs, crtc, zfloor);
+	if (memo_has(plan, used_planes, rest)) {
+		plan->memo_hits++;
+		return false;
+	}
+	if (++plan->states > PLAN_STATES_MAX) {
+		plan->failed[k] |= 1U << PLAN_LIMIT;
+		plan->limit = true;
+		return false;
+	}
+
+	if (!layer->bottom) {
+		if (place(plan, k, used_planes, used_crtcs, crtc, zfloor)) {
+			return true;
+		}
+	} else {
+		bool free_crtc = false;
+		for (size_t c = 0; c < plan->crtcs_len; c++) {
+			if (used_crtcs & (1U << c)) {
+				continue;
+			}
+			free_crtc = true;
+			plan->output_crtc[layer->output] = c;
+			if (place(plan, k, used_planes, used_crtcs | (1U << c), c, 0)) {
+				return true;
+			}
+			if (plan->limit) {
+				return false;
+			}
+		}
+		if (!free_crtc) {
+			plan->failed[k] |= 1U << PLAN_CRTC;
+		}
+	}
+
+	if (!plan->limit) {
+		memo_add(plan, used_planes, rest);
+	}
+	return false;
+}
+
+static struct json_object *assignment_info(const struct plan *plan)
+{
+	struct json_object *outputs_arr = json_object_new_array();
+	struct json_object *layers_arr = NULL;
+	for (size_t k = 0; k < plan->layers_len; k++) {
+		const struct plan_layer *layer = &plan->layers[k];
+		if (layer->bottom) {
+			struct json_object *output_obj = json_object_new_object();
+			json_object_object_add(output_obj, "crtc", json_object_new_uint64(
+				plan->crtc_ids[plan->output_crtc[layer->output]]));
+			layers_arr = json_object_new_array();
+			json_object_object_add(output_obj, "layers", layers_arr);
+			json_object_array_add(outputs_arr, output_obj);
+		}
+
+		struct json_object *layer_obj = json_object_new_object();
+		json_object_object_add(layer_obj, "format",
+			json_object_new_uint64(layer->format));
+		json_object_object_add(layer_obj, "modifier",
+			json_object_new_uint64(layer->modifier));
+		json_object_object_add(layer_obj, "width",
+			json_object_new_uint64(layer->width));
+		json_object_object_add(layer_obj, "height",
+			json_object_new_uint64(layer->height));
+		json_object_object_add(layer_obj, "plane", json_object_new_uint64(
+			plan->planes[plan->layer_plane[k]].id));
+		json_object_object_add(layer_obj, "zpos",
+			json_object_new_uint64(plan->layer_zpos[k]));
+		json_object_array_add(layers_arr, layer_obj);
+	}
+	return outputs_arr;
+}
+
+static struct json_object *failure_info(const struct plan *plan, size_t k,
+		uint32_t constraints)
+{
+	const struct plan_layer *layer = &plan->layers[k];
+	size_t first = k;
+	while (!plan->layers[first].bottom) {
+		first--;
+	}
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "output", json_object_new_uint64(layer->output));
+	json_object_object_add(obj, "layer", json_object_new_uint64(k - first));
+	json_object_object_add(obj, "format", json_object_new_uint64(layer->format));
+	json_object_object_add(obj, "modifier",
+		json_object_new_uint64(layer->modifier));
+	struct json_object *arr = json_object_new_array();
+	for (size_t i = 0; i < PLAN_CONSTRAINTS; i++) {
+		if (constraints & (1U << i)) {
+			json_object_array_add(arr,
+				json_object_new_string(plan_constraint_names[i]));
+		}
+	}
+	json_object_object_add(obj, "constraints", arr);
+	return obj;
+}
+
+static struct json_object *plan_device(struct json_object *dev_obj,
+		const struct plan_layer *layers, size_t layers_len)
+{
+	struct scanout_index *index = scanout_index_create(dev_obj);
+	if (!index) {
+		return NULL;
+	}
+	struct plan *plan = calloc(1, sizeof(*plan));
+	if (!plan) {
+		perror("calloc");
+		scanout_index_destroy(index);
+		return NULL;
+	}
+	plan->layers = layers;
+	plan->layers_len = layers_len;
+	plan->crtcs_len = index->crtcs_len;
+	memcpy(plan->crtc_ids, index->crtc_ids, sizeof(plan->crtc_ids));
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	load_planes(plan, dev_obj, index);
+	size_t failed_layer;
+	enum plan_constraint constraint;
+	bool feasible = false;
+	uint32_t constraints;
+	if (!filter_layers(plan, index, dev_obj, &failed_layer, &constraint)) {
+		constraints = 1U << constraint;
+	} else {
+		find_same_planes(plan);
+		feasible = search(plan, 0, 0, 0, 0, 0);
+		failed_layer = plan->deepest;
+		constraints = plan->failed[plan->deepest];
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	int64_t duration_ns = (int64_t)(end.tv_sec - start.tv_sec) * 1000000000 +
+		(end.tv_nsec - start.tv_nsec);
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "feasible", json_object_new_boolean(feasible));
+	if (feasible) {
+		json_object_object_add(obj, "outputs", assignment_info(plan));
+	} else {
+		json_object_object_add(obj, "failed",
+			failure_info(plan, failed_layer, constraints));
+	}
+	json_object_object_add(obj, "states", json_object_new_uint64(plan->states));
+	json_object_object_add(obj, "memo_hits",
+		json_object_new_uint64(plan->memo_hits));
+	json_object_object_add(obj, "duration_ns",
+		json_object_new_int64(duration_ns));
+
+	free(plan->memo);
+	free(plan);
+	scanout_index_destroy(index);
+	return obj;
+}
+
+struct json_object *plan_info(struct json_object *drm_obj, const char *spec)
+{
+	struct plan_layer layers[PLAN_LAYERS_MAX];
+	size_t layers_len = parse_spec(spec, layers);
+	if (layers_len == 0) {
+		return NULL;
+	}
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		struct json_object *plan_obj = plan_device(dev_obj, layers, layers_len);
+		if (plan_obj) {
+			json_object_object_add(obj, path, plan_obj);
+		}
+	}
+	return obj;
+}
+
+static void print_layer(struct json_object *obj)
+{
+	uint32_t fmt = get_object_object_uint64(obj, "format");
+	printf("%s ", format_str(fmt));
+	print_modifier(get_object_object_uint64(obj, "modifier"));
+	uint64_t width = get_object_object_uint64(obj, "width");
+	uint64_t height = get_object_object_uint64(obj, "height");
+	if (width && height) {
+		printf(" %"PRIu64"x%"PRIu64, width, height);
+	}
+}
+
+void print_plan(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, dev_obj) {
+		printf("Node: %s\n", path);
+
+		bool feasible =
+			json_object_get_boolean(json_object_object_get(dev_obj, "feasible"));
+		printf("%s%s, %"PRIu64" states searched (%"PRIu64" memoized) "
+			"in %.3f ms\n", feasible ? L_VAL : L_LAST,
+			feasible ? "Feasible" : "Not feasible",
+			get_object_object_uint64(dev_obj, "states"),
+			get_object_object_uint64(dev_obj, "memo_hits"),
+			get_object_object_uint64(dev_obj, "duration_ns") / 1e6);
+
+		if (!feasible) {
+			struct json_object *failed_obj =
+				json_object_object_get(dev_obj, "failed");
+			printf(L_GAP L_LAST "Layer %"PRIu64" of output %"PRIu64": ",
+				get_object_object_uint64(failed_obj, "layer"),
+				get_object_object_uint64(failed_obj, "output"));
+			print_layer(failed_obj);
+			printf("\n");
+			struct json_object *arr =
+				json_object_object_get(failed_obj, "constraints");
+			size_t len = json_object_array_length(arr);
+			for (size_t i = 0; i < len; i++) {
+				const char *name = json_object_get_string(
+					json_object_array_get_idx(arr, i));
+				const char *desc = name;
+				for (size_t c = 0; c < PLAN_CONSTRAINTS; c++) {
+					if (strcmp(plan_constraint_names[c], name) == 0) {
+						desc = plan_constraint_descs[c];
+					}
+				}
+				printf(L_GAP L_GAP "%s%s (%s)\n",
+					i == len - 1 ? L_LAST : L_VAL, desc, name);
+			}
+			continue;
+		}
+
+		struct json_object *outputs_arr = json_object_object_get(dev_obj, "outputs");
+		size_t outputs_len = json_object_array_length(outputs_arr);
+		for (size_t i = 0; i < outputs_len; i++) {
+			bool last = i == outputs_len - 1;
+			struct json_object *output_obj =
+				json_object_array_get_idx(outputs_arr, i);
+			printf("%sOutput %zu: CRTC %"PRIu64"\n", last ? L_LAST : L_VAL, i,
+				get_object_object_uint64(output_obj, "crtc"));
+
+			struct json_object *layers_arr =
+				json_object_object_get(output_obj, "layers");
+			size_t layers_len = json_object_array_length(layers_arr);
+			for (size_t j = 0; j < layers_len; j++) {
+				struct json_object *layer_obj =
+					json_object_array_get_idx(layers_arr, j);
+				printf("%s%sLayer %zu: ", last ? L_GAP : L_LINE,
+					j == layers_len - 1 ? L_LAST : L_VAL, j);
+				print_layer(layer_obj);
+				printf(" on plane %"PRIu64", zpos %"PRIu64"\n",
+					get_object_object_uint64(layer_obj, "plane"),
+					get_object_object_uint64(layer_obj, "zpos"));
+			}
+		}
+	}
+}
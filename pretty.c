@@ -7,49 +7,14 @@
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
-#ifdef HAVE_LIBPCI
-#include <pci/pci.h>
-#endif
-
+#include "color.h"
 #include "drm_info.h"
+#include "edid.h"
 #include "modifiers.h"
+#include "pci_ids.h"
+#include "props.h"
 #include "tables.h"
 
-#define L_LINE "│   "
-#define L_VAL  "├───"
-#define L_LAST "└───"
-#define L_GAP  "    "
-
-static const char *get_object_object_string(struct json_object *obj,
-		const char *key)
-{
-	struct json_object *str_obj = json_object_object_get(obj, key);
-	if (!str_obj) {
-		return NULL;
-	}
-	return json_object_get_string(str_obj);
-}
-
-static uint64_t get_object_object_uint64(struct json_object *obj,
-		const char *key)
-{
-	struct json_object *uint64_obj = json_object_object_get(obj, key);
-	if (!uint64_obj) {
-		return 0;
-	}
-	return json_object_get_uint64(uint64_obj);
-}
-
-static double get_object_object_double(struct json_object *obj,
-		const char *key)
-{
-	struct json_object *double_obj = json_object_object_get(obj, key);
-	if (!double_obj) {
-		return 0;
-	}
-	return json_object_get_double(double_obj);
-}
-
 static void print_driver(struct json_object *obj)
 {
 	const char *name = get_object_object_string(obj, "name");
@@ -136,17 +101,24 @@ static void print_device(struct json_object *obj)
 		uint16_t pci_vendor = get_object_object_uint64(data_obj, "vendor");
 		uint16_t pci_device = get_object_object_uint64(data_obj, "device");
 		printf(" %04x:%04x", pci_vendor, pci_device);
-#ifdef HAVE_LIBPCI
-		struct pci_access *pci = pci_alloc();
-		pci_init(pci);
-		char name[512];
-		if (pci_lookup_name(pci, name, sizeof(name),
-				PCI_LOOKUP_VENDOR | PCI_LOOKUP_DEVICE,
-				pci_vendor, pci_device)) {
-			printf(" %s", name);
+		/* Older dumps don't have the names */
+		const char *vendor_name =
+			get_object_object_string(data_obj, "vendor_name");
+		const char *device_name =
+			get_object_object_string(data_obj, "device_name");
+		char vendor_buf[256], device_buf[256];
+		if (!vendor_name && pci_ids_lookup(pci_vendor, pci_device,
+				vendor_buf, sizeof(vendor_buf),
+				device_buf, sizeof(device_buf))) {
+			vendor_name = vendor_buf;
+			device_name = device_buf[0] ? device_buf : NULL;
+		}
+		if (vendor_name) {
+			printf(" %s", vendor_name);
+		}
+		if (device_name) {
+			printf(" %s", device_name);
 		}
-		pci_cleanup(pci);
-#endif
 		break;
 	case DRM_BUS_USB:;
 		uint16_t usb_vendor = get_object_object_uint64(data_obj, "vendor");
@@ -177,15 +149,17 @@ static void print_device(struct json_object *obj)
 
 // The refresh rate provided by the mode itself is inaccurate,
 // so we calculate it ourself.
-static int32_t refresh_rate(struct json_object *obj) {
-	int clock = get_object_object_uint64(obj, "clock");
-	int htotal = get_object_object_uint64(obj, "htotal");
-	int vtotal = get_object_object_uint64(obj, "vtotal");
-	int vscan = get_object_object_uint64(obj, "vscan");
-	int flags = get_object_object_uint64(obj, "flags");
+double mode_refresh_rate(struct json_object *obj) {
+	uint64_t clock = get_object_object_uint64(obj, "clock");
+	uint64_t htotal = get_object_object_uint64(obj, "htotal");
+	uint64_t vtotal = get_object_object_uint64(obj, "vtotal");
+	uint64_t vscan = get_object_object_uint64(obj, "vscan");
+	uint64_t flags = get_object_object_uint64(obj, "flags");
+
+	if (htotal == 0 || vtotal == 0)
+		return 0;
 
-	int32_t refresh = (clock * 1000000LL / htotal +
-		vtotal / 2) / vtotal;
+	double refresh = clock * 1000.0 / (htotal * vtotal);
 
 	if (flags & DRM_MODE_FLAG_INTERLACE)
 		refresh *= 2;
@@ -199,6 +173,11 @@ static int32_t refresh_rate(struct json_object *obj) {
 	return refresh;
 }
 
+// In mHz
+static int32_t refresh_rate(struct json_object *obj) {
+	return mode_refresh_rate(obj) * 1000 + 0.5;
+}
+
 static void print_mode(struct json_object *obj)
 {
 	int hdisplay = get_object_object_uint64(obj, "hdisplay");
@@ -456,12 +435,19 @@ static void print_fb(struct json_object *obj, const char *prefix)
 	struct json_object *format_obj = json_object_object_get(obj, "format");
 	struct json_object *modifier_obj = json_object_object_get(obj, "modifier");
 	struct json_object *planes_arr = json_object_object_get(obj, "planes");
+	struct json_object *memory_obj = json_object_object_get(obj, "memory");
 	bool has_legacy = pitch_obj && bpp_obj && depth_obj;
 
 	printf("%s" L_VAL "Object ID: %"PRIu32"\n", prefix, id);
 	printf("%s%sSize: %"PRIu32"x%"PRIu32"\n", prefix,
-		(has_legacy || format_obj) ? L_VAL : L_LAST,
+		(memory_obj || has_legacy || format_obj) ? L_VAL : L_LAST,
 		width, height);
+	if (memory_obj) {
+		printf("%s%sMemory: ", prefix,
+			(has_legacy || format_obj) ? L_VAL : L_LAST);
+		print_size(json_object_get_uint64(memory_obj));
+		printf("\n");
+	}
 
 	if (has_legacy) {
 		printf("%s" L_VAL "Pitch: %"PRIu32" bytes\n", prefix,
@@ -498,6 +484,20 @@ static void print_fb(struct json_object *obj, const char *prefix)
 	}
 }
 
+/* Printers for the data decoded by json.c */
+static void (*const prop_printers[PROP_DECODER_COUNT])(struct json_object *obj,
+		const char *prefix) = {
+	[PROP_DECODER_IN_FORMATS] = print_in_formats,
+	[PROP_DECODER_MODE_ID] = print_mode_id,
+	[PROP_DECODER_WRITEBACK_PIXEL_FORMATS] = print_writeback_pixel_formats,
+	[PROP_DECODER_PATH] = print_path,
+	[PROP_DECODER_HDR_OUTPUT_METADATA] = print_hdr_output_metadata,
+	[PROP_DECODER_EDID] = print_edid,
+	[PROP_DECODER_LUT] = print_lut,
+	[PROP_DECODER_CTM] = print_ctm,
+	[PROP_DECODER_FB] = print_fb,
+};
+
 static void print_properties(struct json_object *obj, const char *prefix)
 {
 	printf("%s" L_LAST "Properties\n", prefix);
@@ -532,6 +532,8 @@ static void print_properties(struct json_object *obj, const char *prefix)
 		struct json_object *spec_obj = json_object_object_get(prop_obj, "spec");
 		struct json_object *val_obj = json_object_object_get(prop_obj, "value");
 		struct json_object *data_obj = json_object_object_get(prop_obj, "data");
+		void (*printer)(struct json_object *obj, const char *prefix) =
+			prop_printers[prop_decoder_lookup(prop_name)];
 		bool first;
 		switch (type) {
 		case DRM_MODE_PROP_RANGE:;
@@ -584,18 +586,8 @@ static void print_properties(struct json_object *obj, const char *prefix)
 			break;
 		case DRM_MODE_PROP_BLOB:;
 			printf("blob = %" PRIu64 "\n", raw_val);
-			if (!data_obj)
-				break;
-			if (strcmp(prop_name, "IN_FORMATS") == 0)
-				print_in_formats(data_obj, sub_prefix);
-			else if (strcmp(prop_name, "MODE_ID") == 0)
-				print_mode_id(data_obj, sub_prefix);
-			else if (strcmp(prop_name, "WRITEBACK_PIXEL_FORMATS") == 0)
-				print_writeback_pixel_formats(data_obj, sub_prefix);
-			else if (strcmp(prop_name, "PATH") == 0)
-				print_path(data_obj, sub_prefix);
-			else if (strcmp(prop_name, "HDR_OUTPUT_METADATA") == 0)
-				print_hdr_output_metadata(data_obj, sub_prefix);
+			if (data_obj && printer)
+				printer(data_obj, sub_prefix);
 			break;
 		case DRM_MODE_PROP_BITMASK:
 			printf("bitmask {");
@@ -633,10 +625,8 @@ static void print_properties(struct json_object *obj, const char *prefix)
 		case DRM_MODE_PROP_OBJECT:;
 			uint32_t obj_type = json_object_get_uint64(spec_obj);
 			printf("object %s = %"PRIu64"\n", obj_str(obj_type), raw_val);
-			if (!data_obj)
-				break;
-			if (strcmp(prop_name, "FB_ID") == 0)
-				print_fb(data_obj, sub_prefix);
+			if (data_obj && printer)
+				printer(data_obj, sub_prefix);
 			break;
 		case DRM_MODE_PROP_SIGNED_RANGE:;
 			int64_t smin =
@@ -881,6 +871,13 @@ static void print_crtcs(struct json_object *arr)
 		printf("%s" L_LINE L_LAST "Gamma size: %d\n", prefix,
 			json_object_get_int(gamma_size_obj));
 
+		struct json_object *gamma_obj = json_object_object_get(obj, "gamma");
+		if (gamma_obj) {
+			char sub_prefix[strlen(prefix) + strlen(L_LINE) + strlen(L_GAP) + 1];
+			snprintf(sub_prefix, sizeof(sub_prefix), "%s" L_LINE L_GAP, prefix);
+			print_lut(gamma_obj, sub_prefix);
+		}
+
 		print_properties(props_obj, prefix);
 	}
 }
@@ -947,6 +944,14 @@ static void print_node(const char *path, struct json_object *obj)
 		get_object_object_uint64(fb_size_obj, "min_height"),
 		get_object_object_uint64(fb_size_obj, "max_height"));
 
+	struct json_object *scanout_obj = json_object_object_get(obj, "scanout_memory");
+	if (scanout_obj) {
+		printf(L_VAL "Scanout memory: ");
+		print_size(get_object_object_uint64(scanout_obj, "bytes"));
+		printf(" in %"PRIu64" framebuffers\n",
+			get_object_object_uint64(scanout_obj, "framebuffers"));
+	}
+
 	struct json_object *encs_arr = json_object_object_get(obj, "encoders");
 	print_connectors(json_object_object_get(obj, "connectors"), encs_arr);
 	print_encoders(encs_arr);
@@ -0,0 +1,305 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <drm_fourcc.h>
+#include <json_object.h>
+
+#include "drm_info.h"
+#include "modifiers.h"
+#include "scanout.h"
+#include "tables.h"
+
+/* Devices are compared through bitsets over the sorted list of every
+ * format/modifier pair seen on any device, so that each entry of the matrix
+ * boils down to a word-wise AND. */
+
+struct pair {
+	uint32_t format;
+	uint64_t modifier;
+};
+
+struct pair_list {
+	struct pair *data;
+	size_t len, cap;
+};
+
+struct prime_device {
+	const char *path;
+	struct pair_list scanout, render;
+	bool has_egl;
+	uint64_t *scanout_set, *render_set;
+};
+
+static bool pair_list_add(struct pair_list *list, uint32_t format,
+		uint64_t modifier)
+{
+	if (list->len == list->cap) {
+		size_t cap = list->cap ? 2 * list->cap : 64;
+		struct pair *data = realloc(list->data, cap * sizeof(*data));
+		if (!data) {
+			perror("realloc");
+			return false;
+		}
+		list->data = data;
+		list->cap = cap;
+	}
+	list->data[list->len++] = (struct pair){ format, modifier };
+	return true;
+}
+
+static int pair_cmp(const void *a_ptr, const void *b_ptr)
+{
+	const struct pair *a = a_ptr, *b = b_ptr;
+	if (a->format != b->format) {
+		return a->format < b->format ? -1 : 1;
+	}
+	if (a->modifier != b->modifier) {
+		return a->modifier < b->modifier ? -1 : 1;
+	}
+	return 0;
+}
+
+static void collect_scanout(struct prime_device *dev,
+		struct json_object *node_obj)
+{
+	struct scanout_index *index = scanout_index_create(node_obj);
+	if (!index) {
+		return;
+	}
+	for (size_t i = 0; i < index->entries_cap; i++) {
+		const struct scanout_entry *entry = &index->entries[i];
+		if (!entry->used) {
+			continue;
+		}
+		/* Drivers without modifier support scan out LINEAR, as in
+		 * scanout_index_lookup() */
+		uint64_t mod = entry->modifier;
+		if (mod == DRM_FORMAT_MOD_INVALID) {
+			mod = DRM_FORMAT_MOD_LINEAR;
+		}
+		pair_list_add(&dev->scanout, entry->format, mod);
+	}
+	scanout_index_destroy(index);
+}
+
+static void collect_render(struct prime_device *dev,
+		struct json_object *egl_dev_obj)
+{
+	struct json_object *formats_arr =
+		json_object_object_get(egl_dev_obj, "formats");
+	for (size_t i = 0; i < json_object_array_length(formats_arr); i++) {
+		struct json_object *format_obj =
+			json_object_array_get_idx(formats_arr, i);
+		uint32_t fmt = get_object_object_uint64(format_obj, "format");
+		struct json_object *modifiers_arr =
+			json_object_object_get(format_obj, "modifiers");
+		for (size_t j = 0; j < json_object_array_length(modifiers_arr); j++) {
+			uint64_t mod = json_object_get_uint64(
+				json_object_array_get_idx(modifiers_arr, j));
+			pair_list_add(&dev->render, fmt, mod);
+		}
+	}
+}
+
+static uint64_t *make_set(const struct pair_list *list,
+		const struct pair_list *universe, size_t words)
+{
+	uint64_t *set = calloc(words ? words : 1, sizeof(*set));
+	if (!set) {
+		perror("calloc");
+		return NULL;
+	}
+	for (size_t i = 0; i < list->len; i++) {
+		const struct pair *p = bsearch(&list->data[i], universe->data,
+			universe->len, sizeof(*universe->data), pair_cmp);
+		if (!p) {
+			continue;
+		}
+		size_t bit = p - universe->data;
+		set[bit / 64] |= 1ULL << (bit % 64);
+	}
+	return set;
+}
+
+static struct json_object *shared_pairs(const uint64_t *a, const uint64_t *b,
+		const struct pair_list *universe, size_t words)
+{
+	struct json_object *arr = json_object_new_array();
+	for (size_t i = 0; i < words; i++) {
+		uint64_t word = a[i] & b[i];
+		while (word) {
+			size_t bit = i * 64 + __builtin_ctzll(word);
+			word &= word - 1;
+
+			const struct pair *p = &universe->data[bit];
+			struct json_object *pair_obj = json_object_new_object();
+			json_object_object_add(pair_obj, "format",
+				json_object_new_uint64(p->format));
+			json_object_object_add(pair_obj, "modifier",
+				json_object_new_uint64(p->modifier));
+			json_object_array_add(arr, pair_obj);
+		}
+	}
+	return arr;
+}
+
+struct json_object *prime_info(struct json_object *drm_obj,
+		struct json_object *egl_obj)
+{
+	size_t devs_len = 0;
+	json_object_object_foreach(drm_obj, path_count, node_count) {
+		(void)path_count;
+		(void)node_count;
+		devs_len++;
+	}
+
+	struct prime_device *devs = calloc(devs_len ? devs_len : 1, sizeof(*devs));
+	if (!devs) {
+		perror("calloc");
+		return NULL;
+	}
+
+	size_t i = 0;
+	json_object_object_foreach(drm_obj, path, node_obj) {
+		struct prime_device *dev = &devs[i++];
+		dev->path = path;
+		collect_scanout(dev, node_obj);
+
+		struct json_object *egl_dev_obj = json_object_object_get(egl_obj, path);
+		if (egl_dev_obj) {
+			dev->has_egl = true;
+			collect_render(dev, egl_dev_obj);
+		}
+	}
+
+	struct pair_list universe = {0};
+	for (i = 0; i < devs_len; i++) {
+		for (size_t j = 0; j < devs[i].scanout.len; j++) {
+			pair_list_add(&universe, devs[i].scanout.data[j].format,
+				devs[i].scanout.data[j].modifier);
+		}
+	}
+	if (universe.len > 0) {
+		qsort(universe.data, universe.len, sizeof(*universe.data), pair_cmp);
+	}
+	size_t unique_len = 0;
+	for (i = 0; i < universe.len; i++) {
+		if (unique_len == 0 ||
+				pair_cmp(&universe.data[unique_len - 1], &universe.data[i]) != 0) {
+			universe.data[unique_len++] = universe.data[i];
+		}
+	}
+	universe.len = unique_len;
+
+	/* Pairs EGL can render but no device can scan out don't matter here */
+	for (i = 0; i < devs_len; i++) {
+		struct pair_list *render = &devs[i].render;
+		size_t len = 0;
+		for (size_t j = 0; j < render->len; j++) {
+			if (bsearch(&render->data[j], universe.data, universe.len,
+					sizeof(*universe.data), pair_cmp)) {
+				render->data[len++] = render->data[j];
+			}
+		}
+		render->len = len;
+	}
+
+	size_t words = (universe.len + 63) / 64;
+	for (i = 0; i < devs_len; i++) {
+		devs[i].scanout_set = make_set(&devs[i].scanout, &universe, words);
+		devs[i].render_set = devs[i].has_egl ?
+			make_set(&devs[i].render, &universe, words) : NULL;
+	}
+
+	struct json_object *obj = json_object_new_object();
+	struct json_object *devices_arr = json_object_new_array();
+	for (i = 0; i < devs_len; i++) {
+		json_object_array_add(devices_arr, json_object_new_string(devs[i].path));
+	}
+	json_object_object_add(obj, "devices", devices_arr);
+
+	struct json_object *matrix_arr = json_object_new_array();
+	for (i = 0; i < devs_len; i++) {
+		struct prime_device *src = &devs[i];
+		/* Without EGL, only list what both devices can scan out: whether
+		 * the source can render it is unknown */
+		const uint64_t *src_set = src->render_set ?
+			src->render_set : src->scanout_set;
+		for (size_t j = 0; j < devs_len; j++) {
+			struct prime_device *dst = &devs[j];
+			if (i == j || !src_set || !dst->scanout_set) {
+				continue;
+			}
+
+			struct json_object *entry_obj = json_object_new_object();
+			json_object_object_add(entry_obj, "render",
+				json_object_new_string(src->path));
+			json_object_object_add(entry_obj, "render_source",
+				json_object_new_string(src->render_set ? "egl" : "unknown"));
+			json_object_object_add(entry_obj, "scanout",
+				json_object_new_string(dst->path));
+			json_object_object_add(entry_obj, "formats",
+				shared_pairs(src_set, dst->scanout_set, &universe, words));
+			json_object_array_add(matrix_arr, entry_obj);
+		}
+	}
+	json_object_object_add(obj, "matrix", matrix_arr);
+
+	for (i = 0; i < devs_len; i++) {
+		free(devs[i].scanout.data);
+		free(devs[i].render.data);
+		free(devs[i].scanout_set);
+		free(devs[i].render_set);
+	}
+	free(devs);
+	free(universe.data);
+
+	return obj;
+}
+
+void print_prime(struct json_object *obj)
+{
+	struct json_object *matrix_arr = json_object_object_get(obj, "matrix");
+	size_t matrix_len = json_object_array_length(matrix_arr);
+	if (matrix_len == 0) {
+		printf("Need at least two devices to share buffers\n");
+		return;
+	}
+
+	for (size_t i = 0; i < matrix_len; i++) {
+		struct json_object *entry_obj = json_object_array_get_idx(matrix_arr, i);
+		struct json_object *formats_arr =
+			json_object_object_get(entry_obj, "formats");
+		size_t formats_len = json_object_array_length(formats_arr);
+
+		const char *render_source =
+			get_object_object_string(entry_obj, "render_source");
+		bool egl = render_source && strcmp(render_source, "egl") == 0;
+		printf("%s on %s → scan out on %s: ", egl ? "Render" : "From",
+			get_object_object_string(entry_obj, "render"),
+			get_object_object_string(entry_obj, "scanout"));
+		if (formats_len == 0) {
+			printf("copy required\n");
+			continue;
+		}
+		if (egl) {
+			printf("%zu pairs\n", formats_len);
+		} else {
+			printf("%zu pairs both can scan out, rendering unknown (no EGL)\n",
+				formats_len);
+		}
+
+		for (size_t j = 0; j < formats_len; j++) {
+			struct json_object *pair_obj =
+				json_object_array_get_idx(formats_arr, j);
+			uint32_t fmt = get_object_object_uint64(pair_obj, "format");
+			printf("%s%s (0x%08"PRIx32"): ",
+				j == formats_len - 1 ? L_LAST : L_VAL, format_str(fmt), fmt);
+			print_modifier(get_object_object_uint64(pair_obj, "modifier"));
+			printf("\n");
+		}
+	}
+}
@@ -0,0 +1,1122 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <drm_fourcc.h>
+#include <json_object.h>
+#include <json_util.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+#include "tables.h"
+
+/* IN_FORMATS only says what a plane accepts on its own. The prober asks the
+ * driver about whole configurations with TEST_ONLY atomic commits: which
+ * format and scaling each plane accepts next to the primary plane, which
+ * sets of planes can be enabled together, and how many of them can be
+ * scaled at once.
+ *
+ * The search assumes failures are monotonic: a set of planes containing
+ * one that failed fails too, and a format rejected unscaled is rejected
+ * scaled. Planes with the same type, formats and possible CRTCs are
+ * assumed to be interchangeable, so only the first one of each class is
+ * probed on its own and combinations only pick how many planes of each
+ * class are enabled.
+ *
+ * Live results are cached per driver and kernel version, and CRTCs are
+ * probed concurrently. With -i, commits are checked by a stand-in that
+ * models the driver from the dump. */
+
+#define PROBE_PLANES_MAX 32
+/* Bounds the number of commits tested per CRTC */
+#define PROBE_TESTS_MAX 1024
+/* Most display engines have a couple of scalers per pipe */
+#define PROBE_MODEL_SCALERS 2
+
+/* Formats a dumb buffer can back */
+static const uint32_t probe_formats[] = {
+	DRM_FORMAT_XRGB8888,
+	DRM_FORMAT_ARGB8888,
+	DRM_FORMAT_XRGB2101010,
+	DRM_FORMAT_RGB565,
+	DRM_FORMAT_NV12,
+};
+
+#define PROBE_FORMATS (sizeof(probe_formats) / sizeof(probe_formats[0]))
+
+enum probe_scale {
+	PROBE_SCALE_NONE,
+	PROBE_SCALE_UP,
+	PROBE_SCALE_DOWN,
+};
+
+#define PROBE_SCALES 3
+
+static const char *const probe_scale_names[PROBE_SCALES] = {
+	[PROBE_SCALE_NONE] = "none",
+	[PROBE_SCALE_UP] = "up",
+	[PROBE_SCALE_DOWN] = "down",
+};
+
+enum probe_prop {
+	PROP_FB_ID,
+	PROP_CRTC_ID,
+	PROP_SRC_X,
+	PROP_SRC_Y,
+	PROP_SRC_W,
+	PROP_SRC_H,
+	PROP_CRTC_X,
+	PROP_CRTC_Y,
+	PROP_CRTC_W,
+	PROP_CRTC_H,
+	PROBE_PROPS,
+};
+
+static const char *const probe_prop_names[PROBE_PROPS] = {
+	[PROP_FB_ID] = "FB_ID",
+	[PROP_CRTC_ID] = "CRTC_ID",
+	[PROP_SRC_X] = "SRC_X",
+	[PROP_SRC_Y] = "SRC_Y",
+	[PROP_SRC_W] = "SRC_W",
+	[PROP_SRC_H] = "SRC_H",
+	[PROP_CRTC_X] = "CRTC_X",
+	[PROP_CRTC_Y] = "CRTC_Y",
+	[PROP_CRTC_W] = "CRTC_W",
+	[PROP_CRTC_H] = "CRTC_H",
+};
+
+struct probe_plane {
+	uint32_t id;
+	uint64_t type;
+	uint32_t possible_crtcs;
+	uint32_t crtc_id;
+	/* Index of the first plane identical to this one */
+	size_t class;
+	bool formats[PROBE_FORMATS];
+	uint32_t props[PROBE_PROPS];
+};
+
+struct probe_device {
+	struct probe_plane planes[PROBE_PLANES_MAX];
+	size_t planes_len;
+	uint32_t cursor_width, cursor_height;
+
+	/* Live devices only */
+	int fd;
+	uint32_t fbs[PROBE_FORMATS];
+	uint32_t handles[PROBE_FORMATS];
+	uint32_t fb_width, fb_height;
+	/* Read-only while probing */
+	struct json_object *cache_obj;
+};
+
+struct probe_crtc {
+	uint32_t id;
+	size_t index;
+	uint32_t width, height, vrefresh;
+};
+
+struct probe_layer {
+	size_t plane;
+	size_t format;
+	enum probe_scale scale;
+};
+
+struct probe_config {
+	struct probe_layer layers[PROBE_PLANES_MAX];
+	size_t len;
+};
+
+/* Returns 0 if the configuration is accepted and a negative errno value
+ * otherwise. Called concurrently for different CRTCs. */
+typedef int (*probe_test_func)(struct probe_device *dev,
+	const struct probe_crtc *crtc, const struct probe_config *cfg);
+
+/* Results: -1 untested, 0 rejected, 1 accepted */
+typedef int8_t probe_result;
+
+struct probe_class {
+	size_t plane;
+	size_t count;
+	size_t format;
+	size_t members[PROBE_PLANES_MAX];
+};
+
+struct probe_job {
+	struct probe_device *dev;
+	probe_test_func test;
+	struct probe_crtc crtc;
+
+	size_t candidates[PROBE_PLANES_MAX];
+	size_t candidates_len;
+	size_t primary;
+	struct probe_layer base;
+
+	probe_result single[PROBE_PLANES_MAX][PROBE_FORMATS][PROBE_SCALES];
+	struct probe_class classes[PROBE_PLANES_MAX];
+	size_t classes_len;
+	/* Maximal accepted combinations, as a count per class */
+	size_t *combos;
+	size_t combos_len;
+	size_t max_scaled;
+
+	/* Newly tested configurations, merged into the cache afterwards */
+	struct json_object *results_obj;
+	size_t tests, cached, pruned;
+	/* Some configurations were not tested because of PROBE_TESTS_MAX */
+	bool truncated;
+	/* Why the CRTC wasn't probed, if it wasn't */
+	const char *skipped;
+	int base_error;
+};
+
+static void layer_geometry(const struct probe_device *dev,
+		const struct probe_crtc *crtc, const struct probe_plane *plane,
+		size_t pos, enum probe_scale scale, uint32_t src[static 2],
+		uint32_t dst[static 4])
+{
+	uint32_t w, h;
+	if (plane->type == DRM_PLANE_TYPE_PRIMARY) {
+		w = crtc->width;
+		h = crtc->height;
+		dst[0] = dst[1] = 0;
+	} else if (plane->type == DRM_PLANE_TYPE_CURSOR) {
+		w = dev->cursor_width;
+		h = dev->cursor_height;
+		dst[0] = dst[1] = 0;
+	} else {
+		/* Overlays are staggered so that none is fully occluded */
+		w = crtc->width / 4;
+		h = crtc->height / 4;
+		dst[0] = (pos * 32) % (crtc->width - w);
+		dst[1] = (pos * 32) % (crtc->height - h);
+	}
+
+	src[0] = w;
+	src[1] = h;
+	switch (scale) {
+	case PROBE_SCALE_NONE:
+		break;
+	case PROBE_SCALE_UP:
+		src[0] = w / 2;
+		src[1] = h / 2;
+		break;
+	case PROBE_SCALE_DOWN:
+		/* The framebuffer is as large as the largest CRTC, a downscaled
+		 * primary plane covers part of the CRTC instead */
+		if (plane->type == DRM_PLANE_TYPE_PRIMARY) {
+			w /= 2;
+			h /= 2;
+		} else {
+			src[0] = w * 2;
+			src[1] = h * 2;
+		}
+		break;
+	}
+	dst[2] = w;
+	dst[3] = h;
+}
+
+static int live_test(struct probe_device *dev, const struct probe_crtc *crtc,
+		const struct probe_config *cfg)
+{
+	drmModeAtomicReq *req = drmModeAtomicAlloc();
+	if (!req) {
+		return -ENOMEM;
+	}
+
+	/* Planes already on the CRTC would count against the configuration */
+	for (size_t i = 0; i < dev->planes_len; i++) {
+		const struct probe_plane *plane = &dev->planes[i];
+		bool used = false;
+		for (size_t j = 0; j < cfg->len; j++) {
+			used |= cfg->layers[j].plane == i;
+		}
+		if (!used && plane->crtc_id == crtc->id) {
+			drmModeAtomicAddProperty(req, plane->id, plane->props[PROP_FB_ID], 0);
+			drmModeAtomicAddProperty(req, plane->id, plane->props[PROP_CRTC_ID], 0);
+		}
+	}
+
+	for (size_t i = 0; i < cfg->len; i++) {
+		const struct probe_layer *layer = &cfg->layers[i];
+		const struct probe_plane *plane = &dev->planes[layer->plane];
+		uint32_t src[2], dst[4];
+		layer_geometry(dev, crtc, plane, i, layer->scale, src, dst);
+
+		uint64_t values[PROBE_PROPS] = {
+			[PROP_FB_ID] = dev->fbs[layer->format],
+			[PROP_CRTC_ID] = crtc->id,
+			[PROP_SRC_W] = (uint64_t)src[0] << 16,
+			[PROP_SRC_H] = (uint64_t)src[1] << 16,
+			[PROP_CRTC_X] = dst[0],
+			[PROP_CRTC_Y] = dst[1],
+			[PROP_CRTC_W] = dst[2],
+			[PROP_CRTC_H] = dst[3],
+		};
+		for (size_t j = 0; j < PROBE_PROPS; j++) {
+			drmModeAtomicAddProperty(req, plane->id, plane->props[j], values[j]);
+		}
+	}
+
+	/* Returns -errno on failure */
+	int ret = drmModeAtomicCommit(dev->fd, req, DRM_MODE_ATOMIC_TEST_ONLY, NULL);
+	drmModeAtomicFree(req);
+	return ret;
+}
+
+/* Stand-in for the atomic ioctl, which only knows what the dump records */
+static int model_test(struct probe_device *dev, const struct probe_crtc *crtc,
+		const struct probe_config *cfg)
+{
+	size_t scaled = 0;
+	for (size_t i = 0; i < cfg->len; i++) {
+		const struct probe_layer *layer = &cfg->layers[i];
+		const struct probe_plane *plane = &dev->planes[layer->plane];
+		if (!(plane->possible_crtcs & (1u << crtc->index)) ||
+				!plane->formats[layer->format]) {
+			return -EINVAL;
+		}
+		if (layer->scale != PROBE_SCALE_NONE) {
+			if (plane->type == DRM_PLANE_TYPE_CURSOR) {
+				return -EINVAL;
+			}
+			scaled++;
+		}
+	}
+	return scaled <= PROBE_MODEL_SCALERS ? 0 : -ERANGE;
+}
+
+static void config_key(const struct probe_job *job,
+		const struct probe_config *cfg, char *key, size_t size)
+{
+	const struct probe_crtc *crtc = &job->crtc;
+	int n = snprintf(key, size, "%zu:%"PRIu32"x%"PRIu32"@%"PRIu32,
+		crtc->index, crtc->width, crtc->height, crtc->vrefresh);
+	for (size_t i = 0; i < cfg->len && n > 0 && (size_t)n < size; i++) {
+		const struct probe_layer *layer = &cfg->layers[i];
+		n += snprintf(key + n, size - n, ",%"PRIu32":%08"PRIx32":%s",
+			job->dev->planes[layer->plane].id,
+			probe_formats[layer->format], probe_scale_names[layer->scale]);
+	}
+}
+
+/* Configurations past PROBE_TESTS_MAX are left untested */
+static probe_result run_test(struct probe_job *job,
+		const struct probe_config *cfg)
+{
+	char key[1024];
+	config_key(job, cfg, key, sizeof(key));
+
+	struct json_object *result_obj;
+	if (json_object_object_get_ex(job->dev->cache_obj, key, &result_obj) ||
+			json_object_object_get_ex(job->results_obj, key, &result_obj)) {
+		job->cached++;
+		return json_object_get_boolean(result_obj);
+	}
+	if (job->tests >= PROBE_TESTS_MAX) {
+		job->pruned++;
+		job->truncated = true;
+		return -1;
+	}
+
+	job->tests++;
+	bool ok = job->test(job->dev, &job->crtc, cfg) == 0;
+	json_object_object_add(job->results_obj, key,
+		json_object_new_boolean(ok));
+	return ok;
+}
+
+static void probe_singles(struct probe_job *job)
+{
+	struct probe_device *dev = job->dev;
+	for (size_t i = 0; i < job->candidates_len; i++) {
+		size_t p = job->candidates[i];
+		const struct probe_plane *plane = &dev->planes[p];
+
+		/* The class representative has the same possible CRTCs, so it
+		 * has been probed on this CRTC already */
+		if (plane->class != p) {
+			memcpy(job->single[p], job->single[plane->class],
+				sizeof(job->single[p]));
+			job->pruned += PROBE_FORMATS * PROBE_SCALES;
+			continue;
+		}
+
+		for (size_t f = 0; f < PROBE_FORMATS; f++) {
+			if (!plane->formats[f] || (dev->fd >= 0 && dev->fbs[f] == 0)) {
+				continue;
+			}
+			for (size_t s = 0; s < PROBE_SCALES; s++) {
+				if (s != PROBE_SCALE_NONE &&
+						job->single[p][f][PROBE_SCALE_NONE] == 0) {
+					job->single[p][f][s] = 0;
+					job->pruned++;
+					continue;
+				}
+				struct probe_config cfg = { .len = 0 };
+				if (p != job->primary) {
+					cfg.layers[cfg.len++] = job->base;
+				}
+				cfg.layers[cfg.len++] = (struct probe_layer){
+					.plane = p, .format = f, .scale = s,
+				};
+				job->single[p][f][s] = run_test(job, &cfg);
+			}
+		}
+	}
+}
+
+static size_t combo_sum(const size_t *combo, size_t len)
+{
+	size_t sum = 0;
+	for (size_t i = 0; i < len; i++) {
+		sum += combo[i];
+	}
+	return sum;
+}
+
+/* Whether a has at most as many planes of each class as b */
+static bool combo_le(const size_t *a, const size_t *b, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (a[i] > b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void combo_config(const struct probe_job *job, const size_t *combo,
+		struct probe_config *cfg)
+{
+	cfg->len = 0;
+	cfg->layers[cfg->len++] = job->base;
+	for (size_t k = 0; k < job->classes_len; k++) {
+		const struct probe_class *class = &job->classes[k];
+		for (size_t m = 0; m < combo[k]; m++) {
+			cfg->layers[cfg->len++] = (struct probe_layer){
+				.plane = class->members[m],
+				.format = class->format,
+				.scale = PROBE_SCALE_NONE,
+			};
+		}
+	}
+}
+
+/* Walks combinations by increasing number of planes, skipping supersets of
+ * rejected ones, and keeps the accepted ones no other accepted one
+ * contains */
+static void probe_combos(struct probe_job *job)
+{
+	struct probe_device *dev = job->dev;
+	for (size_t i = 0; i < job->candidates_len; i++) {
+		size_t p = job->candidates[i];
+		if (p == job->primary) {
+			continue;
+		}
+		size_t format = PROBE_FORMATS;
+		for (size_t f = 0; f < PROBE_FORMATS && format == PROBE_FORMATS; f++) {
+			if (job->single[p][f][PROBE_SCALE_NONE] == 1) {
+				format = f;
+			}
+		}
+		if (format == PROBE_FORMATS) {
+			continue;
+		}
+
+		size_t k = 0;
+		while (k < job->classes_len && job->classes[k].plane !=
+				dev->planes[p].class) {
+			k++;
+		}
+		if (k == job->classes_len) {
+			job->classes[job->classes_len++] = (struct probe_class){
+				.plane = dev->planes[p].class,
+				.format = format,
+			};
+		}
+		struct probe_class *class = &job->classes[k];
+		class->members[class->count++] = p;
+	}
+
+	size_t width = job->classes_len;
+	size_t combos_len = 1;
+	for (size_t k = 0; k < width; k++) {
+		combos_len *= job->classes[k].count + 1;
+		if (combos_len > PROBE_TESTS_MAX) {
+			combos_len = PROBE_TESTS_MAX;
+			job->truncated = true;
+			break;
+		}
+	}
+	if (width == 0) {
+		return;
+	}
+
+	/* Enumerate as mixed-radix numbers, then sort by plane count */
+	size_t *combos = calloc(combos_len * width, sizeof(*combos));
+	probe_result *results = calloc(combos_len, sizeof(*results));
+	if (!combos || !results) {
+		perror("calloc");
+		free(combos);
+		free(results);
+		return;
+	}
+	size_t *cur = calloc(width, sizeof(*cur));
+	for (size_t i = 0; cur && i < combos_len; i++) {
+		memcpy(&combos[i * width], cur, width * sizeof(*cur));
+		for (size_t k = 0; k < width; k++) {
+			if (++cur[k] <= job->classes[k].count) {
+				break;
+			}
+			cur[k] = 0;
+		}
+	}
+	free(cur);
+
+	for (size_t i = 1; i < combos_len; i++) {
+		size_t tmp[PROBE_PLANES_MAX];
+		memcpy(tmp, &combos[i * width], width * sizeof(*tmp));
+		size_t sum = combo_sum(tmp, width), j = i;
+		while (j > 0 && combo_sum(&combos[(j - 1) * width], width) > sum) {
+			memcpy(&combos[j * width], &combos[(j - 1) * width],
+				width * sizeof(*tmp));
+			j--;
+		}
+		memcpy(&combos[j * width], tmp, width * sizeof(*tmp));
+	}
+
+	for (size_t i = 0; i < combos_len; i++) {
+		const size_t *combo = &combos[i * width];
+		bool pruned = false;
+		for (size_t j = 0; j < i && !pruned; j++) {
+			pruned = results[j] == 0 && combo_le(&combos[j * width], combo, width);
+		}
+		if (pruned) {
+			results[i] = 0;
+			job->pruned++;
+			continue;
+		}
+		struct probe_config cfg;
+		combo_config(job, combo, &cfg);
+		results[i] = run_test(job, &cfg);
+	}
+
+	job->combos = calloc(combos_len * width, sizeof(*job->combos));
+	for (size_t i = 0; job->combos && i < combos_len; i++) {
+		const size_t *combo = &combos[i * width];
+		bool maximal = results[i] == 1 && combo_sum(combo, width) > 0;
+		for (size_t j = i + 1; j < combos_len && maximal; j++) {
+			maximal = !(results[j] == 1 &&
+				combo_le(combo, &combos[j * width], width));
+		}
+		if (maximal) {
+			memcpy(&job->combos[job->combos_len++ * width], combo,
+				width * sizeof(*combo));
+		}
+	}
+
+	free(results);
+	free(combos);
+}
+
+/* Scales the planes of the largest combination one more at a time */
+static void probe_scaling(struct probe_job *job)
+{
+	size_t width = job->classes_len;
+	const size_t *largest = NULL;
+	for (size_t i = 0; i < job->combos_len; i++) {
+		const size_t *combo = &job->combos[i * width];
+		if (!largest || combo_sum(combo, width) > combo_sum(largest, width)) {
+			largest = combo;
+		}
+	}
+
+	struct probe_config cfg;
+	if (largest) {
+		combo_config(job, largest, &cfg);
+	} else {
+		cfg.len = 1;
+		cfg.layers[0] = job->base;
+	}
+
+	for (size_t i = 0; i < cfg.len; i++) {
+		struct probe_layer *layer = &cfg.layers[i];
+		if (job->single[layer->plane][layer->format][PROBE_SCALE_UP] != 1) {
+			continue;
+		}
+		layer->scale = PROBE_SCALE_UP;
+		if (run_test(job, &cfg) != 1) {
+			break;
+		}
+		job->max_scaled++;
+	}
+}
+
+static void *probe_crtc_thread(void *data)
+{
+	struct probe_job *job = data;
+	if (job->skipped) {
+		return NULL;
+	}
+	struct probe_config cfg = { .len = 1 };
+	cfg.layers[0] = job->base;
+	job->base_error = job->test(job->dev, &job->crtc, &cfg);
+	if (job->base_error != 0) {
+		return NULL;
+	}
+
+	probe_singles(job);
+	probe_combos(job);
+	probe_scaling(job);
+	return NULL;
+}
+
+static bool load_device(struct probe_device *dev, struct json_object *dev_obj)
+{
+	struct json_object *caps_obj = json_object_object_get(dev_obj, "caps");
+	dev->cursor_width = get_object_object_uint64(caps_obj, "CURSOR_WIDTH");
+	dev->cursor_height = get_object_object_uint64(caps_obj, "CURSOR_HEIGHT");
+	if (dev->cursor_width == 0 || dev->cursor_height == 0) {
+		dev->cursor_width = dev->cursor_height = 64;
+	}
+
+	struct json_object *planes_arr = json_object_object_get(dev_obj, "planes");
+	size_t planes_len = json_object_array_length(planes_arr);
+	if (planes_len > PROBE_PLANES_MAX) {
+		planes_len = PROBE_PLANES_MAX;
+	}
+	for (size_t i = 0; i < planes_len; i++) {
+		struct json_object *plane_obj = json_object_array_get_idx(planes_arr, i);
+		struct probe_plane *plane = &dev->planes[dev->planes_len++];
+		plane->id = get_object_object_uint64(plane_obj, "id");
+		plane->possible_crtcs =
+			get_object_object_uint64(plane_obj, "possible_crtcs");
+		plane->crtc_id = get_object_object_uint64(plane_obj, "crtc_id");
+
+		struct json_object *props_obj =
+			json_object_object_get(plane_obj, "properties");
+		plane->type = get_object_object_uint64(
+			json_object_object_get(props_obj, "type"), "value");
+		for (size_t j = 0; j < PROBE_PROPS; j++) {
+			plane->props[j] = get_object_object_uint64(
+				json_object_object_get(props_obj, probe_prop_names[j]), "id");
+		}
+
+		struct json_object *formats_arr =
+			json_object_object_get(plane_obj, "formats");
+		for (size_t j = 0; j < json_object_array_length(formats_arr); j++) {
+			uint32_t fmt = json_object_get_uint64(
+				json_object_array_get_idx(formats_arr, j));
+			for (size_t f = 0; f < PROBE_FORMATS; f++) {
+				plane->formats[f] |= probe_formats[f] == fmt;
+			}
+		}
+
+		plane->class = i;
+		for (size_t j = 0; j < i; j++) {
+			const struct probe_plane *other = &dev->planes[j];
+			if (other->class == j && other->type == plane->type &&
+					other->possible_crtcs == plane->possible_crtcs &&
+					memcmp(other->formats, plane->formats,
+						sizeof(plane->formats)) == 0) {
+				plane->class = j;
+				break;
+			}
+		}
+	}
+	return dev->planes_len > 0;
+}
+
+static uint32_t format_bpp(uint32_t format)
+{
+	switch (format) {
+	case DRM_FORMAT_RGB565:
+		return 16;
+	case DRM_FORMAT_NV12:
+		return 8;
+	default:
+		return 32;
+	}
+}
+
+/* One linear framebuffer per format, as large as the largest CRTC */
+static void create_fbs(struct probe_device *dev)
+{
+	for (size_t f = 0; f < PROBE_FORMATS; f++) {
+		bool used = false;
+		for (size_t i = 0; i < dev->planes_len; i++) {
+			used |= dev->planes[i].formats[f];
+		}
+		if (!used) {
+			continue;
+		}
+
+		uint32_t format = probe_formats[f];
+		bool nv12 = format == DRM_FORMAT_NV12;
+		struct drm_mode_create_dumb create = {
+			.width = dev->fb_width,
+			.height = nv12 ? dev->fb_height * 3 / 2 : dev->fb_height,
+			.bpp = format_bpp(format),
+		};
+		if (drmIoctl(dev->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create) != 0) {
+			perror("DRM_IOCTL_MODE_CREATE_DUMB");
+			continue;
+		}
+		dev->handles[f] = create.handle;
+
+		uint32_t handles[4] = { create.handle, nv12 ? create.handle : 0 };
+		uint32_t pitches[4] = { create.pitch, nv12 ? create.pitch : 0 };
+		uint32_t offsets[4] = { 0, nv12 ? create.pitch * dev->fb_height : 0 };
+		if (drmModeAddFB2(dev->fd, dev->fb_width, dev->fb_height, format,
+				handles, pitches, offsets, &dev->fbs[f], 0) != 0) {
+			fprintf(stderr, "drmModeAddFB2(%s): %s\n", format_str(format),
+				strerror(errno));
+			dev->fbs[f] = 0;
+		}
+	}
+}
+
+static void destroy_fbs(struct probe_device *dev)
+{
+	for (size_t f = 0; f < PROBE_FORMATS; f++) {
+		if (dev->fbs[f] != 0) {
+			drmModeRmFB(dev->fd, dev->fbs[f]);
+		}
+		if (dev->handles[f] != 0) {
+			struct drm_mode_destroy_dumb destroy = {
+				.handle = dev->handles[f],
+			};
+			drmIoctl(dev->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+		}
+	}
+}
+
+/* e.g. ~/.cache/drm_info/probe-i915-1.6.0-20201103-6.8.0-8086:9a49.json */
+static bool cache_path(struct json_object *dev_obj, char *path, size_t size)
+{
+	const char *base = getenv("XDG_CACHE_HOME");
+	char home_cache[PATH_MAX];
+	if (!base || base[0] == '\0') {
+		const char *home = getenv("HOME");
+		if (!home) {
+			return false;
+		}
+		snprintf(home_cache, sizeof(home_cache), "%s/.cache", home);
+		base = home_cache;
+	}
+
+	char dir[PATH_MAX];
+	if (snprintf(dir, sizeof(dir), "%s/drm_info", base) >= (int)sizeof(dir)) {
+		return false;
+	}
+	mkdir(base, 0755);
+	if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+		return false;
+	}
+
+	struct json_object *driver_obj = json_object_object_get(dev_obj, "driver");
+	struct json_object *version_obj =
+		json_object_object_get(driver_obj, "version");
+	struct json_object *kernel_obj = json_object_object_get(driver_obj, "kernel");
+	struct json_object *device_obj = json_object_object_get(dev_obj, "device");
+	struct json_object *data_obj =
+		json_object_object_get(device_obj, "device_data");
+	const char *name = get_object_object_string(driver_obj, "name");
+	const char *date = get_object_object_string(version_obj, "date");
+	const char *release = get_object_object_string(kernel_obj, "release");
+	int n = snprintf(path, size, "%s/probe-%s-%"PRIu64".%"PRIu64".%"PRIu64
+		"-%s-%s-%04"PRIx64":%04"PRIx64".json", dir, name ? name : "unknown",
+		get_object_object_uint64(version_obj, "major"),
+		get_object_object_uint64(version_obj, "minor"),
+		get_object_object_uint64(version_obj, "patch"),
+		date ? date : "0", release ? release : "unknown",
+		get_object_object_uint64(data_obj, "vendor"),
+		get_object_object_uint64(data_obj, "device"));
+	return n > 0 && (size_t)n < size;
+}
+
+static struct json_object *job_to_json(const struct probe_job *job)
+{
+	const struct probe_device *dev = job->dev;
+	const struct probe_crtc *crtc = &job->crtc;
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "id", json_object_new_uint64(crtc->id));
+	char mode[64];
+	snprintf(mode, sizeof(mode), "%"PRIu32"x%"PRIu32"@%"PRIu32,
+		crtc->width, crtc->height, crtc->vrefresh);
+	json_object_object_add(obj, "mode", json_object_new_string(mode));
+	if (job->skipped) {
+		json_object_object_add(obj, "skipped",
+			json_object_new_string(job->skipped));
+		return obj;
+	}
+	if (job->base_error != 0) {
+		json_object_object_add(obj, "error",
+			json_object_new_string(strerror(-job->base_error)));
+		return obj;
+	}
+
+	struct json_object *planes_arr = json_object_new_array();
+	for (size_t i = 0; i < job->candidates_len; i++) {
+		size_t p = job->candidates[i];
+		const struct probe_plane *plane = &dev->planes[p];
+		struct json_object *plane_obj = json_object_new_object();
+		json_object_object_add(plane_obj, "id", json_object_new_uint64(plane->id));
+		json_object_object_add(plane_obj, "type",
+			json_object_new_uint64(plane->type));
+		if (plane->class != p) {
+			json_object_object_add(plane_obj, "same_as",
+				json_object_new_uint64(dev->planes[plane->class].id));
+		}
+
+		struct json_object *formats_obj = json_object_new_object();
+		for (size_t f = 0; f < PROBE_FORMATS; f++) {
+			if (!plane->formats[f]) {
+				continue;
+			}
+			struct json_object *scales_obj = json_object_new_object();
+			for (size_t s = 0; s < PROBE_SCALES; s++) {
+				probe_result result = job->single[p][f][s];
+				json_object_object_add(scales_obj, probe_scale_names[s],
+					result < 0 ? NULL : json_object_new_boolean(result));
+			}
+			json_object_object_add(formats_obj,
+				format_str(probe_formats[f]), scales_obj);
+		}
+		json_object_object_add(plane_obj, "formats", formats_obj);
+		json_object_array_add(planes_arr, plane_obj);
+	}
+	json_object_object_add(obj, "planes", planes_arr);
+
+	struct json_object *combos_arr = json_object_new_array();
+	for (size_t i = 0; i < job->combos_len; i++) {
+		const size_t *combo = &job->combos[i * job->classes_len];
+		struct json_object *combo_arr = json_object_new_array();
+		json_object_array_add(combo_arr,
+			json_object_new_uint64(dev->planes[job->primary].id));
+		for (size_t k = 0; k < job->classes_len; k++) {
+			for (size_t m = 0; m < combo[k]; m++) {
+				json_object_array_add(combo_arr, json_object_new_uint64(
+					dev->planes[job->classes[k].members[m]].id));
+			}
+		}
+		json_object_array_add(combos_arr, combo_arr);
+	}
+	json_object_object_add(obj, "combinations", combos_arr);
+	json_object_object_add(obj, "max_scaled",
+		json_object_new_uint64(job->max_scaled));
+	json_object_object_add(obj, "truncated",
+		json_object_new_boolean(job->truncated));
+	return obj;
+}
+
+static struct json_object *probe_device(const char *path,
+		struct json_object *dev_obj, bool live)
+{
+	struct probe_device *dev = calloc(1, sizeof(*dev));
+	if (!dev) {
+		perror("calloc");
+		return NULL;
+	}
+	dev->fd = -1;
+	if (!load_device(dev, dev_obj)) {
+		free(dev);
+		return NULL;
+	}
+
+	struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+	size_t crtcs_len = json_object_array_length(crtcs_arr);
+	struct probe_job *jobs = calloc(crtcs_len, sizeof(*jobs));
+	size_t jobs_len = 0;
+	for (size_t i = 0; jobs && i < crtcs_len && i < 32; i++) {
+		struct json_object *crtc_obj = json_object_array_get_idx(crtcs_arr, i);
+		struct json_object *mode_obj = json_object_object_get(crtc_obj, "mode");
+		if (!mode_obj) {
+			continue;
+		}
+
+		struct probe_job *job = &jobs[jobs_len++];
+		job->dev = dev;
+		job->test = live ? live_test : model_test;
+		job->crtc = (struct probe_crtc){
+			.id = get_object_object_uint64(crtc_obj, "id"),
+			.index = i,
+			.width = get_object_object_uint64(mode_obj, "hdisplay"),
+			.height = get_object_object_uint64(mode_obj, "vdisplay"),
+			.vrefresh = get_object_object_uint64(mode_obj, "vrefresh"),
+		};
+		memset(job->single, -1, sizeof(job->single));
+		job->results_obj = json_object_new_object();
+
+		job->primary = SIZE_MAX;
+		for (size_t p = 0; p < dev->planes_len; p++) {
+			const struct probe_plane *plane = &dev->planes[p];
+			if (!(plane->possible_crtcs & (1u << i))) {
+				continue;
+			}
+			job->candidates[job->candidates_len++] = p;
+			/* Prefer the primary plane already driving the CRTC */
+			if (plane->type == DRM_PLANE_TYPE_PRIMARY &&
+					(job->primary == SIZE_MAX || plane->crtc_id == job->crtc.id)) {
+				job->primary = p;
+			}
+		}
+		if (job->crtc.width > dev->fb_width) {
+			dev->fb_width = job->crtc.width;
+		}
+		if (job->crtc.height > dev->fb_height) {
+			dev->fb_height = job->crtc.height;
+		}
+	}
+
+	char cache_file[PATH_MAX];
+	bool use_cache = false;
+	const char *error = NULL;
+	if (live && jobs_len > 0) {
+		dev->fd = open(path, O_RDWR | O_CLOEXEC);
+		if (dev->fd < 0) {
+			fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		} else if (drmSetClientCap(dev->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0 ||
+				drmSetClientCap(dev->fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0) {
+			fprintf(stderr, "%s: atomic modesetting is not supported\n", path);
+			close(dev->fd);
+			dev->fd = -1;
+		} else if (!drmIsMaster(dev->fd)) {
+			/* Every commit would fail with EACCES and read as rejected */
+			error = "not DRM master";
+			close(dev->fd);
+			dev->fd = -1;
+		}
+		if (dev->fd < 0 && !error) {
+			for (size_t i = 0; i < jobs_len; i++) {
+				json_object_put(jobs[i].results_obj);
+			}
+			free(jobs);
+			free(dev);
+			return NULL;
+		} else if (!error) {
+			create_fbs(dev);
+			use_cache = cache_path(dev_obj, cache_file, sizeof(cache_file));
+			if (use_cache && access(cache_file, F_OK) == 0) {
+				dev->cache_obj = json_object_from_file(cache_file);
+			}
+		}
+	}
+	if (error) {
+		jobs_len = 0;
+	}
+
+	/* Other planes are probed next to the primary plane using the first
+	 * format it accepts */
+	for (size_t i = 0; i < jobs_len; i++) {
+		struct probe_job *job = &jobs[i];
+		if (job->primary == SIZE_MAX) {
+			job->skipped = "no primary plane";
+			continue;
+		}
+		const struct probe_plane *primary = &dev->planes[job->primary];
+		size_t format = 0;
+		while (format < PROBE_FORMATS && (!primary->formats[format] ||
+				(dev->fd >= 0 && dev->fbs[format] == 0))) {
+			format++;
+		}
+		if (format == PROBE_FORMATS) {
+			job->skipped = "the primary plane accepts none of the probed formats";
+			continue;
+		}
+		job->base = (struct probe_layer){
+			.plane = job->primary,
+			.format = format,
+		};
+	}
+
+	/* TEST_ONLY commits on different CRTCs don't depend on each other */
+	pthread_t *threads = calloc(jobs_len, sizeof(*threads));
+	bool *started = calloc(jobs_len, sizeof(*started));
+	for (size_t i = 0; threads && started && i < jobs_len; i++) {
+		started[i] = pthread_create(&threads[i], NULL, probe_crtc_thread,
+			&jobs[i]) == 0;
+		if (!started[i]) {
+			probe_crtc_thread(&jobs[i]);
+		}
+	}
+	for (size_t i = 0; threads && started && i < jobs_len; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		}
+	}
+	free(started);
+	free(threads);
+
+	struct json_object *obj = json_object_new_object();
+	struct json_object *crtcs_out = json_object_new_array();
+	size_t tests = 0, cached = 0, pruned = 0;
+	for (size_t i = 0; i < jobs_len; i++) {
+		struct probe_job *job = &jobs[i];
+		tests += job->tests;
+		cached += job->cached;
+		pruned += job->pruned;
+		json_object_array_add(crtcs_out, job_to_json(job));
+
+		if (use_cache) {
+			if (!dev->cache_obj) {
+				dev->cache_obj = json_object_new_object();
+			}
+			json_object_object_foreach(job->results_obj, key, result_obj) {
+				json_object_object_add(dev->cache_obj, key,
+					json_object_get(result_obj));
+			}
+		}
+	}
+	if (error) {
+		json_object_object_add(obj, "error", json_object_new_string(error));
+	}
+	json_object_object_add(obj, "tests", json_object_new_uint64(tests));
+	json_object_object_add(obj, "cached", json_object_new_uint64(cached));
+	json_object_object_add(obj, "pruned", json_object_new_uint64(pruned));
+	json_object_object_add(obj, "crtcs", crtcs_out);
+
+	if (use_cache && dev->cache_obj &&
+			json_object_to_file(cache_file, dev->cache_obj) != 0) {
+		fprintf(stderr, "Failed to write %s\n", cache_file);
+	}
+
+	for (size_t i = 0; jobs && i < crtcs_len; i++) {
+		json_object_put(jobs[i].results_obj);
+		free(jobs[i].combos);
+	}
+	free(jobs);
+	json_object_put(dev->cache_obj);
+	if (dev->fd >= 0) {
+		destroy_fbs(dev);
+		close(dev->fd);
+	}
+	free(dev);
+	return obj;
+}
+
+/* drm_obj is as returned by drm_info(). Live devices are probed with
+ * TEST_ONLY commits, which needs DRM master; otherwise the stand-in is
+ * used. */
+struct json_object *probe_info(struct json_object *drm_obj, bool live)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		struct json_object *probe_obj = probe_device(path, dev_obj, live);
+		if (probe_obj) {
+			json_object_object_add(obj, path, probe_obj);
+		}
+	}
+	return obj;
+}
+
+static void print_plane_formats(struct json_object *formats_obj)
+{
+	bool first = true, untested = false;
+	json_object_object_foreach(formats_obj, name, scales_obj) {
+		struct json_object *none_obj, *up_obj, *down_obj;
+		json_object_object_get_ex(scales_obj, "none", &none_obj);
+		json_object_object_get_ex(scales_obj, "up", &up_obj);
+		json_object_object_get_ex(scales_obj, "down", &down_obj);
+		untested |= !none_obj;
+		if (!json_object_get_boolean(none_obj)) {
+			continue;
+		}
+		bool up = json_object_get_boolean(up_obj);
+		bool down = json_object_get_boolean(down_obj);
+		printf("%s%s%s", first ? "" : ", ", name,
+			up && down ? " (scaled)" : up ? " (upscaled)" :
+			down ? " (downscaled)" : "");
+		first = false;
+	}
+	if (first) {
+		printf(untested ? "not tested" : "no configuration accepted");
+	}
+	printf("\n");
+}
+
+static void print_probe_crtc(struct json_object *crtc_obj, const char *prefix)
+{
+	printf("CRTC %"PRIu64": %s\n", get_object_object_uint64(crtc_obj, "id"),
+		get_object_object_string(crtc_obj, "mode"));
+
+	const char *skipped = get_object_object_string(crtc_obj, "skipped");
+	if (skipped) {
+		printf("%s" L_LAST "Skipped: %s\n", prefix, skipped);
+		return;
+	}
+	const char *error = get_object_object_string(crtc_obj, "error");
+	if (error) {
+		printf("%s" L_LAST "Primary plane rejected: %s\n", prefix, error);
+		return;
+	}
+
+	struct json_object *planes_arr = json_object_object_get(crtc_obj, "planes");
+	for (size_t i = 0; i < json_object_array_length(planes_arr); i++) {
+		struct json_object *plane_obj = json_object_array_get_idx(planes_arr, i);
+		printf("%s" L_VAL "Plane %"PRIu64" (%s): ", prefix,
+			get_object_object_uint64(plane_obj, "id"),
+			plane_type_str(get_object_object_uint64(plane_obj, "type")));
+		print_plane_formats(json_object_object_get(plane_obj, "formats"));
+	}
+
+	struct json_object *combos_arr =
+		json_object_object_get(crtc_obj, "combinations");
+	size_t combos_len = json_object_array_length(combos_arr);
+	printf("%s" L_VAL "Combinations:", prefix);
+	for (size_t i = 0; i < combos_len; i++) {
+		struct json_object *combo_arr = json_object_array_get_idx(combos_arr, i);
+		printf("%s", i == 0 ? " " : ", ");
+		for (size_t j = 0; j < json_object_array_length(combo_arr); j++) {
+			printf("%s%"PRIu64, j == 0 ? "" : "+",
+				json_object_get_uint64(json_object_array_get_idx(combo_arr, j)));
+		}
+	}
+	printf("%s%s\n", combos_len == 0 ? " primary only" : "",
+		json_object_get_boolean(json_object_object_get(crtc_obj, "truncated")) ?
+		" (truncated)" : "");
+	printf("%s" L_LAST "Scaled planes at once: %"PRIu64"\n", prefix,
+		get_object_object_uint64(crtc_obj, "max_scaled"));
+}
+
+void print_probe(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, dev_obj) {
+		printf("Node: %s\n", path);
+
+		const char *error = get_object_object_string(dev_obj, "error");
+		if (error) {
+			printf(L_LAST "Not probed: %s\n", error);
+			continue;
+		}
+
+		struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+		size_t crtcs_len = json_object_array_length(crtcs_arr);
+		printf(L_VAL "Tests: %"PRIu64" run, %"PRIu64" cached, %"PRIu64" pruned\n",
+			get_object_object_uint64(dev_obj, "tests"),
+			get_object_object_uint64(dev_obj, "cached"),
+			get_object_object_uint64(dev_obj, "pruned"));
+		if (crtcs_len == 0) {
+			printf(L_LAST "No active CRTC\n");
+			continue;
+		}
+		for (size_t i = 0; i < crtcs_len; i++) {
+			bool last = i == crtcs_len - 1;
+			printf("%s", last ? L_LAST : L_VAL);
+			print_probe_crtc(json_object_array_get_idx(crtcs_arr, i),
+				last ? L_GAP : L_LINE);
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef PROPS_H
+#define PROPS_H
+
+/* Decoders for the data behind a property value, e.g. the contents of a
+ * blob or the framebuffer an FB_ID points to */
+enum prop_decoder {
+	PROP_DECODER_NONE = 0,
+	PROP_DECODER_IN_FORMATS,
+	PROP_DECODER_MODE_ID,
+	PROP_DECODER_WRITEBACK_PIXEL_FORMATS,
+	PROP_DECODER_PATH,
+	PROP_DECODER_HDR_OUTPUT_METADATA,
+	PROP_DECODER_EDID,
+	PROP_DECODER_LUT,
+	PROP_DECODER_CTM,
+	PROP_DECODER_FIXED_16_16,
+	PROP_DECODER_FB,
+	PROP_DECODER_COUNT,
+};
+
+/* The implementation is generated by props.py, as a perfect hash on the
+ * property names it lists. Returns PROP_DECODER_NONE for other names. */
+enum prop_decoder prop_decoder_lookup(const char *name);
+
+#endif
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+
+import sys
+
+# Property names with a decoder, mapped to their enum prop_decoder value in
+# props.h
+decoders = {
+	'IN_FORMATS': 'IN_FORMATS',
+	'MODE_ID': 'MODE_ID',
+	'WRITEBACK_PIXEL_FORMATS': 'WRITEBACK_PIXEL_FORMATS',
+	'PATH': 'PATH',
+	'HDR_OUTPUT_METADATA': 'HDR_OUTPUT_METADATA',
+	'EDID': 'EDID',
+	'GAMMA_LUT': 'LUT',
+	'DEGAMMA_LUT': 'LUT',
+	'CTM': 'CTM',
+	# Source coordinates are in 16.16 fixed point
+	'SRC_X': 'FIXED_16_16',
+	'SRC_Y': 'FIXED_16_16',
+	'SRC_W': 'FIXED_16_16',
+	'SRC_H': 'FIXED_16_16',
+	'FB_ID': 'FB',
+}
+
+def fnv1a(name):
+	h = 2166136261
+	for c in name.encode():
+		h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+	return h
+
+# A table twice as large as the number of names. The FNV-1a hash is
+# multiplied by the first odd seed for which no two names share a slot, and
+# the slot is taken from the top bits of the product.
+bits = 1
+while (1 << bits) < 2 * len(decoders):
+	bits += 1
+
+def slot(name, seed):
+	return ((fnv1a(name) * seed) & 0xFFFFFFFF) >> (32 - bits)
+
+seed = 1
+while len({slot(name, seed) for name in decoders}) != len(decoders):
+	seed += 2
+
+slots = {slot(name, seed): name for name in decoders}
+
+with open(sys.argv[1], 'w') as f:
+	f.write('''\
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "props.h"
+
+static const struct {{
+	const char *name;
+	enum prop_decoder decoder;
+}} prop_decoders[{}] = {{
+'''.format(1 << bits))
+
+	for i, name in sorted(slots.items()):
+		f.write('\t[{}] = {{ "{}", PROP_DECODER_{} }},\n'.format(i, name, decoders[name]))
+
+	f.write('''\
+}};
+
+enum prop_decoder prop_decoder_lookup(const char *name)
+{{
+	uint32_t h = 2166136261u;
+	for (const char *c = name; *c; c++) {{
+		h = (h ^ (uint8_t)*c) * 16777619u;
+	}}
+	size_t i = (uint32_t)(h * {}u) >> {};
+	if (prop_decoders[i].name && strcmp(prop_decoders[i].name, name) == 0) {{
+		return prop_decoders[i].decoder;
+	}}
+	return PROP_DECODER_NONE;
+}}
+'''.format(seed, 32 - bits))
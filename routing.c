@@ -0,0 +1,439 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <json_object.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+
+/* Lists which sets of connectors can be driven at the same time. Each
+ * connector needs an encoder of its own among its possible encoders, and
+ * each encoder a CRTC among its possible_crtcs. Encoders may share a CRTC,
+ * showing the same picture, if they are in each other's possible_clones.
+ *
+ * Routable sets are closed under removal: if a set can be driven, so can
+ * its subsets. They are enumerated by growing routable sets one connector
+ * at a time, always adding connectors in index order so that each set is
+ * reached once, and each candidate set is checked with a backtracking
+ * search over bitmasks of encoders and CRTCs in use. When there are too
+ * many sets to list, the largest is still found by a depth first search. */
+
+#define ROUTING_MAX 32
+/* Bounds the output for devices with many interchangeable connectors */
+#define ROUTING_SETS_MAX 65536
+
+struct routing {
+	size_t connectors_len, encoders_len, crtcs_len;
+	uint32_t connector_ids[ROUTING_MAX];
+	uint32_t encoder_ids[ROUTING_MAX];
+	uint32_t crtc_ids[ROUTING_MAX];
+	/* Bitmasks of encoder and CRTC indices */
+	uint32_t connector_encoders[ROUTING_MAX];
+	uint32_t encoder_crtcs[ROUTING_MAX];
+	/* Encoders which can share a CRTC with each encoder, both ways */
+	uint32_t encoder_clones[ROUTING_MAX];
+
+	/* Route of each connector in the last routable set */
+	size_t route_encoder[ROUTING_MAX];
+	size_t route_crtc[ROUTING_MAX];
+};
+
+struct routing_sets {
+	uint32_t *sets;
+	size_t len, cap;
+	bool truncated;
+};
+
+static bool load_routing(struct routing *r, struct json_object *dev_obj)
+{
+	struct json_object *encoders_arr =
+		json_object_object_get(dev_obj, "encoders");
+	struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+	struct json_object *connectors_arr =
+		json_object_object_get(dev_obj, "connectors");
+
+	r->crtcs_len = json_object_array_length(crtcs_arr);
+	r->encoders_len = json_object_array_length(encoders_arr);
+	if (r->crtcs_len > ROUTING_MAX || r->encoders_len > ROUTING_MAX) {
+		fprintf(stderr, "Too many CRTCs or encoders, at most %d\n",
+			ROUTING_MAX);
+		return false;
+	}
+	for (size_t i = 0; i < r->crtcs_len; i++) {
+		r->crtc_ids[i] = get_object_object_uint64(
+			json_object_array_get_idx(crtcs_arr, i), "id");
+	}
+
+	uint32_t clones[ROUTING_MAX];
+	for (size_t i = 0; i < r->encoders_len; i++) {
+		struct json_object *enc_obj = json_object_array_get_idx(encoders_arr, i);
+		r->encoder_ids[i] = get_object_object_uint64(enc_obj, "id");
+		r->encoder_crtcs[i] =
+			get_object_object_uint64(enc_obj, "possible_crtcs");
+		clones[i] = get_object_object_uint64(enc_obj, "possible_clones");
+	}
+	for (size_t i = 0; i < r->encoders_len; i++) {
+		for (size_t j = 0; j < r->encoders_len; j++) {
+			if (i != j && (clones[i] & (1U << j)) && (clones[j] & (1U << i))) {
+				r->encoder_clones[i] |= 1U << j;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < json_object_array_length(connectors_arr); i++) {
+		struct json_object *conn_obj =
+			json_object_array_get_idx(connectors_arr, i);
+		/* Writeback connectors don't drive a display */
+		if (get_object_object_uint64(conn_obj, "type") ==
+				DRM_MODE_CONNECTOR_WRITEBACK) {
+			continue;
+		}
+		if (r->connectors_len == ROUTING_MAX) {
+			fprintf(stderr, "Too many connectors, only routing the first %d\n",
+				ROUTING_MAX);
+			break;
+		}
+
+		size_t c = r->connectors_len++;
+		r->connector_ids[c] = get_object_object_uint64(conn_obj, "id");
+		struct json_object *encs_arr = json_object_object_get(conn_obj, "encoders");
+		for (size_t j = 0; j < json_object_array_length(encs_arr); j++) {
+			uint32_t enc_id = json_object_get_uint64(
+				json_object_array_get_idx(encs_arr, j));
+			for (size_t e = 0; e < r->encoders_len; e++) {
+				if (r->encoder_ids[e] == enc_id) {
+					r->connector_encoders[c] |= 1U << e;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/* Cuts the search short when the connectors left can't all get an encoder,
+ * or those which can't be cloned can't all get a free CRTC. Without this,
+ * interchangeable connectors make the search try every permutation before
+ * giving up on a set one too large. */
+static bool enough_left(struct routing *r, uint32_t set,
+		uint32_t used_encoders, uint32_t used_crtcs, bool clone)
+{
+	uint32_t encoders = 0, solo_crtcs = 0;
+	int solo = 0;
+	for (uint32_t s = set; s; s &= s - 1) {
+		uint32_t conn_encoders =
+			r->connector_encoders[__builtin_ctz(s)] & ~used_encoders;
+		encoders |= conn_encoders;
+
+		uint32_t crtcs = 0;
+		bool clonable = false;
+		for (size_t e = 0; e < r->encoders_len; e++) {
+			if (conn_encoders & (1U << e)) {
+				crtcs |= r->encoder_crtcs[e];
+				clonable |= r->encoder_clones[e] != 0;
+			}
+		}
+		if (!clone || !clonable) {
+			solo++;
+			solo_crtcs |= crtcs & ~used_crtcs;
+		}
+	}
+	return __builtin_popcount(encoders) >= __builtin_popcount(set) &&
+		__builtin_popcount(solo_crtcs) >= solo;
+}
+
+/* Routes the connectors of set, lowest index first. crtc_encoders holds the
+ * encoders already on each CRTC. */
+static bool route(struct routing *r, uint32_t set, uint32_t used_encoders,
+		uint32_t used_crtcs, uint32_t *crtc_encoders, bool clone)
+{
+	if (set == 0) {
+		return true;
+	}
+	if (!enough_left(r, set, used_encoders, used_crtcs, clone)) {
+		return false;
+	}
+	size_t c = __builtin_ctz(set);
+	uint32_t encoders = r->connector_encoders[c] & ~used_encoders;
+	for (size_t e = 0; e < r->encoders_len; e++) {
+		if (!(encoders & (1U << e))) {
+			continue;
+		}
+		for (size_t crtc = 0; crtc < r->crtcs_len; crtc++) {
+			uint32_t bit = 1U << crtc;
+			if (!(r->encoder_crtcs[e] & bit)) {
+				continue;
+			}
+			/* A CRTC in use only takes clones of all its encoders */
+			if ((used_crtcs & bit) && (!clone ||
+					(crtc_encoders[crtc] & ~r->encoder_clones[e]))) {
+				continue;
+			}
+			r->route_encoder[c] = e;
+			r->route_crtc[c] = crtc;
+			crtc_encoders[crtc] |= 1U << e;
+			bool ok = route(r, set & (set - 1), used_encoders | (1U << e),
+				used_crtcs | bit, crtc_encoders, clone);
+			crtc_encoders[crtc] &= ~(1U << e);
+			if (ok) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool routable(struct routing *r, uint32_t set, bool clone)
+{
+	uint32_t crtc_encoders[ROUTING_MAX] = {0};
+	return route(r, set, 0, 0, crtc_encoders, clone);
+}
+
+static void add_set(struct routing_sets *sets, uint32_t set)
+{
+	if (sets->len == ROUTING_SETS_MAX) {
+		sets->truncated = true;
+		return;
+	}
+	if (sets->len == sets->cap) {
+		size_t cap = sets->cap ? 2 * sets->cap : 64;
+		uint32_t *new_sets = realloc(sets->sets, cap * sizeof(*new_sets));
+		if (!new_sets) {
+			perror("realloc");
+			sets->truncated = true;
+			return;
+		}
+		sets->sets = new_sets;
+		sets->cap = cap;
+	}
+	sets->sets[sets->len++] = set;
+}
+
+/* Fills sets with every routable set of connectors, the empty set first */
+static void enumerate(struct routing *r, struct routing_sets *sets, bool clone)
+{
+	add_set(sets, 0);
+	/* Sets are appended while iterating, each is grown once */
+	for (size_t i = 0; i < sets->len; i++) {
+		uint32_t set = sets->sets[i];
+		size_t next = set ? 32 - __builtin_clz(set) : 0;
+		for (size_t c = next; c < r->connectors_len; c++) {
+			uint32_t grown = set | (1U << c);
+			if (routable(r, grown, clone)) {
+				add_set(sets, grown);
+			}
+		}
+	}
+}
+
+static bool maximal(struct routing *r, uint32_t set, bool clone)
+{
+	for (size_t c = 0; c < r->connectors_len; c++) {
+		if (!(set & (1U << c)) && routable(r, set | (1U << c), clone)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static struct json_object *combination_info(struct routing *r, uint32_t set,
+		bool clone)
+{
+	routable(r, set, clone);
+
+	struct json_object *arr = json_object_new_array();
+	for (size_t c = 0; c < r->connectors_len; c++) {
+		if (!(set & (1U << c))) {
+			continue;
+		}
+		struct json_object *route_obj = json_object_new_object();
+		json_object_object_add(route_obj, "connector",
+			json_object_new_uint64(r->connector_ids[c]));
+		json_object_object_add(route_obj, "encoder",
+			json_object_new_uint64(r->encoder_ids[r->route_encoder[c]]));
+		json_object_object_add(route_obj, "crtc",
+			json_object_new_uint64(r->crtc_ids[r->route_crtc[c]]));
+		json_object_array_add(arr, route_obj);
+	}
+	return arr;
+}
+
+/* Depth first search for the largest routable set, used when the
+ * enumeration was cut short before reaching it */
+static void search_max(struct routing *r, uint32_t set, size_t next,
+		bool clone, size_t bound, size_t *max)
+{
+	size_t size = __builtin_popcount(set);
+	if (size > *max) {
+		*max = size;
+	}
+	for (size_t c = next; c < r->connectors_len && *max < bound; c++) {
+		if (size + r->connectors_len - c <= *max) {
+			break;
+		}
+		if (routable(r, set | (1U << c), clone)) {
+			search_max(r, set | (1U << c), c + 1, clone, bound, max);
+		}
+	}
+}
+
+static size_t max_routable(struct routing *r, bool clone)
+{
+	/* Each connector needs an encoder, and a CRTC unless cloned */
+	size_t bound = r->connectors_len;
+	if (r->encoders_len < bound) {
+		bound = r->encoders_len;
+	}
+	if (!clone && r->crtcs_len < bound) {
+		bound = r->crtcs_len;
+	}
+	size_t max = 0;
+	search_max(r, 0, 0, clone, bound, &max);
+	return max;
+}
+
+/* Adds the maximal routable sets, along with a route for each. With clone,
+ * sets which can also be routed without cloning are left out. */
+static size_t add_combinations(struct routing *r,
+		const struct routing_sets *sets, bool clone, struct json_object *arr)
+{
+	size_t max = 0;
+	for (size_t i = 0; i < sets->len; i++) {
+		uint32_t set = sets->sets[i];
+		size_t size = __builtin_popcount(set);
+		if (size > max) {
+			max = size;
+		}
+		if (set == 0 || !maximal(r, set, clone) ||
+				(clone && routable(r, set, false))) {
+			continue;
+		}
+		json_object_array_add(arr, combination_info(r, set, clone));
+	}
+	return max;
+}
+
+static struct json_object *routing_device(struct json_object *dev_obj)
+{
+	struct routing *r = calloc(1, sizeof(*r));
+	if (!r) {
+		perror("calloc");
+		return NULL;
+	}
+	if (!load_routing(r, dev_obj)) {
+		free(r);
+		return NULL;
+	}
+
+	bool clonable = false;
+	for (size_t e = 0; e < r->encoders_len; e++) {
+		clonable |= r->encoder_clones[e] != 0;
+	}
+
+	struct routing_sets independent = {0}, cloned = {0};
+	enumerate(r, &independent, false);
+	/* Without clones both searches give the same sets */
+	if (clonable) {
+		enumerate(r, &cloned, true);
+	}
+
+	struct json_object *obj = json_object_new_object();
+	struct json_object *ids_arr = json_object_new_array();
+	for (size_t c = 0; c < r->connectors_len; c++) {
+		json_object_array_add(ids_arr,
+			json_object_new_uint64(r->connector_ids[c]));
+	}
+	json_object_object_add(obj, "connectors", ids_arr);
+
+	struct json_object *combos_arr = json_object_new_array();
+	size_t max = add_combinations(r, &independent, false, combos_arr);
+	struct json_object *clone_combos_arr = json_object_new_array();
+	size_t max_cloned = clonable ?
+		add_combinations(r, &cloned, true, clone_combos_arr) : max;
+	if (independent.truncated) {
+		max = max_routable(r, false);
+	}
+	if (cloned.truncated || (!clonable && independent.truncated)) {
+		max_cloned = clonable ? max_routable(r, true) : max;
+	}
+
+	json_object_object_add(obj, "max_connectors", json_object_new_uint64(max));
+	json_object_object_add(obj, "max_connectors_cloned",
+		json_object_new_uint64(max_cloned));
+	/* Not counting the empty set */
+	json_object_object_add(obj, "routable_sets",
+		json_object_new_uint64(independent.len - 1));
+	json_object_object_add(obj, "truncated", json_object_new_boolean(
+		independent.truncated || cloned.truncated));
+	json_object_object_add(obj, "combinations", combos_arr);
+	json_object_object_add(obj, "clone_combinations", clone_combos_arr);
+
+	free(independent.sets);
+	free(cloned.sets);
+	free(r);
+	return obj;
+}
+
+struct json_object *routing_info(struct json_object *drm_obj)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		struct json_object *routing_obj = routing_device(dev_obj);
+		if (routing_obj) {
+			json_object_object_add(obj, path, routing_obj);
+		}
+	}
+	return obj;
+}
+
+static void print_combinations(struct json_object *arr, const char *prefix)
+{
+	size_t len = json_object_array_length(arr);
+	for (size_t i = 0; i < len; i++) {
+		struct json_object *routes_arr = json_object_array_get_idx(arr, i);
+		printf("%s%s", prefix, i == len - 1 ? L_LAST : L_VAL);
+		for (size_t j = 0; j < json_object_array_length(routes_arr); j++) {
+			struct json_object *route_obj =
+				json_object_array_get_idx(routes_arr, j);
+			printf("%s%"PRIu64" → %"PRIu64" → %"PRIu64, j == 0 ? "" : ", ",
+				get_object_object_uint64(route_obj, "connector"),
+				get_object_object_uint64(route_obj, "encoder"),
+				get_object_object_uint64(route_obj, "crtc"));
+		}
+		printf("\n");
+	}
+}
+
+void print_routing(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, dev_obj) {
+		printf("Node: %s\n", path);
+
+		struct json_object *combos_arr =
+			json_object_object_get(dev_obj, "combinations");
+		struct json_object *clone_combos_arr =
+			json_object_object_get(dev_obj, "clone_combinations");
+		bool clones = json_object_array_length(clone_combos_arr) > 0;
+
+		printf(L_VAL "Connectors: %zu\n", json_object_array_length(
+			json_object_object_get(dev_obj, "connectors")));
+		printf(L_VAL "Simultaneous: %"PRIu64" independent, %"PRIu64
+			" with cloning\n",
+			get_object_object_uint64(dev_obj, "max_connectors"),
+			get_object_object_uint64(dev_obj, "max_connectors_cloned"));
+		bool truncated = json_object_get_boolean(
+			json_object_object_get(dev_obj, "truncated"));
+		printf(L_VAL "Routable sets: %"PRIu64"%s\n",
+			get_object_object_uint64(dev_obj, "routable_sets"),
+			truncated ? " (truncated)" : "");
+
+		printf("%sLargest combinations (connector → encoder → CRTC)\n",
+			clones ? L_VAL : L_LAST);
+		print_combinations(combos_arr, clones ? L_LINE : L_GAP);
+		if (clones) {
+			printf(L_LAST "Combinations with cloning\n");
+			print_combinations(clone_combos_arr, L_GAP);
+		}
+	}
+}
@@ -0,0 +1,471 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json_object.h>
+
+#include "drm_info.h"
+
+/* Samples the busy, frequency, power and memory counters drivers expose in
+ * sysfs. Every attribute is opened once up front and re-read with a single
+ * pread() per tick, so a tick costs a few syscalls and no path lookups, and
+ * values go to a ring buffer allocated before sampling starts. Statistics
+ * are only computed once sampling is over. */
+
+/* Ticks kept in the ring buffer, older ones are overwritten */
+#define SAMPLE_RING_MAX 65536
+#define SAMPLE_ATTRS_MAX 16
+
+enum sample_kind {
+	SAMPLE_GAUGE,
+	/* Monotonic counter, reported as a rate per second */
+	SAMPLE_COUNTER,
+};
+
+struct sample_attr_desc {
+	const char *name;
+	/* Relative to the card directory, or to its hwmon directory */
+	const char *path;
+	bool hwmon;
+	enum sample_kind kind;
+	/* Multiplier from the raw value (or rate) to unit */
+	double scale;
+	const char *unit;
+};
+
+/* When several attributes share a name, the first one found is used */
+static const struct sample_attr_desc sample_attrs[] = {
+	{ "busy", "device/gpu_busy_percent", false, SAMPLE_GAUGE, 1, "%" },
+	{ "mem_busy", "device/mem_busy_percent", false, SAMPLE_GAUGE, 1, "%" },
+	{ "freq", "gt_act_freq_mhz", false, SAMPLE_GAUGE, 1, "MHz" },
+	{ "freq", "device/tile0/gt0/freq0/act_freq", false, SAMPLE_GAUGE, 1, "MHz" },
+	{ "freq", "freq1_input", true, SAMPLE_GAUGE, 1e-6, "MHz" },
+	{ "mem_freq", "freq2_input", true, SAMPLE_GAUGE, 1e-6, "MHz" },
+	{ "power", "power1_average", true, SAMPLE_GAUGE, 1e-6, "W" },
+	{ "power", "power1_input", true, SAMPLE_GAUGE, 1e-6, "W" },
+	{ "power", "energy1_input", true, SAMPLE_COUNTER, 1e-6, "W" },
+	{ "temp", "temp1_input", true, SAMPLE_GAUGE, 1e-3, "C" },
+	{ "vram_used", "device/mem_info_vram_used", false, SAMPLE_GAUGE, 1, "B" },
+	{ "gtt_used", "device/mem_info_gtt_used", false, SAMPLE_GAUGE, 1, "B" },
+};
+
+/* Marks a tick where the attribute couldn't be read, e.g. because the
+ * device was runtime suspended */
+#define SAMPLE_MISSING INT64_MIN
+
+struct sample_card {
+	char path[PATH_MAX];
+	const struct sample_attr_desc *attrs[SAMPLE_ATTRS_MAX];
+	int fds[SAMPLE_ATTRS_MAX];
+	size_t attrs_len;
+	/* Index of the card's first column in the ring buffer */
+	size_t col;
+};
+
+static bool is_card(const char *name)
+{
+	if (strncmp(name, "card", 4) != 0 || name[4] == '\0') {
+		return false;
+	}
+	for (const char *c = name + 4; *c; c++) {
+		if (*c < '0' || *c > '9') {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool wanted(char *paths[], const char *card)
+{
+	if (!paths[0]) {
+		return true;
+	}
+	for (char **path = paths; *path; ++path) {
+		const char *base = strrchr(*path, '/');
+		if (strcmp(base ? base + 1 : *path, card) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* hwmon directories are named after a global index, e.g.
+ * device/hwmon/hwmon3 */
+static int open_hwmon(int card_fd)
+{
+	int hwmon_fd = openat(card_fd, "device/hwmon",
+		O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (hwmon_fd < 0) {
+		return -1;
+	}
+	DIR *dir = fdopendir(hwmon_fd);
+	if (!dir) {
+		close(hwmon_fd);
+		return -1;
+	}
+
+	int fd = -1;
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		if (strncmp(ent->d_name, "hwmon", 5) == 0) {
+			fd = openat(dirfd(dir), ent->d_name,
+				O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			break;
+		}
+	}
+	closedir(dir);
+	return fd;
+}
+
+static bool has_attr(const struct sample_card *card, const char *name)
+{
+	for (size_t i = 0; i < card->attrs_len; i++) {
+		if (strcmp(card->attrs[i]->name, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void open_card(struct sample_card *card, int class_fd, const char *name)
+{
+	snprintf(card->path, sizeof(card->path), "/dev/dri/%s", name);
+	card->attrs_len = 0;
+
+	int card_fd = openat(class_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (card_fd < 0) {
+		perror(name);
+		return;
+	}
+	int hwmon_fd = open_hwmon(card_fd);
+
+	size_t descs_len = sizeof(sample_attrs) / sizeof(sample_attrs[0]);
+	for (size_t i = 0; i < descs_len; i++) {
+		const struct sample_attr_desc *desc = &sample_attrs[i];
+		int dir_fd = desc->hwmon ? hwmon_fd : card_fd;
+		if (dir_fd < 0 || has_attr(card, desc->name)) {
+			continue;
+		}
+		int fd = openat(dir_fd, desc->path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			continue;
+		}
+		card->attrs[card->attrs_len] = desc;
+		card->fds[card->attrs_len] = fd;
+		card->attrs_len++;
+	}
+
+	if (hwmon_fd >= 0) {
+		close(hwmon_fd);
+	}
+	close(card_fd);
+}
+
+static int64_t read_value(int fd)
+{
+	char buf[32];
+	ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (len <= 0) {
+		return SAMPLE_MISSING;
+	}
+	buf[len] = '\0';
+
+	char *end;
+	errno = 0;
+	long long val = strtoll(buf, &end, 10);
+	if (errno != 0 || end == buf) {
+		return SAMPLE_MISSING;
+	}
+	return val;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int double_cmp(const void *a_ptr, const void *b_ptr)
+{
+	double a = *(const double *)a_ptr, b = *(const double *)b_ptr;
+	return a < b ? -1 : a > b;
+}
+
+/* Nearest-rank percentile of a sorted array */
+static double percentile(const double *sorted, size_t len, unsigned p)
+{
+	size_t rank = (p * len + 99) / 100;
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static struct json_object *stats_to_json(double *vals, size_t len)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "samples", json_object_new_uint64(len));
+	if (len == 0) {
+		return obj;
+	}
+
+	qsort(vals, len, sizeof(*vals), double_cmp);
+	double sum = 0;
+	for (size_t i = 0; i < len; i++) {
+		sum += vals[i];
+	}
+	json_object_object_add(obj, "min", json_object_new_double(vals[0]));
+	json_object_object_add(obj, "mean", json_object_new_double(sum / len));
+	static const unsigned percentiles[] = { 50, 90, 99 };
+	for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+		char key[8];
+		snprintf(key, sizeof(key), "p%u", percentiles[i]);
+		json_object_object_add(obj, key, json_object_new_double(
+			percentile(vals, len, percentiles[i])));
+	}
+	json_object_object_add(obj, "max", json_object_new_double(vals[len - 1]));
+	return obj;
+}
+
+/* Walks the ticks of a column in chronological order. Counters are turned
+ * into a rate between consecutive readable ticks. */
+static size_t column_values(const int64_t *ring, const uint64_t *times,
+		size_t first, size_t len, size_t cols, size_t col,
+		const struct sample_attr_desc *desc, double *out)
+{
+	size_t out_len = 0;
+	int64_t prev_val = SAMPLE_MISSING;
+	uint64_t prev_ns = 0;
+	for (size_t i = 0; i < len; i++) {
+		size_t tick = (first + i) % len;
+		int64_t val = ring[tick * cols + col];
+		if (val == SAMPLE_MISSING) {
+			continue;
+		}
+		if (desc->kind == SAMPLE_GAUGE) {
+			out[out_len++] = val * desc->scale;
+		} else if (prev_val != SAMPLE_MISSING && times[tick] > prev_ns &&
+				val >= prev_val) {
+			double secs = (times[tick] - prev_ns) / 1e9;
+			out[out_len++] = (val - prev_val) / secs * desc->scale;
+		}
+		prev_val = val;
+		prev_ns = times[tick];
+	}
+	return out_len;
+}
+
+static int card_cmp(const void *a_ptr, const void *b_ptr)
+{
+	const struct sample_card *a = a_ptr, *b = b_ptr;
+	/* Sort card2 before card10 */
+	size_t a_len = strlen(a->path), b_len = strlen(b->path);
+	if (a_len != b_len) {
+		return a_len < b_len ? -1 : 1;
+	}
+	return strcmp(a->path, b->path);
+}
+
+/* root is the sysfs mount point and paths filters cards as with
+ * sysfs_info(). Samples rate_hz times per second for the given number of
+ * seconds. */
+struct json_object *sample_info(const char *root, char *paths[],
+		unsigned rate_hz, unsigned seconds)
+{
+	char class_path[PATH_MAX];
+	snprintf(class_path, sizeof(class_path), "%s/class/drm", root);
+
+	DIR *dir = opendir(class_path);
+	if (!dir) {
+		perror(class_path);
+		return NULL;
+	}
+
+	struct sample_card *cards = NULL;
+	size_t cards_len = 0, cards_cap = 0, cols = 0;
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		if (!is_card(ent->d_name) || !wanted(paths, ent->d_name)) {
+			continue;
+		}
+		if (cards_len == cards_cap) {
+			cards_cap = cards_cap ? 2 * cards_cap : 8;
+			struct sample_card *new_cards =
+				realloc(cards, cards_cap * sizeof(*cards));
+			if (!new_cards) {
+				perror("realloc");
+				break;
+			}
+			cards = new_cards;
+		}
+		struct sample_card *card = &cards[cards_len++];
+		open_card(card, dirfd(dir), ent->d_name);
+		card->col = cols;
+		cols += card->attrs_len;
+	}
+	closedir(dir);
+	if (cards_len > 0) {
+		qsort(cards, cards_len, sizeof(*cards), card_cmp);
+	}
+
+	uint64_t ticks = (uint64_t)rate_hz * seconds;
+	size_t ring_len = ticks < SAMPLE_RING_MAX ? ticks : SAMPLE_RING_MAX;
+	int64_t *ring = calloc(ring_len * cols + 1, sizeof(*ring));
+	uint64_t *times = calloc(ring_len, sizeof(*times));
+	uint64_t *costs = calloc(ring_len, sizeof(*costs));
+	double *vals = calloc(ring_len, sizeof(*vals));
+	if (!ring || !times || !costs || !vals) {
+		perror("calloc");
+		ticks = 0;
+	}
+
+	/* Ticks are scheduled on absolute deadlines so that the time spent
+	 * reading doesn't accumulate as drift. Deadlines already missed are
+	 * skipped rather than sampled in a burst. */
+	uint64_t period_ns = 1000000000 / rate_hz;
+	uint64_t start_ns = now_ns(), deadline_ns = start_ns;
+	uint64_t overruns = 0, done = 0;
+	while (done < ticks) {
+		size_t tick = done % ring_len;
+		uint64_t tick_ns = now_ns();
+		int64_t *row = &ring[tick * cols];
+		for (size_t i = 0; i < cards_len; i++) {
+			const struct sample_card *card = &cards[i];
+			for (size_t j = 0; j < card->attrs_len; j++) {
+				row[card->col + j] = read_value(card->fds[j]);
+			}
+		}
+		times[tick] = tick_ns;
+		costs[tick] = now_ns() - tick_ns;
+		done++;
+
+		deadline_ns += period_ns;
+		uint64_t cur_ns = now_ns();
+		if (cur_ns > deadline_ns) {
+			uint64_t late = (cur_ns - deadline_ns) / period_ns + 1;
+			overruns += late;
+			deadline_ns += late * period_ns;
+		}
+		struct timespec ts = {
+			.tv_sec = deadline_ns / 1000000000,
+			.tv_nsec = deadline_ns % 1000000000,
+		};
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+				NULL) == EINTR);
+	}
+	uint64_t elapsed_ns = now_ns() - start_ns;
+
+	size_t len = done < ring_len ? done : ring_len;
+	size_t first = done < ring_len ? 0 : done % ring_len;
+
+	struct json_object *obj = json_object_new_object();
+	for (size_t i = 0; i < cards_len; i++) {
+		struct sample_card *card = &cards[i];
+
+		struct json_object *card_obj = json_object_new_object();
+		json_object_object_add(card_obj, "rate_hz",
+			json_object_new_uint64(rate_hz));
+		json_object_object_add(card_obj, "duration_ns",
+			json_object_new_uint64(elapsed_ns));
+		json_object_object_add(card_obj, "ticks",
+			json_object_new_uint64(done));
+		json_object_object_add(card_obj, "overruns",
+			json_object_new_uint64(overruns));
+
+		/* The cost is for all cards together, a tick reads them in one go */
+		for (size_t t = 0; t < len; t++) {
+			vals[t] = costs[t];
+		}
+		json_object_object_add(card_obj, "tick_cost_ns",
+			stats_to_json(vals, len));
+
+		struct json_object *attrs_obj = json_object_new_object();
+		for (size_t j = 0; j < card->attrs_len; j++) {
+			const struct sample_attr_desc *desc = card->attrs[j];
+			size_t vals_len = column_values(ring, times, first, len,
+				cols, card->col + j, desc, vals);
+			struct json_object *attr_obj = stats_to_json(vals, vals_len);
+			json_object_object_add(attr_obj, "unit",
+				json_object_new_string(desc->unit));
+			json_object_object_add(attr_obj, "source",
+				json_object_new_string(desc->path));
+			json_object_object_add(attrs_obj, desc->name, attr_obj);
+			close(card->fds[j]);
+		}
+		json_object_object_add(card_obj, "attributes", attrs_obj);
+
+		json_object_object_add(obj, card->path, card_obj);
+	}
+
+	free(vals);
+	free(costs);
+	free(times);
+	free(ring);
+	free(cards);
+	return obj;
+}
+
+static void print_value(double val, const char *unit)
+{
+	if (strcmp(unit, "B") == 0) {
+		printf("%.1f MiB", val / (1024 * 1024));
+	} else {
+		printf("%.1f %s", val, unit);
+	}
+}
+
+static void print_attr(const char *name, struct json_object *obj)
+{
+	const char *unit = get_object_object_string(obj, "unit");
+	printf("%s: ", name);
+	if (get_object_object_uint64(obj, "samples") == 0) {
+		printf("unavailable\n");
+		return;
+	}
+	print_value(get_object_object_double(obj, "mean"), unit);
+	printf(" mean, ");
+	print_value(get_object_object_double(obj, "p50"), unit);
+	printf(" p50, ");
+	print_value(get_object_object_double(obj, "p99"), unit);
+	printf(" p99 (");
+	print_value(get_object_object_double(obj, "min"), unit);
+	printf(" - ");
+	print_value(get_object_object_double(obj, "max"), unit);
+	printf(")\n");
+}
+
+void print_samples(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, card_obj) {
+		printf("Node: %s\n", path);
+
+		struct json_object *cost_obj =
+			json_object_object_get(card_obj, "tick_cost_ns");
+		printf(L_VAL "Ticks: %"PRIu64" at %"PRIu64" Hz, %"PRIu64" overruns\n",
+			get_object_object_uint64(card_obj, "ticks"),
+			get_object_object_uint64(card_obj, "rate_hz"),
+			get_object_object_uint64(card_obj, "overruns"));
+		printf(L_VAL "Tick cost: %.1f us p50, %.1f us max\n",
+			get_object_object_double(cost_obj, "p50") / 1000,
+			get_object_object_double(cost_obj, "max") / 1000);
+
+		struct json_object *attrs_obj =
+			json_object_object_get(card_obj, "attributes");
+		size_t attrs_len = json_object_object_length(attrs_obj);
+		if (attrs_len == 0) {
+			printf(L_LAST "No attribute to sample\n");
+			continue;
+		}
+		size_t i = 0;
+		json_object_object_foreach(attrs_obj, name, attr_obj) {
+			printf("%s", ++i == attrs_len ? L_LAST : L_VAL);
+			print_attr(name, attr_obj);
+		}
+	}
+}
@@ -0,0 +1,503 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <drm_fourcc.h>
+#include <json_object.h>
+
+#include "drm_info.h"
+#include "modifiers.h"
+#include "scanout.h"
+#include "tables.h"
+
+static size_t entry_hash(uint32_t format, uint64_t modifier)
+{
+	uint64_t h = (modifier ^ ((uint64_t)format << 32 | format)) *
+		0x9E3779B97F4A7C15ULL;
+	return h ^ (h >> 32);
+}
+
+static struct scanout_entry *find_entry(struct scanout_entry *entries,
+		size_t cap, uint32_t format, uint64_t modifier)
+{
+	/* Open addressing with linear probing, cap is a power of two and the
+	 * table is never full */
+	size_t i = entry_hash(format, modifier) & (cap - 1);
+	while (entries[i].used && (entries[i].format != format ||
+			entries[i].modifier != modifier)) {
+		i = (i + 1) & (cap - 1);
+	}
+	return &entries[i];
+}
+
+static bool grow(struct scanout_index *index)
+{
+	size_t cap = index->entries_cap ? 2 * index->entries_cap : 64;
+	struct scanout_entry *entries = calloc(cap, sizeof(*entries));
+	if (!entries) {
+		perror("calloc");
+		return false;
+	}
+
+	for (size_t i = 0; i < index->entries_cap; i++) {
+		struct scanout_entry *entry = &index->entries[i];
+		if (entry->used) {
+			*find_entry(entries, cap, entry->format, entry->modifier) = *entry;
+		}
+	}
+
+	free(index->entries);
+	index->entries = entries;
+	index->entries_cap = cap;
+	return true;
+}
+
+static void index_add(struct scanout_index *index, uint32_t format,
+		uint64_t modifier, size_t plane)
+{
+	if (2 * (index->entries_len + 1) > index->entries_cap && !grow(index)) {
+		return;
+	}
+
+	struct scanout_entry *entry = find_entry(index->entries,
+		index->entries_cap, format, modifier);
+	if (!entry->used) {
+		entry->used = true;
+		entry->format = format;
+		entry->modifier = modifier;
+		index->entries_len++;
+	}
+	entry->planes |= 1ULL << plane;
+	entry->crtcs |= index->plane_crtcs[plane];
+}
+
+struct scanout_index *scanout_index_create(struct json_object *node_obj)
+{
+	struct scanout_index *index = calloc(1, sizeof(*index));
+	if (!index) {
+		perror("calloc");
+		return NULL;
+	}
+
+	struct json_object *crtcs_arr = json_object_object_get(node_obj, "crtcs");
+	for (size_t i = 0; i < json_object_array_length(crtcs_arr); i++) {
+		if (i >= SCANOUT_MAX_CRTCS) {
+			fprintf(stderr, "Too many CRTCs, only indexing the first %d\n",
+				SCANOUT_MAX_CRTCS);
+			break;
+		}
+		index->crtc_ids[i] = get_object_object_uint64(
+			json_object_array_get_idx(crtcs_arr, i), "id");
+		index->crtcs_len++;
+	}
+
+	struct json_object *planes_arr = json_object_object_get(node_obj, "planes");
+	for (size_t i = 0; i < json_object_array_length(planes_arr); i++) {
+		if (i >= SCANOUT_MAX_PLANES) {
+			fprintf(stderr, "Too many planes, only indexing the first %d\n",
+				SCANOUT_MAX_PLANES);
+			break;
+		}
+
+		struct json_object *plane_obj = json_object_array_get_idx(planes_arr, i);
+		index->plane_ids[i] = get_object_object_uint64(plane_obj, "id");
+		index->plane_crtcs[i] =
+			get_object_object_uint64(plane_obj, "possible_crtcs");
+		index->planes_len++;
+
+		struct json_object *props_obj =
+			json_object_object_get(plane_obj, "properties");
+		struct json_object *in_formats_arr = json_object_object_get(
+			json_object_object_get(props_obj, "IN_FORMATS"), "data");
+		if (!in_formats_arr) {
+			struct json_object *formats_arr =
+				json_object_object_get(plane_obj, "formats");
+			for (size_t j = 0; j < json_object_array_length(formats_arr); j++) {
+				uint32_t fmt = json_object_get_uint64(
+					json_object_array_get_idx(formats_arr, j));
+				index_add(index, fmt, DRM_FORMAT_MOD_INVALID, i);
+			}
+			continue;
+		}
+
+		for (size_t j = 0; j < json_object_array_length(in_formats_arr); j++) {
+			struct json_object *mod_obj =
+				json_object_array_get_idx(in_formats_arr, j);
+			uint64_t mod = get_object_object_uint64(mod_obj, "modifier");
+			struct json_object *formats_arr =
+				json_object_object_get(mod_obj, "formats");
+			for (size_t k = 0; k < json_object_array_length(formats_arr); k++) {
+				uint32_t fmt = json_object_get_uint64(
+					json_object_array_get_idx(formats_arr, k));
+				index_add(index, fmt, mod, i);
+			}
+		}
+	}
+
+	return index;
+}
+
+void scanout_index_destroy(struct scanout_index *index)
+{
+	if (!index) {
+		return;
+	}
+	free(index->entries);
+	free(index);
+}
+
+static void merge_entry(const struct scanout_index *index, uint32_t format,
+		uint64_t modifier, struct scanout_entry *entry)
+{
+	if (!index->entries_cap) {
+		return;
+	}
+	const struct scanout_entry *found = find_entry(index->entries,
+		index->entries_cap, format, modifier);
+	if (found->used) {
+		entry->planes |= found->planes;
+		entry->crtcs |= found->crtcs;
+	}
+}
+
+bool scanout_index_lookup(const struct scanout_index *index, uint32_t format,
+		uint64_t modifier, struct scanout_entry *entry)
+{
+	*entry = (struct scanout_entry){ .format = format, .modifier = modifier };
+	merge_entry(index, format, modifier, entry);
+	if (modifier == DRM_FORMAT_MOD_LINEAR) {
+		merge_entry(index, format, DRM_FORMAT_MOD_INVALID, entry);
+	}
+	entry->used = entry->planes != 0;
+	return entry->used;
+}
+
+static bool parse_uint64(const char *str, uint64_t *val)
+{
+	char *end;
+	errno = 0;
+	*val = strtoull(str, &end, 0);
+	return errno == 0 && end != str && *end == '\0';
+}
+
+bool parse_format_modifier(const char *str, uint32_t *format,
+		uint64_t *modifier)
+{
+	char fmt_str[64];
+	const char *sep = strchr(str, ':');
+	size_t fmt_len = sep ? (size_t)(sep - str) : strlen(str);
+	if (fmt_len >= sizeof(fmt_str)) {
+		return false;
+	}
+	memcpy(fmt_str, str, fmt_len);
+	fmt_str[fmt_len] = '\0';
+
+	uint64_t val;
+	*format = format_from_str(fmt_str);
+	if (*format == DRM_FORMAT_INVALID) {
+		if (parse_uint64(fmt_str, &val) && val <= UINT32_MAX) {
+			*format = val;
+		} else if (fmt_len == 4) {
+			/* Raw four character code, e.g. "AR24" */
+			*format = fourcc_code(fmt_str[0], fmt_str[1], fmt_str[2], fmt_str[3]);
+		} else {
+			return false;
+		}
+	}
+
+	*modifier = DRM_FORMAT_MOD_LINEAR;
+	if (!sep) {
+		return true;
+	}
+
+	const char *mod_str = sep + 1;
+	if (parse_uint64(mod_str, &val)) {
+		*modifier = val;
+		return true;
+	}
+	if (strcmp(mod_str, "INVALID") == 0 ||
+			strcmp(mod_str, "DRM_FORMAT_MOD_INVALID") == 0) {
+		*modifier = DRM_FORMAT_MOD_INVALID;
+		return true;
+	}
+
+	/* Accept modifier names with or without the DRM_FORMAT_MOD_ prefix */
+	*modifier = modifier_from_str(mod_str);
+	if (*modifier == DRM_FORMAT_MOD_INVALID) {
+		char full_name[128];
+		snprintf(full_name, sizeof(full_name), "DRM_FORMAT_MOD_%s", mod_str);
+		*modifier = modifier_from_str(full_name);
+	}
+	return *modifier != DRM_FORMAT_MOD_INVALID;
+}
+
+static struct json_object *ids_arr(const uint32_t *ids, size_t len,
+		uint64_t mask)
+{
+	struct json_object *arr = json_object_new_array();
+	for (size_t i = 0; i < len; i++) {
+		if (mask & (1ULL << i)) {
+			json_object_array_add(arr, json_object_new_uint64(ids[i]));
+		}
+	}
+	return arr;
+}
+
+struct json_object *scanout_info(struct json_object *drm_obj,
+		uint32_t format, uint64_t modifier)
+{
+	struct json_object *obj = json_object_new_object();
+
+	json_object_object_foreach(drm_obj, path, node_obj) {
+		struct scanout_index *index = scanout_index_create(node_obj);
+		if (!index) {
+			continue;
+		}
+
+		struct scanout_entry entry;
+		scanout_index_lookup(index, format, modifier, &entry);
+		uint64_t planes = entry.planes;
+		uint32_t crtcs = entry.crtcs;
+
+		struct json_object *node_res_obj = json_object_new_object();
+		json_object_object_add(node_res_obj, "format",
+			json_object_new_uint64(format));
+		json_object_object_add(node_res_obj, "modifier",
+			json_object_new_uint64(modifier));
+		json_object_object_add(node_res_obj, "planes",
+			ids_arr(index->plane_ids, index->planes_len, planes));
+		json_object_object_add(node_res_obj, "crtcs",
+			ids_arr(index->crtc_ids, index->crtcs_len, crtcs));
+		json_object_object_add(obj, path, node_res_obj);
+
+		scanout_index_destroy(index);
+	}
+
+	return obj;
+}
+
+static void print_ids(struct json_object *arr)
+{
+	if (json_object_array_length(arr) == 0) {
+		printf("none\n");
+		return;
+	}
+	for (size_t i = 0; i < json_object_array_length(arr); i++) {
+		printf("%s%"PRIu64, i == 0 ? "" : ", ",
+			json_object_get_uint64(json_object_array_get_idx(arr, i)));
+	}
+	printf("\n");
+}
+
+void print_scanout(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, node_obj) {
+		uint32_t fmt = get_object_object_uint64(node_obj, "format");
+		uint64_t mod = get_object_object_uint64(node_obj, "modifier");
+
+		printf("Node: %s\n", path);
+		printf(L_VAL "Format: %s (0x%08"PRIx32")\n", format_str(fmt), fmt);
+		printf(L_VAL "Modifier: ");
+		print_modifier(mod);
+		printf("\n");
+		printf(L_VAL "Plane IDs: ");
+		print_ids(json_object_object_get(node_obj, "planes"));
+		printf(L_LAST "CRTC IDs: ");
+		print_ids(json_object_object_get(node_obj, "crtcs"));
+	}
+}
+
+static struct json_object *new_pair(uint32_t format, uint64_t modifier)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "format", json_object_new_uint64(format));
+	json_object_object_add(obj, "modifier", json_object_new_uint64(modifier));
+	return obj;
+}
+
+static struct json_object *new_id_pairs(uint32_t id)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "id", json_object_new_uint64(id));
+	json_object_object_add(obj, "formats", json_object_new_array());
+	return obj;
+}
+
+static void add_pair(struct json_object *id_obj, uint32_t format,
+		uint64_t modifier)
+{
+	json_object_array_add(json_object_object_get(id_obj, "formats"),
+		new_pair(format, modifier));
+}
+
+struct json_object *zero_copy_info(struct json_object *drm_obj,
+		struct json_object *egl_obj)
+{
+	struct json_object *obj = json_object_new_object();
+
+	json_object_object_foreach(drm_obj, path, node_obj) {
+		struct json_object *egl_dev_obj = json_object_object_get(egl_obj, path);
+		if (!egl_dev_obj) {
+			fprintf(stderr, "%s: no matching EGL device\n", path);
+			continue;
+		}
+
+		struct scanout_index *index = scanout_index_create(node_obj);
+		if (!index) {
+			continue;
+		}
+
+		struct json_object *planes_arr = json_object_new_array();
+		for (size_t i = 0; i < index->planes_len; i++) {
+			json_object_array_add(planes_arr,
+				new_id_pairs(index->plane_ids[i]));
+		}
+		struct json_object *crtcs_arr = json_object_new_array();
+		for (size_t i = 0; i < index->crtcs_len; i++) {
+			json_object_array_add(crtcs_arr, new_id_pairs(index->crtc_ids[i]));
+		}
+
+		/* Each EGL pair is looked up once, its plane and CRTC bitmasks
+		 * give the intersection for every plane and CRTC at once */
+		struct json_object *formats_arr =
+			json_object_object_get(egl_dev_obj, "formats");
+		for (size_t i = 0; i < json_object_array_length(formats_arr); i++) {
+			struct json_object *format_obj =
+				json_object_array_get_idx(formats_arr, i);
+			uint32_t fmt = get_object_object_uint64(format_obj, "format");
+			struct json_object *modifiers_arr =
+				json_object_object_get(format_obj, "modifiers");
+			for (size_t j = 0; j < json_object_array_length(modifiers_arr); j++) {
+				uint64_t mod = json_object_get_uint64(
+					json_object_array_get_idx(modifiers_arr, j));
+				struct scanout_entry entry;
+				if (!scanout_index_lookup(index, fmt, mod, &entry)) {
+					continue;
+				}
+
+				for (size_t k = 0; k < index->planes_len; k++) {
+					if (entry.planes & (1ULL << k)) {
+						add_pair(json_object_array_get_idx(planes_arr, k),
+							fmt, mod);
+					}
+				}
+				for (size_t k = 0; k < index->crtcs_len; k++) {
+					if (entry.crtcs & (1U << k)) {
+						add_pair(json_object_array_get_idx(crtcs_arr, k),
+							fmt, mod);
+					}
+				}
+			}
+		}
+
+		struct json_object *node_res_obj = json_object_new_object();
+		json_object_object_add(node_res_obj, "crtcs", crtcs_arr);
+		json_object_object_add(node_res_obj, "planes", planes_arr);
+		json_object_object_add(obj, path, node_res_obj);
+
+		scanout_index_destroy(index);
+	}
+
+	return obj;
+}
+
+static void print_pairs(const char *name, struct json_object *arr,
+		const char *prefix)
+{
+	for (size_t i = 0; i < json_object_array_length(arr); i++) {
+		struct json_object *id_obj = json_object_array_get_idx(arr, i);
+		bool last = i == json_object_array_length(arr) - 1;
+		struct json_object *formats_arr =
+			json_object_object_get(id_obj, "formats");
+		size_t formats_len = json_object_array_length(formats_arr);
+
+		printf("%s%s%s %"PRIu64": ", prefix, last ? L_LAST : L_VAL, name,
+			get_object_object_uint64(id_obj, "id"));
+		if (formats_len == 0) {
+			printf("none\n");
+			continue;
+		}
+		printf("%zu pairs\n", formats_len);
+
+		for (size_t j = 0; j < formats_len; j++) {
+			struct json_object *pair_obj =
+				json_object_array_get_idx(formats_arr, j);
+			uint32_t fmt = get_object_object_uint64(pair_obj, "format");
+			printf("%s%s%s%s (0x%08"PRIx32"): ", prefix,
+				last ? L_GAP : L_LINE,
+				j == formats_len - 1 ? L_LAST : L_VAL,
+				format_str(fmt), fmt);
+			print_modifier(get_object_object_uint64(pair_obj, "modifier"));
+			printf("\n");
+		}
+	}
+}
+
+void print_zero_copy(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, node_obj) {
+		printf("Node: %s\n", path);
+		printf(L_VAL "CRTCs\n");
+		print_pairs("CRTC", json_object_object_get(node_obj, "crtcs"), L_LINE);
+		printf(L_LAST "Planes\n");
+		print_pairs("Plane", json_object_object_get(node_obj, "planes"), L_GAP);
+	}
+}
+
+static int entry_cmp(const void *a, const void *b)
+{
+	const struct scanout_entry *ea = *(const struct scanout_entry **)a;
+	const struct scanout_entry *eb = *(const struct scanout_entry **)b;
+	if (ea->format != eb->format) {
+		return ea->format < eb->format ? -1 : 1;
+	}
+	if (ea->modifier != eb->modifier) {
+		return ea->modifier < eb->modifier ? -1 : 1;
+	}
+	return 0;
+}
+
+struct json_object *scanout_index_info(struct json_object *node_obj)
+{
+	struct scanout_index *index = scanout_index_create(node_obj);
+	if (!index) {
+		return NULL;
+	}
+
+	/* Sorted by format and modifier so dumps diff cleanly */
+	const struct scanout_entry **sorted =
+		calloc(index->entries_len, sizeof(*sorted));
+	if (index->entries_len > 0 && !sorted) {
+		perror("calloc");
+		scanout_index_destroy(index);
+		return NULL;
+	}
+	size_t len = 0;
+	for (size_t i = 0; i < index->entries_cap; i++) {
+		if (index->entries[i].used) {
+			sorted[len++] = &index->entries[i];
+		}
+	}
+	qsort(sorted, len, sizeof(*sorted), entry_cmp);
+
+	struct json_object *arr = json_object_new_array();
+	for (size_t i = 0; i < len; i++) {
+		const struct scanout_entry *entry = sorted[i];
+		struct json_object *entry_obj = json_object_new_object();
+		json_object_object_add(entry_obj, "format",
+			json_object_new_uint64(entry->format));
+		json_object_object_add(entry_obj, "modifier",
+			json_object_new_uint64(entry->modifier));
+		json_object_object_add(entry_obj, "planes",
+			ids_arr(index->plane_ids, index->planes_len, entry->planes));
+		json_object_object_add(entry_obj, "crtcs",
+			ids_arr(index->crtc_ids, index->crtcs_len, entry->crtcs));
+		json_object_array_add(arr, entry_obj);
+	}
+
+	free(sorted);
+	scanout_index_destroy(index);
+	return arr;
+}
@@ -0,0 +1,52 @@
+#ifndef SCANOUT_H
+#define SCANOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct json_object;
+
+#define SCANOUT_MAX_PLANES 64
+#define SCANOUT_MAX_CRTCS 32
+
+/* Planes and CRTCs able to scan out a format/modifier pair, as bitmasks of
+ * plane and CRTC indices */
+struct scanout_entry {
+	uint32_t format;
+	uint64_t modifier;
+	uint64_t planes;
+	uint32_t crtcs;
+	bool used;
+};
+
+struct scanout_index {
+	struct scanout_entry *entries;
+	size_t entries_cap, entries_len;
+
+	uint32_t plane_ids[SCANOUT_MAX_PLANES];
+	uint32_t plane_crtcs[SCANOUT_MAX_PLANES];
+	size_t planes_len;
+	uint32_t crtc_ids[SCANOUT_MAX_CRTCS];
+	size_t crtcs_len;
+};
+
+/* Build an index from a node object as returned by drm_info(). Planes
+ * without IN_FORMATS are indexed with DRM_FORMAT_MOD_INVALID. */
+struct scanout_index *scanout_index_create(struct json_object *node_obj);
+void scanout_index_destroy(struct scanout_index *index);
+/* The index of a node object as a JSON array of {format, modifier, planes,
+ * crtcs} objects, with plane and CRTC IDs */
+struct json_object *scanout_index_info(struct json_object *node_obj);
+/* Fills entry with the planes and CRTCs supporting the format/modifier pair,
+ * returns false if there are none. LINEAR also matches planes indexed with
+ * DRM_FORMAT_MOD_INVALID, drivers without modifiers scan out LINEAR. */
+bool scanout_index_lookup(const struct scanout_index *index, uint32_t format,
+	uint64_t modifier, struct scanout_entry *entry);
+
+/* Parse a "FORMAT[:MODIFIER]" string, e.g. "NV12:0x0100000000000001" or
+ * "AR24:I915_FORMAT_MOD_X_TILED". The modifier defaults to LINEAR. */
+bool parse_format_modifier(const char *str, uint32_t *format,
+	uint64_t *modifier);
+
+#endif
@@ -0,0 +1,475 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <json_object.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+#include "edid.h"
+#include "pci_ids.h"
+
+/* Collects what the kernel exposes under /sys/class/drm without opening the
+ * device nodes, so that it never waits on the DRM master or a wedged GPU.
+ * Each directory is opened once and its attributes are read relative to it
+ * with a single read() each. */
+
+/* EDID is at most 256 blocks of 128 bytes */
+#define SYSFS_ATTR_MAX 32768
+
+static ssize_t read_attr(int dir_fd, const char *name, char *buf, size_t size)
+{
+	int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+
+	size_t len = 0;
+	while (len < size) {
+		ssize_t n = read(fd, buf + len, size - len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0) {
+			close(fd);
+			return -1;
+		} else if (n == 0) {
+			break;
+		}
+		len += n;
+	}
+	close(fd);
+	return len;
+}
+
+/* Reads a text attribute, without its trailing newline */
+static bool read_str_attr(int dir_fd, const char *name, char *buf, size_t size)
+{
+	ssize_t len = read_attr(dir_fd, name, buf, size - 1);
+	if (len < 0) {
+		return false;
+	}
+	while (len > 0 && buf[len - 1] == '\n') {
+		len--;
+	}
+	buf[len] = '\0';
+	return true;
+}
+
+static struct json_object *new_str_attr(int dir_fd, const char *name)
+{
+	char buf[256];
+	if (!read_str_attr(dir_fd, name, buf, sizeof(buf))) {
+		return NULL;
+	}
+	return json_object_new_string(buf);
+}
+
+static drmModeConnection connection_from_str(const char *str)
+{
+	if (strcmp(str, "connected") == 0) {
+		return DRM_MODE_CONNECTED;
+	} else if (strcmp(str, "disconnected") == 0) {
+		return DRM_MODE_DISCONNECTED;
+	}
+	return DRM_MODE_UNKNOWNCONNECTION;
+}
+
+static struct json_object *sysfs_connector_info(int class_fd, const char *name)
+{
+	int dir_fd = openat(class_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd < 0) {
+		perror(name);
+		return NULL;
+	}
+
+	struct json_object *obj = json_object_new_object();
+
+	/* "card0-DP-1" */
+	const char *conn_name = strchr(name, '-');
+	json_object_object_add(obj, "name",
+		json_object_new_string(conn_name ? conn_name + 1 : name));
+
+	char buf[256];
+	if (read_str_attr(dir_fd, "connector_id", buf, sizeof(buf))) {
+		json_object_object_add(obj, "id",
+			json_object_new_uint64(strtoul(buf, NULL, 10)));
+	}
+	if (read_str_attr(dir_fd, "status", buf, sizeof(buf))) {
+		json_object_object_add(obj, "status",
+			json_object_new_uint64(connection_from_str(buf)));
+	}
+	if (read_str_attr(dir_fd, "enabled", buf, sizeof(buf))) {
+		json_object_object_add(obj, "enabled",
+			json_object_new_boolean(strcmp(buf, "enabled") == 0));
+	}
+	json_object_object_add(obj, "dpms", new_str_attr(dir_fd, "dpms"));
+
+	char *data = malloc(SYSFS_ATTR_MAX);
+	if (!data) {
+		perror("malloc");
+		close(dir_fd);
+		return obj;
+	}
+
+	struct json_object *modes_arr = json_object_new_array();
+	ssize_t len = read_attr(dir_fd, "modes", data, SYSFS_ATTR_MAX - 1);
+	if (len > 0) {
+		data[len] = '\0';
+		char *saveptr;
+		for (char *mode = strtok_r(data, "\n", &saveptr); mode;
+				mode = strtok_r(NULL, "\n", &saveptr)) {
+			json_object_array_add(modes_arr, json_object_new_string(mode));
+		}
+	}
+	json_object_object_add(obj, "mode_names", modes_arr);
+
+	len = read_attr(dir_fd, "edid", data, SYSFS_ATTR_MAX);
+	json_object_object_add(obj, "edid_size",
+		json_object_new_uint64(len > 0 ? len : 0));
+	json_object_object_add(obj, "edid",
+		len > 0 ? edid_to_json((const uint8_t *)data, len) : NULL);
+
+	free(data);
+	close(dir_fd);
+	return obj;
+}
+
+static void add_hex_id(struct json_object *obj, const char *key,
+		const char *str)
+{
+	json_object_object_add(obj, key,
+		json_object_new_uint64(strtoul(str, NULL, 16)));
+}
+
+/* The device's uevent file carries the driver and bus IDs in one read */
+static struct json_object *sysfs_device_info(int card_fd,
+		struct json_object **driver_obj)
+{
+	char buf[4096];
+	int dev_fd = openat(card_fd, "device", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dev_fd < 0) {
+		return NULL;
+	}
+	bool ok = read_str_attr(dev_fd, "uevent", buf, sizeof(buf));
+	close(dev_fd);
+	if (!ok) {
+		return NULL;
+	}
+
+	struct json_object *obj = json_object_new_object();
+	struct json_object *data_obj = json_object_new_object();
+	struct json_object *compatible_arr = NULL;
+	int bus_type = -1;
+
+	char *saveptr;
+	for (char *line = strtok_r(buf, "\n", &saveptr); line;
+			line = strtok_r(NULL, "\n", &saveptr)) {
+		char *value = strchr(line, '=');
+		if (!value) {
+			continue;
+		}
+		*value++ = '\0';
+
+		if (strcmp(line, "DRIVER") == 0) {
+			*driver_obj = json_object_new_object();
+			json_object_object_add(*driver_obj, "name",
+				json_object_new_string(value));
+		} else if (strcmp(line, "PCI_ID") == 0) {
+			/* "8086:9A49" */
+			bus_type = DRM_BUS_PCI;
+			add_hex_id(data_obj, "vendor", value);
+			char *sep = strchr(value, ':');
+			if (sep) {
+				add_hex_id(data_obj, "device", sep + 1);
+			}
+		} else if (strcmp(line, "PCI_SUBSYS_ID") == 0) {
+			add_hex_id(data_obj, "subsystem_vendor", value);
+			char *sep = strchr(value, ':');
+			if (sep) {
+				add_hex_id(data_obj, "subsystem_device", sep + 1);
+			}
+		} else if (strncmp(line, "OF_COMPATIBLE_", 14) == 0 &&
+				strcmp(line, "OF_COMPATIBLE_N") != 0) {
+			if (bus_type < 0) {
+				bus_type = DRM_BUS_PLATFORM;
+			}
+			if (!compatible_arr) {
+				compatible_arr = json_object_new_array();
+			}
+			json_object_array_add(compatible_arr,
+				json_object_new_string(value));
+		}
+	}
+
+	if (bus_type == DRM_BUS_PCI) {
+		char vendor_name[256], device_name[256];
+		if (pci_ids_lookup(
+				json_object_get_uint64(json_object_object_get(data_obj, "vendor")),
+				json_object_get_uint64(json_object_object_get(data_obj, "device")),
+				vendor_name, sizeof(vendor_name),
+				device_name, sizeof(device_name))) {
+			json_object_object_add(data_obj, "vendor_name",
+				json_object_new_string(vendor_name));
+			if (device_name[0]) {
+				json_object_object_add(data_obj, "device_name",
+					json_object_new_string(device_name));
+			}
+		}
+	}
+	if (compatible_arr) {
+		json_object_object_add(data_obj, "compatible", compatible_arr);
+	}
+
+	json_object_object_add(obj, "bus_type", bus_type >= 0 ?
+		json_object_new_uint64(bus_type) : NULL);
+	json_object_object_add(obj, "device_data", data_obj);
+	return obj;
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+	const char *const *a_str = a, *const *b_str = b;
+	/* Sort card2 before card10 */
+	size_t a_len = strcspn(*a_str, "-"), b_len = strcspn(*b_str, "-");
+	if (a_len != b_len) {
+		return a_len < b_len ? -1 : 1;
+	}
+	return strcmp(*a_str, *b_str);
+}
+
+static bool is_card(const char *name, size_t len)
+{
+	if (len <= 4 || strncmp(name, "card", 4) != 0) {
+		return false;
+	}
+	for (size_t i = 4; i < len; i++) {
+		if (name[i] < '0' || name[i] > '9') {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool wanted(char *paths[], const char *card)
+{
+	if (!paths[0]) {
+		return true;
+	}
+	for (char **path = paths; *path; ++path) {
+		const char *base = strrchr(*path, '/');
+		if (strcmp(base ? base + 1 : *path, card) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* root is the sysfs mount point, e.g. "/sys". paths is a NULL terminated argv
+ * array, as with drm_info(). */
+struct json_object *sysfs_info(const char *root, char *paths[])
+{
+	char class_path[PATH_MAX];
+	snprintf(class_path, sizeof(class_path), "%s/class/drm", root);
+
+	DIR *dir = opendir(class_path);
+	if (!dir) {
+		perror(class_path);
+		return NULL;
+	}
+
+	char **names = NULL;
+	size_t names_len = 0, names_cap = 0;
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		if (strncmp(ent->d_name, "card", 4) != 0) {
+			continue;
+		}
+		if (names_len == names_cap) {
+			names_cap = names_cap ? 2 * names_cap : 32;
+			char **new_names = realloc(names, names_cap * sizeof(*names));
+			if (!new_names) {
+				perror("realloc");
+				break;
+			}
+			names = new_names;
+		}
+		char *name = strdup(ent->d_name);
+		if (!name) {
+			perror("strdup");
+			break;
+		}
+		names[names_len++] = name;
+	}
+	if (names_len > 0) {
+		qsort(names, names_len, sizeof(*names), name_cmp);
+	}
+
+	struct json_object *obj = json_object_new_object();
+	int class_fd = dirfd(dir);
+	for (size_t i = 0; i < names_len; i++) {
+		const char *card = names[i];
+		if (!is_card(card, strlen(card)) || !wanted(paths, card)) {
+			continue;
+		}
+
+		int card_fd = openat(class_fd, card,
+			O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (card_fd < 0) {
+			perror(card);
+			continue;
+		}
+
+		struct json_object *node_obj = json_object_new_object();
+		struct json_object *driver_obj = NULL;
+		struct json_object *device_obj = sysfs_device_info(card_fd, &driver_obj);
+		json_object_object_add(node_obj, "driver", driver_obj);
+		json_object_object_add(node_obj, "device", device_obj);
+		close(card_fd);
+
+		/* Connectors are siblings named "cardN-<connector>" and sort right
+		 * after their card */
+		struct json_object *conns_arr = json_object_new_array();
+		size_t card_len = strlen(card);
+		for (size_t j = i + 1; j < names_len; j++) {
+			if (strncmp(names[j], card, card_len) != 0 ||
+					names[j][card_len] != '-') {
+				break;
+			}
+			struct json_object *conn_obj =
+				sysfs_connector_info(class_fd, names[j]);
+			if (conn_obj) {
+				json_object_array_add(conns_arr, conn_obj);
+			}
+		}
+		json_object_object_add(node_obj, "connectors", conns_arr);
+
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "/dev/dri/%s", card);
+		json_object_object_add(obj, path, node_obj);
+	}
+
+	for (size_t i = 0; i < names_len; i++) {
+		free(names[i]);
+	}
+	free(names);
+	closedir(dir);
+	return obj;
+}
+
+static const char *status_str(drmModeConnection status)
+{
+	switch (status) {
+	case DRM_MODE_CONNECTED:
+		return "connected";
+	case DRM_MODE_DISCONNECTED:
+		return "disconnected";
+	default:
+		return "unknown";
+	}
+}
+
+static void print_sysfs_device(struct json_object *obj)
+{
+	struct json_object *data_obj = json_object_object_get(obj, "device_data");
+	struct json_object *bus_type_obj = json_object_object_get(obj, "bus_type");
+
+	printf(L_VAL "Device:");
+	if (bus_type_obj && json_object_get_uint64(bus_type_obj) == DRM_BUS_PCI) {
+		printf(" PCI %04"PRIx64":%04"PRIx64,
+			get_object_object_uint64(data_obj, "vendor"),
+			get_object_object_uint64(data_obj, "device"));
+		const char *vendor_name =
+			get_object_object_string(data_obj, "vendor_name");
+		const char *device_name =
+			get_object_object_string(data_obj, "device_name");
+		if (vendor_name) {
+			printf(" %s", vendor_name);
+		}
+		if (device_name) {
+			printf(" %s", device_name);
+		}
+	} else if (bus_type_obj) {
+		printf(" platform");
+		struct json_object *compatible_arr =
+			json_object_object_get(data_obj, "compatible");
+		for (size_t i = 0; i < json_object_array_length(compatible_arr); i++) {
+			printf(" %s", json_object_get_string(
+				json_object_array_get_idx(compatible_arr, i)));
+		}
+	} else {
+		printf(" unknown");
+	}
+	printf("\n");
+}
+
+static void print_sysfs_connector(struct json_object *obj, bool last)
+{
+	const char *prefix = last ? L_GAP : L_LINE;
+	printf(L_GAP "%s%s", last ? L_LAST : L_VAL,
+		get_object_object_string(obj, "name"));
+	if (json_object_object_get(obj, "id")) {
+		printf(" (id %"PRIu64")", get_object_object_uint64(obj, "id"));
+	}
+	printf("\n");
+
+	printf(L_GAP "%s" L_VAL "Status: %s\n", prefix,
+		status_str(get_object_object_uint64(obj, "status")));
+	struct json_object *enabled_obj = json_object_object_get(obj, "enabled");
+	if (enabled_obj) {
+		printf(L_GAP "%s" L_VAL "Enabled: %s\n", prefix,
+			json_object_get_boolean(enabled_obj) ? "yes" : "no");
+	}
+	const char *dpms = get_object_object_string(obj, "dpms");
+	if (dpms) {
+		printf(L_GAP "%s" L_VAL "DPMS: %s\n", prefix, dpms);
+	}
+	printf(L_GAP "%s" L_VAL "EDID: %"PRIu64" bytes\n", prefix,
+		get_object_object_uint64(obj, "edid_size"));
+	struct json_object *edid_obj = json_object_object_get(obj, "edid");
+	if (edid_obj) {
+		char sub_prefix[strlen(L_GAP) + strlen(prefix) + strlen(L_LINE) + 1];
+		snprintf(sub_prefix, sizeof(sub_prefix), L_GAP "%s" L_LINE, prefix);
+		print_edid(edid_obj, sub_prefix);
+	}
+
+	struct json_object *modes_arr = json_object_object_get(obj, "mode_names");
+	printf(L_GAP "%s" L_LAST "Modes:", prefix);
+	for (size_t i = 0; i < json_object_array_length(modes_arr); i++) {
+		printf("%s %s", i == 0 ? "" : ",", json_object_get_string(
+			json_object_array_get_idx(modes_arr, i)));
+	}
+	if (json_object_array_length(modes_arr) == 0) {
+		printf(" none");
+	}
+	printf("\n");
+}
+
+void print_sysfs(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, node_obj) {
+		printf("Node: %s\n", path);
+
+		struct json_object *driver_obj =
+			json_object_object_get(node_obj, "driver");
+		const char *driver = get_object_object_string(driver_obj, "name");
+		printf(L_VAL "Driver: %s\n", driver ? driver : "unknown");
+		print_sysfs_device(json_object_object_get(node_obj, "device"));
+
+		struct json_object *conns_arr =
+			json_object_object_get(node_obj, "connectors");
+		size_t conns_len = json_object_array_length(conns_arr);
+		printf(L_LAST "Connectors\n");
+		for (size_t i = 0; i < conns_len; i++) {
+			print_sysfs_connector(json_object_array_get_idx(conns_arr, i),
+				i == conns_len - 1);
+		}
+	}
+}
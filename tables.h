@@ -1,11 +1,60 @@
 #ifndef TABLES_H
 #define TABLES_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* A named value of a modifier bitfield, e.g. GFX9 for AMD's TILE_VERSION */
+struct modifier_value {
+	const char *name;
+	uint64_t value;
+};
+
+/* A bitfield in the vendor-specific part of a modifier */
+struct modifier_field {
+	const char *name;
+	uint8_t shift;
+	uint64_t mask;
+	const struct modifier_value *values;
+	size_t values_len;
+};
+
+struct modifier_vendor {
+	const char *name; /* NULL if the vendor is unknown */
+	/* Name of the parameterized layout, used when the modifier stripped of
+	 * its fields is layout_bits rather than a well-known constant */
+	const char *layout;
+	uint64_t layout_bits;
+	const struct modifier_field *fields;
+	size_t fields_len;
+	uint64_t fields_mask; /* all fields, shifted in place */
+};
+
+/* Memory layout of a format, as in the kernel's struct drm_format_info.
+ * Pitches cover one row of pixels, and chroma planes are subsampled by hsub
+ * and vsub. */
+struct format_info {
+	uint32_t format;
+	uint8_t planes;
+	uint8_t bytes_per_block[3];
+	uint8_t block_w[3], block_h[3]; /* in pixels */
+	uint8_t hsub, vsub;
+};
+
 /* The implementation of these functions are generated by fourcc.py */
 
 const char *format_str(uint32_t format);
+/* Returns DRM_FORMAT_INVALID if the name is unknown */
+uint32_t format_from_str(const char *name);
+/* Returns NULL if the layout of the format is unknown */
+const struct format_info *format_info(uint32_t format);
+/* Returns NULL if the modifier isn't a well-known constant */
 const char *basic_modifier_str(uint64_t modifier);
+/* Returns DRM_FORMAT_MOD_INVALID if the name is unknown */
+uint64_t modifier_from_str(const char *name);
+/* Walks the well-known modifier constants, returns false past the last */
+bool modifier_constant(size_t i, const char **name, uint64_t *modifier);
+const struct modifier_vendor *modifier_vendor(uint8_t vendor);
 
 #endif
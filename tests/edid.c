@@ -0,0 +1,243 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "edid.h"
+
+/* Parses the EDIDs in tests/edid/ and checks the ranges and detailed
+ * timings they decode to. With --bench, times edid_parse() instead. */
+
+#define MAX_EDID_SIZE 1024
+#define BENCH_ITERATIONS 100000
+
+struct expected_timing {
+	enum edid_timing_source source;
+	uint32_t pixel_clock_khz;
+	uint16_t hdisplay, hsync_start, hsync_end, htotal;
+	uint16_t vdisplay, vsync_start, vsync_end, vtotal;
+};
+
+struct fixture {
+	const char *file;
+	const char *name;
+	struct edid_range range;
+	struct edid_range cta_vrr;
+	struct edid_range displayid_range;
+	struct expected_timing timings[4];
+	size_t timings_len;
+};
+
+static const struct fixture fixtures[] = {
+	{
+		/* VRR range in HF-VSDB payload bytes 8 and 9, above 255 Hz */
+		.file = "hdmi-hf-vsdb.bin",
+		.name = "DRM HDMI 360",
+		.range = {
+			.present = true,
+			.min_vrefresh = 48, .max_vrefresh = 360,
+			.min_hfreq = 30, .max_hfreq = 510,
+			.max_pixel_clock = 600,
+		},
+		.cta_vrr = {
+			.present = true,
+			.min_vrefresh = 48, .max_vrefresh = 360,
+		},
+		.timings = {
+			{ EDID_TIMING_BASE, 241500,
+				2560, 2608, 2640, 2720, 1440, 1443, 1448, 1481 },
+			{ EDID_TIMING_CTA, 148500,
+				1920, 2008, 2052, 2200, 1080, 1084, 1089, 1125 },
+		},
+		.timings_len = 2,
+	},
+	{
+		/* Type I timing and video timing range limits */
+		.file = "displayid-1.3.bin",
+		.name = "DRM DID 1.3",
+		.displayid_range = {
+			.present = true,
+			.min_vrefresh = 48, .max_vrefresh = 144,
+			.min_hfreq = 30, .max_hfreq = 255,
+			.max_pixel_clock = 1254,
+		},
+		.timings = {
+			{ EDID_TIMING_BASE, 533250,
+				3840, 3888, 3920, 4000, 2160, 2163, 2168, 2222 },
+			{ EDID_TIMING_DISPLAYID, 1253940,
+				3840, 3848, 3880, 3920, 2160, 2163, 2168, 2222 },
+		},
+		.timings_len = 2,
+	},
+	{
+		/* Type VII timing and dynamic range limits above 255 Hz */
+		.file = "displayid-2.0.bin",
+		.name = "DRM DID 2.0",
+		.displayid_range = {
+			.present = true,
+			.min_vrefresh = 48, .max_vrefresh = 480,
+			.max_pixel_clock = 1926,
+		},
+		.timings = {
+			{ EDID_TIMING_BASE, 241500,
+				2560, 2608, 2640, 2720, 1440, 1443, 1448, 1481 },
+			{ EDID_TIMING_DISPLAYID, 1926144,
+				2560, 2568, 2600, 2640, 1440, 1443, 1449, 1520 },
+		},
+		.timings_len = 2,
+	},
+};
+
+#define FIXTURES (sizeof(fixtures) / sizeof(fixtures[0]))
+
+static size_t read_fixture(const char *dir, const char *file, uint8_t *data)
+{
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/%s", dir, file);
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	size_t len = fread(data, 1, MAX_EDID_SIZE, f);
+	fclose(f);
+	return len;
+}
+
+static bool check_range(const char *file, const char *what,
+		const struct edid_range *got, const struct edid_range *want)
+{
+	if (got->present == want->present &&
+			got->min_vrefresh == want->min_vrefresh &&
+			got->max_vrefresh == want->max_vrefresh &&
+			got->min_hfreq == want->min_hfreq &&
+			got->max_hfreq == want->max_hfreq &&
+			got->max_pixel_clock == want->max_pixel_clock) {
+		return true;
+	}
+	fprintf(stderr, "%s: %s is %s%"PRIu16"-%"PRIu16" Hz, %"PRIu16"-%"PRIu16
+		" kHz, %"PRIu16" MHz, expected %s%"PRIu16"-%"PRIu16" Hz, "
+		"%"PRIu16"-%"PRIu16" kHz, %"PRIu16" MHz\n", file, what,
+		got->present ? "" : "absent ", got->min_vrefresh, got->max_vrefresh,
+		got->min_hfreq, got->max_hfreq, got->max_pixel_clock,
+		want->present ? "" : "absent ", want->min_vrefresh,
+		want->max_vrefresh, want->min_hfreq, want->max_hfreq,
+		want->max_pixel_clock);
+	return false;
+}
+
+static bool check_timing(const char *file, size_t i,
+		const struct edid_timing *got, const struct expected_timing *want)
+{
+	if (got->source == want->source &&
+			got->pixel_clock_khz == want->pixel_clock_khz &&
+			got->hdisplay == want->hdisplay &&
+			got->hsync_start == want->hsync_start &&
+			got->hsync_end == want->hsync_end &&
+			got->htotal == want->htotal &&
+			got->vdisplay == want->vdisplay &&
+			got->vsync_start == want->vsync_start &&
+			got->vsync_end == want->vsync_end &&
+			got->vtotal == want->vtotal) {
+		return true;
+	}
+	fprintf(stderr, "%s: timing %zu is %"PRIu32" kHz %"PRIu16" %"PRIu16
+		" %"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16
+		" from block type %d, expected %"PRIu32" kHz %"PRIu16" %"PRIu16
+		" %"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16
+		" from block type %d\n", file, i,
+		got->pixel_clock_khz, got->hdisplay, got->hsync_start,
+		got->hsync_end, got->htotal, got->vdisplay, got->vsync_start,
+		got->vsync_end, got->vtotal, (int)got->source,
+		want->pixel_clock_khz, want->hdisplay, want->hsync_start,
+		want->hsync_end, want->htotal, want->vdisplay, want->vsync_start,
+		want->vsync_end, want->vtotal, (int)want->source);
+	return false;
+}
+
+static bool check_fixture(const struct fixture *fixture, const uint8_t *data,
+		size_t len)
+{
+	const char *file = fixture->file;
+	struct edid edid;
+	if (!edid_parse(&edid, data, len)) {
+		fprintf(stderr, "%s: not parsed as an EDID\n", file);
+		return false;
+	}
+
+	bool ok = true;
+	if (!edid.checksum_valid) {
+		fprintf(stderr, "%s: invalid checksum\n", file);
+		ok = false;
+	}
+	if (edid.name_len != strlen(fixture->name) ||
+			memcmp(edid.name, fixture->name, edid.name_len) != 0) {
+		fprintf(stderr, "%s: name is \"%.*s\", expected \"%s\"\n", file,
+			(int)edid.name_len, edid.name, fixture->name);
+		ok = false;
+	}
+	ok &= check_range(file, "range", &edid.range, &fixture->range);
+	ok &= check_range(file, "CTA VRR range", &edid.cta.vrr, &fixture->cta_vrr);
+	ok &= check_range(file, "DisplayID range", &edid.displayid.range,
+		&fixture->displayid_range);
+
+	if (edid.timings_len != fixture->timings_len) {
+		fprintf(stderr, "%s: %zu timings, expected %zu\n", file,
+			edid.timings_len, fixture->timings_len);
+		return false;
+	}
+	for (size_t i = 0; i < edid.timings_len; i++) {
+		ok &= check_timing(file, i, &edid.timings[i], &fixture->timings[i]);
+	}
+	return ok;
+}
+
+static void bench_fixture(const struct fixture *fixture, const uint8_t *data,
+		size_t len)
+{
+	struct timespec start, end;
+	struct edid edid;
+	size_t timings = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < BENCH_ITERATIONS; i++) {
+		edid_parse(&edid, data, len);
+		timings += edid.timings_len;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double ns = (end.tv_sec - start.tv_sec) * 1e9 +
+		(end.tv_nsec - start.tv_nsec);
+	printf("%s: %.0f ns per parse, %zu timings\n", fixture->file,
+		ns / BENCH_ITERATIONS, timings / BENCH_ITERATIONS);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: test_edid <fixtures dir> [--bench]\n");
+		return EXIT_FAILURE;
+	}
+	bool bench = argc > 2 && strcmp(argv[2], "--bench") == 0;
+
+	bool ok = true;
+	for (size_t i = 0; i < FIXTURES; i++) {
+		uint8_t data[MAX_EDID_SIZE];
+		size_t len = read_fixture(argv[1], fixtures[i].file, data);
+		if (len == 0) {
+			ok = false;
+			continue;
+		}
+		if (bench) {
+			bench_fixture(&fixtures[i], data, len);
+		} else {
+			ok &= check_fixture(&fixtures[i], data, len);
+		}
+	}
+
+	if (!bench) {
+		printf("%zu EDIDs checked\n", FIXTURES);
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
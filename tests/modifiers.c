@@ -0,0 +1,99 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <drm_fourcc.h>
+
+#include "modifiers.h"
+#include "tables.h"
+
+/* Every modifier drm_fourcc.h defines, and every field of its
+ * parameterized layouts, must decode to a name. A few representative ones
+ * must decode to exactly the expected string. */
+
+struct expected_str {
+	uint64_t mod;
+	const char *str;
+};
+
+static const struct expected_str expected_strs[] = {
+	{ DRM_FORMAT_MOD_LINEAR, "DRM_FORMAT_MOD_LINEAR" },
+	{ I915_FORMAT_MOD_Y_TILED_CCS, "I915_FORMAT_MOD_Y_TILED_CCS" },
+	{
+		DRM_FORMAT_MOD_ARM_AFBC(AFBC_FORMAT_MOD_BLOCK_SIZE_32x8 |
+			AFBC_FORMAT_MOD_YTR | AFBC_FORMAT_MOD_SPLIT |
+			AFBC_FORMAT_MOD_SPARSE),
+		"ARM_AFBC(BLOCK_SIZE = 32x8, YTR, SPLIT, SPARSE)",
+	},
+	{
+		DRM_FORMAT_MOD_NVIDIA_BLOCK_LINEAR_2D(1, 1, 2, 0xfe, 4),
+		"DRM_FORMAT_MOD_NVIDIA_BLOCK_LINEAR_2D(H = 4, K = 254, G = 2, S, C = 1)",
+	},
+};
+
+#define EXPECTED_STRS (sizeof(expected_strs) / sizeof(expected_strs[0]))
+
+static bool check(uint64_t mod, const char *what)
+{
+	char *str = modifier_str(mod);
+	bool ok = str && !strstr(str, "unknown");
+	if (!ok) {
+		fprintf(stderr, "%s (0x%"PRIx64") decodes to %s\n", what, mod,
+			str ? str : "NULL");
+	}
+	free(str);
+	return ok;
+}
+
+static bool check_str(const struct expected_str *expected)
+{
+	char *str = modifier_str(expected->mod);
+	bool ok = str && strcmp(str, expected->str) == 0;
+	if (!ok) {
+		fprintf(stderr, "0x%"PRIx64" decodes to %s, expected %s\n",
+			expected->mod, str ? str : "NULL", expected->str);
+	}
+	free(str);
+	return ok;
+}
+
+int main(void)
+{
+	bool ok = true;
+	size_t checked = 0;
+
+	const char *name;
+	uint64_t mod;
+	for (size_t i = 0; modifier_constant(i, &name, &mod); i++) {
+		ok &= check(mod, name);
+		checked++;
+	}
+
+	for (unsigned v = 0; v < 256; v++) {
+		const struct modifier_vendor *vendor = modifier_vendor(v);
+		uint64_t layout = ((uint64_t)v << 56) | vendor->layout_bits;
+		for (size_t i = 0; i < vendor->fields_len; i++) {
+			const struct modifier_field *field = &vendor->fields[i];
+			if (field->values_len == 0) {
+				ok &= check(layout | (1ULL << field->shift), field->name);
+				checked++;
+			}
+			for (size_t j = 0; j < field->values_len; j++) {
+				ok &= check(layout |
+					(field->values[j].value << field->shift),
+					field->values[j].name);
+				checked++;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < EXPECTED_STRS; i++) {
+		ok &= check_str(&expected_strs[i]);
+		checked++;
+	}
+
+	printf("%zu modifiers checked\n", checked);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Runs drm_info and checks that every line of the expected file appears in
+# its output. Lines depending on the host, such as PCI ID names or timings,
+# are left out of the expected files.
+# usage: run.sh <expected> <drm_info> [args]...
+
+expected="$1"
+shift
+out="$("$@")" || exit 1
+
+status=0
+while IFS= read -r line; do
+	if ! printf '%s\n' "$out" | grep -qxF -e "$line"; then
+		echo "missing: $line" >&2
+		status=1
+	fi
+done < "$expected"
+if [ "$status" != 0 ]; then
+	printf '%s\n' "$out" >&2
+fi
+exit "$status"
@@ -0,0 +1,549 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json_object.h>
+
+#include "drm_info.h"
+
+/* The DRM vblank tracepoints identify CRTCs by their index, which is also
+ * their position in the "crtcs" array of a dump. Lines of trace_pipe look
+ * like this:
+ *
+ *   <idle>-0 [002] d.h1. 1234.567890: drm_vblank_event: crtc=0, seq=42, ...
+ *   Xorg-614 [001] ..... 1234.560000: drm_vblank_event_queued: file=..., crtc=0, seq=42
+ *   <idle>-0 [002] d.h1. 1234.567880: drm_vblank_event_delivered: file=..., crtc=0, seq=42
+ *
+ * drm_vblank_event_queued carries the sequence number the client asked
+ * for, drm_vblank_event_delivered the vblank count when the event was
+ * sent, which is later than requested if the vblank interrupt for the
+ * requested one was missed. A client's events on a CRTC are matched first
+ * in, first out, and an event delivered later than requested missed the
+ * difference.
+ *
+ * Lines are parsed in place from a fixed buffer: after the state below is
+ * allocated, reading the trace doesn't allocate. */
+
+static const char *const tracefs_paths[] = {
+	"/sys/kernel/tracing",
+	"/sys/kernel/debug/tracing",
+};
+
+static const char *const trace_events[] = {
+	"drm_vblank_event",
+	"drm_vblank_event_queued",
+	"drm_vblank_event_delivered",
+};
+
+#define TRACE_MAX_CRTCS 32
+/* Files with events queued on a CRTC */
+#define TRACE_STREAM_BITS 8
+#define TRACE_STREAM_SIZE (1 << TRACE_STREAM_BITS)
+/* Events a file can have queued on a CRTC */
+#define TRACE_STREAM_DEPTH 16
+/* Bucket i counts latencies below 2^i us, the last one everything above */
+#define TRACE_HIST_BUCKETS 26
+#define TRACE_LINE_MAX 4096
+
+struct trace_crtc {
+	bool seen;
+	uint64_t vblanks, queued, delivered, late, missed;
+	uint64_t hist[TRACE_HIST_BUCKETS];
+};
+
+struct trace_queued {
+	uint32_t seq;
+	uint64_t ts_us;
+};
+
+/* Events queued by one file on one CRTC, oldest first */
+struct trace_stream {
+	bool used;
+	uint8_t crtc;
+	uint64_t file;
+	struct trace_queued queued[TRACE_STREAM_DEPTH];
+	size_t head, len;
+};
+
+struct trace_state {
+	struct trace_crtc crtcs[TRACE_MAX_CRTCS];
+	struct trace_stream streams[TRACE_STREAM_SIZE];
+	size_t streams_len;
+	uint64_t unmatched, dropped;
+	char buf[TRACE_LINE_MAX];
+	size_t buf_len;
+};
+
+/* Streams are never removed: files are few and keep queueing events */
+static struct trace_stream *find_stream(struct trace_state *state,
+		uint64_t file, uint8_t crtc, bool create)
+{
+	uint64_t h = file ^ (uint64_t)crtc << 32;
+	h *= 0x9E3779B97F4A7C15ULL;
+	size_t i = h >> (64 - TRACE_STREAM_BITS);
+	while (state->streams[i].used) {
+		struct trace_stream *s = &state->streams[i];
+		if (s->file == file && s->crtc == crtc) {
+			return s;
+		}
+		i = (i + 1) % TRACE_STREAM_SIZE;
+	}
+	if (!create || 4 * (state->streams_len + 1) > 3 * TRACE_STREAM_SIZE) {
+		return NULL;
+	}
+	state->streams_len++;
+	state->streams[i] = (struct trace_stream){
+		.used = true,
+		.crtc = crtc,
+		.file = file,
+	};
+	return &state->streams[i];
+}
+
+static const char *find_arg(const char *args, const char *end,
+		const char *key)
+{
+	size_t key_len = strlen(key);
+	for (const char *p = args; p + key_len <= end; p++) {
+		if ((p == args || p[-1] == ' ') && memcmp(p, key, key_len) == 0) {
+			return p + key_len;
+		}
+	}
+	return NULL;
+}
+
+static bool parse_uint(const char *p, const char *end, int base,
+		uint64_t *val)
+{
+	*val = 0;
+	const char *start = p;
+	for (; p < end; p++) {
+		int digit;
+		if (*p >= '0' && *p <= '9') {
+			digit = *p - '0';
+		} else if (base == 16 && *p >= 'a' && *p <= 'f') {
+			digit = *p - 'a' + 10;
+		} else {
+			break;
+		}
+		*val = *val * base + digit;
+	}
+	return p > start;
+}
+
+/* The timestamp precedes the event name, e.g. "1234.567890: " */
+static bool parse_timestamp(const char *line, const char *event,
+		uint64_t *ts_us)
+{
+	const char *end = event - 2;
+	const char *p = end;
+	while (p > line && p[-1] != ' ') {
+		p--;
+	}
+
+	uint64_t sec, frac = 0;
+	const char *dot = memchr(p, '.', end - p);
+	if (!dot || !parse_uint(p, dot, 10, &sec)) {
+		return false;
+	}
+	/* Only keep microseconds, whatever the clock's precision */
+	size_t digits = 0;
+	for (const char *q = dot + 1; q < end && digits < 6; q++, digits++) {
+		frac = frac * 10 + (*q - '0');
+	}
+	for (; digits < 6; digits++) {
+		frac *= 10;
+	}
+	*ts_us = sec * 1000000 + frac;
+	return true;
+}
+
+static size_t hist_bucket(uint64_t us)
+{
+	size_t i = 0;
+	while (i < TRACE_HIST_BUCKETS - 1 && us >= (1ULL << i)) {
+		i++;
+	}
+	return i;
+}
+
+static void handle_line(struct trace_state *state, const char *line,
+		const char *end)
+{
+	/* Look for ": drm_vblank_event" followed by ":" or "_queued:"... */
+	static const char marker[] = ": drm_vblank_event";
+	const char *event = NULL;
+	for (const char *p = line; p + sizeof(marker) - 1 <= end; p++) {
+		if (memcmp(p, marker, sizeof(marker) - 1) == 0) {
+			event = p + 2;
+			break;
+		}
+	}
+	if (!event) {
+		return;
+	}
+
+	const char *name_end = event + strlen("drm_vblank_event");
+	const char *args = memchr(name_end, ':', end - name_end);
+	if (!args) {
+		return;
+	}
+	size_t suffix_len = args - name_end;
+	args++;
+
+	uint64_t crtc, seq, ts_us;
+	const char *crtc_str = find_arg(args, end, "crtc=");
+	const char *seq_str = find_arg(args, end, "seq=");
+	if (!crtc_str || !seq_str || !parse_uint(crtc_str, end, 10, &crtc) ||
+			!parse_uint(seq_str, end, 10, &seq) ||
+			!parse_timestamp(line, event, &ts_us) ||
+			crtc >= TRACE_MAX_CRTCS) {
+		return;
+	}
+
+	struct trace_crtc *c = &state->crtcs[crtc];
+	c->seen = true;
+
+	if (suffix_len == 0) {
+		c->vblanks++;
+		return;
+	}
+
+	uint64_t file = 0;
+	const char *file_str = find_arg(args, end, "file=");
+	if (file_str) {
+		parse_uint(file_str, end, 16, &file);
+	}
+
+	if (suffix_len == strlen("_queued") &&
+			memcmp(name_end, "_queued", suffix_len) == 0) {
+		c->queued++;
+		struct trace_stream *s = find_stream(state, file, crtc, true);
+		if (!s || s->len == TRACE_STREAM_DEPTH) {
+			state->dropped++;
+			return;
+		}
+		s->queued[(s->head + s->len++) % TRACE_STREAM_DEPTH] =
+			(struct trace_queued){ .seq = seq, .ts_us = ts_us };
+	} else if (suffix_len == strlen("_delivered") &&
+			memcmp(name_end, "_delivered", suffix_len) == 0) {
+		c->delivered++;
+		struct trace_stream *s = find_stream(state, file, crtc, false);
+		if (!s || s->len == 0) {
+			state->unmatched++;
+			return;
+		}
+		struct trace_queued *q = &s->queued[s->head];
+		s->head = (s->head + 1) % TRACE_STREAM_DEPTH;
+		s->len--;
+
+		/* Sequence numbers are 32 bits and wrap. Events are also
+		 * delivered early when the CRTC is disabled. */
+		uint32_t missed = (uint32_t)seq - q->seq;
+		if (missed > 0 && missed < UINT32_MAX / 2) {
+			c->late++;
+			c->missed += missed;
+		}
+		uint64_t latency = ts_us >= q->ts_us ? ts_us - q->ts_us : 0;
+		c->hist[hist_bucket(latency)]++;
+	}
+}
+
+/* Feeds whole lines to handle_line(), keeping a partial last line for the
+ * next read. Overlong lines are dropped. */
+static bool read_lines(struct trace_state *state, int fd)
+{
+	ssize_t n = read(fd, state->buf + state->buf_len,
+		sizeof(state->buf) - state->buf_len);
+	if (n <= 0) {
+		return false;
+	}
+	state->buf_len += n;
+
+	char *line = state->buf;
+	char *buf_end = state->buf + state->buf_len;
+	char *nl;
+	while ((nl = memchr(line, '\n', buf_end - line))) {
+		handle_line(state, line, nl);
+		line = nl + 1;
+	}
+
+	state->buf_len = buf_end - line;
+	if (state->buf_len == sizeof(state->buf)) {
+		state->buf_len = 0;
+	} else {
+		memmove(state->buf, line, state->buf_len);
+	}
+	return true;
+}
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Sets the enable file of each event, returns the previous values */
+static bool enable_events(const char *tracefs, const char *values,
+		char old_values[])
+{
+	for (size_t i = 0; i < sizeof(trace_events) / sizeof(trace_events[0]); i++) {
+		char path[256];
+		snprintf(path, sizeof(path), "%s/events/drm/%s/enable", tracefs,
+			trace_events[i]);
+
+		int fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd < 0) {
+			fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+			return false;
+		}
+		char old = '0';
+		if (old_values && read(fd, &old, 1) == 1) {
+			old_values[i] = old;
+		}
+		if (pwrite(fd, &values[i], 1, 0) != 1) {
+			fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+			close(fd);
+			return false;
+		}
+		close(fd);
+	}
+	return true;
+}
+
+static bool record_live(struct trace_state *state, unsigned seconds)
+{
+	char tracefs[64] = "";
+	for (size_t i = 0; i < sizeof(tracefs_paths) / sizeof(tracefs_paths[0]); i++) {
+		if (access(tracefs_paths[i], W_OK) == 0) {
+			snprintf(tracefs, sizeof(tracefs), "%s", tracefs_paths[i]);
+			break;
+		}
+	}
+	if (tracefs[0] == '\0') {
+		fprintf(stderr, "tracefs is not mounted or not writable\n");
+		return false;
+	}
+
+	char old_values[] = "000";
+	if (!enable_events(tracefs, "111", old_values)) {
+		return false;
+	}
+
+	char path[128];
+	snprintf(path, sizeof(path), "%s/trace_pipe", tracefs);
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		enable_events(tracefs, old_values, NULL);
+		return false;
+	}
+
+	uint64_t deadline = now_ms() + 1000 * (uint64_t)seconds;
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	while (true) {
+		uint64_t now = now_ms();
+		if (now >= deadline) {
+			break;
+		}
+		int ret = poll(&pfd, 1, deadline - now);
+		if (ret < 0 && errno != EINTR) {
+			perror("poll");
+			break;
+		}
+		if (ret > 0 && !read_lines(state, fd)) {
+			break;
+		}
+	}
+
+	close(fd);
+	enable_events(tracefs, old_values, NULL);
+	return true;
+}
+
+static bool record_file(struct trace_state *state, const char *path)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	while (read_lines(state, fd)) {
+		continue;
+	}
+	/* A recorded trace may not end with a newline */
+	if (state->buf_len > 0) {
+		handle_line(state, state->buf, state->buf + state->buf_len);
+	}
+	close(fd);
+	return true;
+}
+
+static struct json_object *crtc_stats(const struct trace_crtc *c,
+		size_t index, struct json_object *crtcs_arr)
+{
+	struct json_object *obj = json_object_new_object();
+	struct json_object *crtc_obj = index < json_object_array_length(crtcs_arr) ?
+		json_object_array_get_idx(crtcs_arr, index) : NULL;
+	json_object_object_add(obj, "id", crtc_obj ? json_object_new_uint64(
+		get_object_object_uint64(crtc_obj, "id")) : NULL);
+	json_object_object_add(obj, "index", json_object_new_uint64(index));
+	json_object_object_add(obj, "vblanks", json_object_new_uint64(c->vblanks));
+	json_object_object_add(obj, "events_queued",
+		json_object_new_uint64(c->queued));
+	json_object_object_add(obj, "events_delivered",
+		json_object_new_uint64(c->delivered));
+	json_object_object_add(obj, "events_late", json_object_new_uint64(c->late));
+	json_object_object_add(obj, "missed", json_object_new_uint64(c->missed));
+
+	struct json_object *hist_arr = json_object_new_array();
+	for (size_t i = 0; i < TRACE_HIST_BUCKETS; i++) {
+		if (c->hist[i] == 0) {
+			continue;
+		}
+		struct json_object *bucket_obj = json_object_new_object();
+		json_object_object_add(bucket_obj, "below_us",
+			i < TRACE_HIST_BUCKETS - 1 ? json_object_new_uint64(1ULL << i) : NULL);
+		json_object_object_add(bucket_obj, "count",
+			json_object_new_uint64(c->hist[i]));
+		json_object_array_add(hist_arr, bucket_obj);
+	}
+	json_object_object_add(obj, "latency_histogram", hist_arr);
+	return obj;
+}
+
+struct json_object *trace_info(struct json_object *drm_obj, const char *path,
+		unsigned seconds)
+{
+	/* Tracepoints don't say which device a CRTC index belongs to */
+	const char *dev_path = NULL;
+	struct json_object *crtcs_arr = NULL;
+	json_object_object_foreach(drm_obj, key, dev_obj) {
+		if (dev_path) {
+			fprintf(stderr, "Mapping trace CRTC indices to %s only\n", dev_path);
+			break;
+		}
+		dev_path = key;
+		crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+	}
+
+	struct trace_state *state = calloc(1, sizeof(*state));
+	if (!state) {
+		perror("calloc");
+		return NULL;
+	}
+
+	bool ok = path ? record_file(state, path) : record_live(state, seconds);
+	if (!ok) {
+		free(state);
+		return NULL;
+	}
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "device",
+		dev_path ? json_object_new_string(dev_path) : NULL);
+	json_object_object_add(obj, "source", json_object_new_string(
+		path ? path : "trace_pipe"));
+	struct json_object *stats_arr = json_object_new_array();
+	for (size_t i = 0; i < TRACE_MAX_CRTCS; i++) {
+		if (state->crtcs[i].seen) {
+			json_object_array_add(stats_arr,
+				crtc_stats(&state->crtcs[i], i, crtcs_arr));
+		}
+	}
+	json_object_object_add(obj, "crtcs", stats_arr);
+	json_object_object_add(obj, "unmatched",
+		json_object_new_uint64(state->unmatched));
+	json_object_object_add(obj, "dropped",
+		json_object_new_uint64(state->dropped));
+
+	free(state);
+	return obj;
+}
+
+static void print_latency(uint64_t us)
+{
+	if (us >= 1000000) {
+		printf("%"PRIu64" s", us / 1000000);
+	} else if (us >= 1000) {
+		printf("%"PRIu64" ms", us / 1000);
+	} else {
+		printf("%"PRIu64" us", us);
+	}
+}
+
+static void print_crtc_stats(struct json_object *obj, const char *prefix)
+{
+	printf("%s" L_VAL "Vblanks: %"PRIu64", missed: %"PRIu64"\n", prefix,
+		get_object_object_uint64(obj, "vblanks"),
+		get_object_object_uint64(obj, "missed"));
+	printf("%s" L_VAL "Events: %"PRIu64" queued, %"PRIu64" delivered, "
+		"%"PRIu64" late\n", prefix,
+		get_object_object_uint64(obj, "events_queued"),
+		get_object_object_uint64(obj, "events_delivered"),
+		get_object_object_uint64(obj, "events_late"));
+
+	struct json_object *hist_arr =
+		json_object_object_get(obj, "latency_histogram");
+	size_t hist_len = json_object_array_length(hist_arr);
+	printf("%s" L_LAST "Delivery latency:%s\n", prefix,
+		hist_len == 0 ? " no matched events" : "");
+	for (size_t i = 0; i < hist_len; i++) {
+		struct json_object *bucket_obj = json_object_array_get_idx(hist_arr, i);
+		printf("%s" L_GAP "%s", prefix, i == hist_len - 1 ? L_LAST : L_VAL);
+		if (json_object_object_get(bucket_obj, "below_us")) {
+			printf("< ");
+			print_latency(get_object_object_uint64(bucket_obj, "below_us"));
+		} else {
+			printf("longer");
+		}
+		printf(": %"PRIu64"\n", get_object_object_uint64(bucket_obj, "count"));
+	}
+}
+
+void print_trace(struct json_object *obj)
+{
+	struct json_object *device_obj = json_object_object_get(obj, "device");
+	printf("Trace: %s", json_object_get_string(
+		json_object_object_get(obj, "source")));
+	if (device_obj) {
+		printf(" (CRTCs of %s)", json_object_get_string(device_obj));
+	}
+	printf("\n");
+
+	uint64_t unmatched = get_object_object_uint64(obj, "unmatched");
+	uint64_t dropped = get_object_object_uint64(obj, "dropped");
+	if (unmatched || dropped) {
+		printf(L_VAL "Unmatched deliveries: %"PRIu64", dropped events: %"PRIu64
+			"\n", unmatched, dropped);
+	}
+
+	struct json_object *crtcs_arr = json_object_object_get(obj, "crtcs");
+	size_t crtcs_len = json_object_array_length(crtcs_arr);
+	if (crtcs_len == 0) {
+		printf(L_LAST "No DRM vblank events\n");
+		return;
+	}
+	for (size_t i = 0; i < crtcs_len; i++) {
+		struct json_object *crtc_obj = json_object_array_get_idx(crtcs_arr, i);
+		bool last = i == crtcs_len - 1;
+		printf("%s", last ? L_LAST : L_VAL);
+		if (json_object_object_get(crtc_obj, "id")) {
+			printf("CRTC %"PRIu64" (index %"PRIu64")\n",
+				get_object_object_uint64(crtc_obj, "id"),
+				get_object_object_uint64(crtc_obj, "index"));
+		} else {
+			printf("CRTC index %"PRIu64"\n",
+				get_object_object_uint64(crtc_obj, "index"));
+		}
+		print_crtc_stats(crtc_obj, last ? L_GAP : L_LINE);
+	}
+}
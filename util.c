@@ -0,0 +1,70 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <json_object.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+
+const char *get_object_object_string(struct json_object *obj,
+		const char *key)
+{
+	struct json_object *str_obj = json_object_object_get(obj, key);
+	if (!str_obj) {
+		return NULL;
+	}
+	return json_object_get_string(str_obj);
+}
+
+uint64_t get_object_object_uint64(struct json_object *obj, const char *key)
+{
+	struct json_object *uint64_obj = json_object_object_get(obj, key);
+	if (!uint64_obj) {
+		return 0;
+	}
+	return json_object_get_uint64(uint64_obj);
+}
+
+double get_object_object_double(struct json_object *obj, const char *key)
+{
+	struct json_object *double_obj = json_object_object_get(obj, key);
+	if (!double_obj) {
+		return 0;
+	}
+	return json_object_get_double(double_obj);
+}
+
+struct json_object *find_by_id(struct json_object *arr, uint64_t id)
+{
+	for (size_t i = 0; i < json_object_array_length(arr); i++) {
+		struct json_object *obj = json_object_array_get_idx(arr, i);
+		if (get_object_object_uint64(obj, "id") == id) {
+			return obj;
+		}
+	}
+	return NULL;
+}
+
+const char *plane_type_str(uint64_t type)
+{
+	switch (type) {
+	case DRM_PLANE_TYPE_OVERLAY:
+		return "overlay";
+	case DRM_PLANE_TYPE_PRIMARY:
+		return "primary";
+	case DRM_PLANE_TYPE_CURSOR:
+		return "cursor";
+	}
+	return "unknown";
+}
+
+void print_size(uint64_t bytes)
+{
+	if (bytes >= 1024 * 1024 * 1024) {
+		printf("%.1f GiB", bytes / (1024.0 * 1024 * 1024));
+	} else if (bytes >= 1024 * 1024) {
+		printf("%.1f MiB", bytes / (1024.0 * 1024));
+	} else {
+		printf("%"PRIu64" KiB", bytes / 1024);
+	}
+}
@@ -0,0 +1,418 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json_object.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "drm_info.h"
+
+/* Recordings are plain JSON so they can be saved with -j and analyzed again
+ * with -i, or written by hand to replay a given event stream:
+ *
+ *   { "/dev/dri/card0": { "crtcs": [ { "id": 42, "mode": { ... },
+ *     "samples": [ [ sequence, ns ], ... ] } ] } }
+ */
+
+struct vblank_recorder;
+
+struct vblank_crtc {
+	struct vblank_recorder *rec;
+	uint32_t id;
+	int fd;
+	const char *path;
+	struct json_object *mode_obj;
+	uint64_t *seq, *ns;
+	size_t len;
+	bool failed;
+};
+
+struct vblank_recorder {
+	struct vblank_crtc *crtcs;
+	size_t crtcs_len;
+	size_t samples;
+	size_t pending;
+};
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool queue_vblank(struct vblank_crtc *crtc)
+{
+	int ret = drmCrtcQueueSequence(crtc->fd, crtc->id,
+		DRM_CRTC_SEQUENCE_RELATIVE | DRM_CRTC_SEQUENCE_NEXT_ON_MISS, 1,
+		NULL, (uint64_t)(uintptr_t)crtc);
+	if (ret != 0) {
+		fprintf(stderr, "%s: CRTC %"PRIu32": drmCrtcQueueSequence: %s\n",
+			crtc->path, crtc->id, strerror(errno));
+		crtc->failed = true;
+		crtc->rec->pending--;
+		return false;
+	}
+	return true;
+}
+
+static void handle_sequence(int fd, uint64_t sequence, uint64_t ns,
+		uint64_t user_data)
+{
+	(void)fd;
+	struct vblank_crtc *crtc = (struct vblank_crtc *)(uintptr_t)user_data;
+	crtc->seq[crtc->len] = sequence;
+	crtc->ns[crtc->len] = ns;
+	crtc->len++;
+	if (crtc->len == crtc->rec->samples) {
+		crtc->rec->pending--;
+	} else {
+		queue_vblank(crtc);
+	}
+}
+
+static bool add_device_crtcs(struct vblank_recorder *rec, const char *path,
+		struct json_object *dev_obj, int fd)
+{
+	struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+	for (size_t i = 0; i < json_object_array_length(crtcs_arr); i++) {
+		struct json_object *crtc_obj = json_object_array_get_idx(crtcs_arr, i);
+		struct json_object *mode_obj = json_object_object_get(crtc_obj, "mode");
+		if (!mode_obj) {
+			continue;
+		}
+
+		struct vblank_crtc *crtcs = realloc(rec->crtcs,
+			(rec->crtcs_len + 1) * sizeof(*crtcs));
+		if (!crtcs) {
+			perror("realloc");
+			return false;
+		}
+		rec->crtcs = crtcs;
+
+		struct vblank_crtc *crtc = &rec->crtcs[rec->crtcs_len];
+		*crtc = (struct vblank_crtc){
+			.rec = rec,
+			.id = get_object_object_uint64(crtc_obj, "id"),
+			.fd = fd,
+			.path = path,
+			.mode_obj = mode_obj,
+			.seq = calloc(rec->samples, sizeof(uint64_t)),
+			.ns = calloc(rec->samples, sizeof(uint64_t)),
+		};
+		rec->crtcs_len++;
+		if (!crtc->seq || !crtc->ns) {
+			perror("calloc");
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Collects samples vblank timestamps on every active CRTC of every device
+ * at once, by polling all device fds together */
+struct json_object *vblank_record(struct json_object *drm_obj, size_t samples)
+{
+	struct vblank_recorder rec = { .samples = samples };
+	struct json_object *obj = json_object_new_object();
+	struct pollfd *fds = NULL;
+	size_t fds_len = 0;
+	bool ok = true;
+
+	json_object_object_foreach(drm_obj, path, dev_obj) {
+		int fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd < 0) {
+			fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+			continue;
+		}
+
+		struct pollfd *new_fds = realloc(fds, (fds_len + 1) * sizeof(*fds));
+		if (!new_fds) {
+			perror("realloc");
+			close(fd);
+			ok = false;
+			break;
+		}
+		fds = new_fds;
+		fds[fds_len++] = (struct pollfd){ .fd = fd, .events = POLLIN };
+
+		struct json_object *rec_dev_obj = json_object_new_object();
+		json_object_object_add(rec_dev_obj, "crtcs", json_object_new_array());
+		json_object_object_add(obj, path, rec_dev_obj);
+
+		if (!add_device_crtcs(&rec, path, dev_obj, fd)) {
+			ok = false;
+			break;
+		}
+	}
+
+	if (ok) {
+		rec.pending = rec.crtcs_len;
+		for (size_t i = 0; i < rec.crtcs_len; i++) {
+			queue_vblank(&rec.crtcs[i]);
+		}
+	}
+
+	/* Allow for refresh rates down to 10Hz */
+	uint64_t deadline = now_ms() + 1000 + 100 * samples;
+	drmEventContext ctx = {
+		.version = DRM_EVENT_CONTEXT_VERSION,
+		.sequence_handler = handle_sequence,
+	};
+	while (ok && rec.pending > 0) {
+		uint64_t now = now_ms();
+		if (now >= deadline) {
+			break;
+		}
+		int ret = poll(fds, fds_len, deadline - now);
+		if (ret < 0 && errno != EINTR) {
+			perror("poll");
+			break;
+		}
+		for (size_t i = 0; ret > 0 && i < fds_len; i++) {
+			if ((fds[i].revents & POLLIN) && drmHandleEvent(fds[i].fd, &ctx) != 0) {
+				perror("drmHandleEvent");
+			}
+		}
+	}
+
+	if (!ok) {
+		json_object_put(obj);
+		obj = NULL;
+	}
+	for (size_t i = 0; i < rec.crtcs_len; i++) {
+		struct vblank_crtc *crtc = &rec.crtcs[i];
+		if (ok && !crtc->failed && crtc->len < samples) {
+			fprintf(stderr, "%s: CRTC %"PRIu32": timed out after %zu of %zu "
+				"vblanks\n", crtc->path, crtc->id, crtc->len, samples);
+		}
+
+		/* Keep what was collected before a queueing error */
+		if (obj && (crtc->len > 0 || !crtc->failed)) {
+			struct json_object *dev_obj = json_object_object_get(obj, crtc->path);
+
+			struct json_object *crtc_obj = json_object_new_object();
+			json_object_object_add(crtc_obj, "id",
+				json_object_new_uint64(crtc->id));
+			json_object_object_add(crtc_obj, "mode",
+				json_object_get(crtc->mode_obj));
+			struct json_object *samples_arr = json_object_new_array();
+			for (size_t j = 0; j < crtc->len; j++) {
+				struct json_object *sample_arr = json_object_new_array();
+				json_object_array_add(sample_arr,
+					json_object_new_uint64(crtc->seq[j]));
+				json_object_array_add(sample_arr,
+					json_object_new_uint64(crtc->ns[j]));
+				json_object_array_add(samples_arr, sample_arr);
+			}
+			json_object_object_add(crtc_obj, "samples", samples_arr);
+			json_object_array_add(
+				json_object_object_get(dev_obj, "crtcs"), crtc_obj);
+		}
+
+		free(crtc->seq);
+		free(crtc->ns);
+	}
+
+	for (size_t i = 0; i < fds_len; i++) {
+		close(fds[i].fd);
+	}
+	free(fds);
+	free(rec.crtcs);
+	return obj;
+}
+
+static int double_cmp(const void *a_ptr, const void *b_ptr)
+{
+	double a = *(const double *)a_ptr, b = *(const double *)b_ptr;
+	return a < b ? -1 : a > b;
+}
+
+/* Nearest-rank percentile of a sorted array */
+static double percentile(const double *sorted, size_t len, unsigned p)
+{
+	size_t rank = (p * len + 99) / 100;
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static struct json_object *crtc_stats(struct json_object *crtc_obj)
+{
+	struct json_object *samples_arr =
+		json_object_object_get(crtc_obj, "samples");
+	size_t len = json_object_array_length(samples_arr);
+
+	struct json_object *obj = json_object_new_object();
+	json_object_object_add(obj, "id", json_object_new_uint64(
+		get_object_object_uint64(crtc_obj, "id")));
+	struct json_object *mode_obj = json_object_object_get(crtc_obj, "mode");
+	json_object_object_add(obj, "mode", json_object_get(mode_obj));
+	json_object_object_add(obj, "samples", json_object_get(samples_arr));
+
+	uint64_t *seq = calloc(len + 1, sizeof(*seq));
+	uint64_t *ns = calloc(len + 1, sizeof(*ns));
+	double *periods = calloc(len + 1, sizeof(*periods));
+	if (!seq || !ns || !periods) {
+		perror("calloc");
+		goto out;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		struct json_object *sample_arr =
+			json_object_array_get_idx(samples_arr, i);
+		seq[i] = json_object_get_uint64(json_object_array_get_idx(sample_arr, 0));
+		ns[i] = json_object_get_uint64(json_object_array_get_idx(sample_arr, 1));
+	}
+
+	/* A sequence step larger than one means vblanks were missed, the
+	 * interval is spread over all of them */
+	size_t periods_len = 0;
+	uint64_t missed = 0;
+	double min = INFINITY, max = 0;
+	for (size_t i = 1; i < len; i++) {
+		if (seq[i] <= seq[i - 1] || ns[i] < ns[i - 1]) {
+			continue;
+		}
+		uint64_t steps = seq[i] - seq[i - 1];
+		double period = (double)(ns[i] - ns[i - 1]) / steps;
+		missed += steps - 1;
+		periods[periods_len++] = period;
+		min = fmin(min, period);
+		max = fmax(max, period);
+	}
+	if (periods_len == 0) {
+		goto out;
+	}
+
+	double mean = (double)(ns[len - 1] - ns[0]) / (seq[len - 1] - seq[0]);
+	for (size_t i = 0; i < periods_len; i++) {
+		periods[i] = fabs(periods[i] - mean);
+	}
+	qsort(periods, periods_len, sizeof(*periods), double_cmp);
+
+	double measured = 1e9 / mean;
+	double nominal = mode_refresh_rate(mode_obj);
+	struct json_object *refresh_obj = json_object_new_object();
+	json_object_object_add(refresh_obj, "nominal",
+		nominal > 0 ? json_object_new_double(nominal) : NULL);
+	json_object_object_add(refresh_obj, "measured",
+		json_object_new_double(measured));
+	json_object_object_add(refresh_obj, "drift_ppm", nominal > 0 ?
+		json_object_new_double((measured - nominal) / nominal * 1e6) : NULL);
+	json_object_object_add(obj, "refresh", refresh_obj);
+
+	struct json_object *period_obj = json_object_new_object();
+	json_object_object_add(period_obj, "mean", json_object_new_double(mean));
+	json_object_object_add(period_obj, "min", json_object_new_double(min));
+	json_object_object_add(period_obj, "max", json_object_new_double(max));
+	json_object_object_add(obj, "period_ns", period_obj);
+
+	static const unsigned percentiles[] = { 50, 90, 99 };
+	struct json_object *jitter_obj = json_object_new_object();
+	for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+		char key[8];
+		snprintf(key, sizeof(key), "p%u", percentiles[i]);
+		json_object_object_add(jitter_obj, key, json_object_new_double(
+			percentile(periods, periods_len, percentiles[i])));
+	}
+	json_object_object_add(jitter_obj, "max",
+		json_object_new_double(periods[periods_len - 1]));
+	json_object_object_add(obj, "jitter_ns", jitter_obj);
+
+	json_object_object_add(obj, "missed", json_object_new_uint64(missed));
+
+out:
+	free(seq);
+	free(ns);
+	free(periods);
+	return obj;
+}
+
+struct json_object *vblank_info(struct json_object *rec_obj)
+{
+	struct json_object *obj = json_object_new_object();
+	json_object_object_foreach(rec_obj, path, dev_obj) {
+		struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+		struct json_object *stats_arr = json_object_new_array();
+		for (size_t i = 0; i < json_object_array_length(crtcs_arr); i++) {
+			json_object_array_add(stats_arr,
+				crtc_stats(json_object_array_get_idx(crtcs_arr, i)));
+		}
+
+		struct json_object *stats_dev_obj = json_object_new_object();
+		json_object_object_add(stats_dev_obj, "crtcs", stats_arr);
+		json_object_object_add(obj, path, stats_dev_obj);
+	}
+	return obj;
+}
+
+static void print_crtc_stats(struct json_object *obj, const char *prefix)
+{
+	struct json_object *mode_obj = json_object_object_get(obj, "mode");
+	const char *mode_name =
+		json_object_get_string(json_object_object_get(mode_obj, "name"));
+	printf("CRTC %"PRIu64": %s, %zu vblanks\n",
+		get_object_object_uint64(obj, "id"),
+		mode_name ? mode_name : "unknown mode",
+		json_object_array_length(json_object_object_get(obj, "samples")));
+
+	struct json_object *refresh_obj = json_object_object_get(obj, "refresh");
+	if (!refresh_obj) {
+		printf("%s" L_LAST "Not enough samples\n", prefix);
+		return;
+	}
+
+	printf("%s" L_VAL "Refresh: %.3f Hz measured", prefix,
+		get_object_object_double(refresh_obj, "measured"));
+	if (json_object_object_get(refresh_obj, "nominal")) {
+		printf(", %.3f Hz nominal, drift %+.0f ppm",
+			get_object_object_double(refresh_obj, "nominal"),
+			get_object_object_double(refresh_obj, "drift_ppm"));
+	}
+	printf("\n");
+
+	struct json_object *period_obj = json_object_object_get(obj, "period_ns");
+	printf("%s" L_VAL "Period: mean %.3f ms, min %.3f ms, max %.3f ms\n", prefix,
+		get_object_object_double(period_obj, "mean") / 1e6,
+		get_object_object_double(period_obj, "min") / 1e6,
+		get_object_object_double(period_obj, "max") / 1e6);
+
+	struct json_object *jitter_obj = json_object_object_get(obj, "jitter_ns");
+	printf("%s" L_VAL "Jitter: p50 %.1f us, p90 %.1f us, p99 %.1f us, "
+		"max %.1f us\n", prefix,
+		get_object_object_double(jitter_obj, "p50") / 1e3,
+		get_object_object_double(jitter_obj, "p90") / 1e3,
+		get_object_object_double(jitter_obj, "p99") / 1e3,
+		get_object_object_double(jitter_obj, "max") / 1e3);
+
+	printf("%s" L_LAST "Missed vblanks: %"PRIu64"\n", prefix,
+		get_object_object_uint64(obj, "missed"));
+}
+
+void print_vblank(struct json_object *obj)
+{
+	json_object_object_foreach(obj, path, dev_obj) {
+		printf("Node: %s\n", path);
+
+		struct json_object *crtcs_arr = json_object_object_get(dev_obj, "crtcs");
+		size_t crtcs_len = json_object_array_length(crtcs_arr);
+		if (crtcs_len == 0) {
+			printf(L_LAST "No active CRTC\n");
+			continue;
+		}
+		for (size_t i = 0; i < crtcs_len; i++) {
+			bool last = i == crtcs_len - 1;
+			printf("%s", last ? L_LAST : L_VAL);
+			print_crtc_stats(json_object_array_get_idx(crtcs_arr, i),
+				last ? L_GAP : L_LINE);
+		}
+	}
+}